@@ -0,0 +1,182 @@
+/*
+ * On-target benchmark mode
+ */
+#include "benchmark.h"
+
+#if BENCHMARK_MODE
+
+#include "persist.h"
+#include <avr/interrupt.h>
+
+namespace dusk_dawn_timer {
+
+// Timer1 overflows, the upper 16 bits of the cycle count
+static volatile uint16_t sOverflows;
+
+RtcControl* Benchmark::sRtc;
+Dusk2Dawn* Benchmark::sD2d;
+Timer* Benchmark::sTimer;
+OledControl* Benchmark::sOled;
+bool Benchmark::sPending;
+uint32_t Benchmark::sOverhead;
+volatile uint16_t Benchmark::sSink;
+
+} // namespace
+
+ISR(TIMER1_OVF_vect)
+{
+  dusk_dawn_timer::sOverflows++;
+}
+
+namespace dusk_dawn_timer {
+
+void Benchmark::begin(RtcControl* rtc, Dusk2Dawn* d2d, Timer* timer, OledControl* oled)
+{
+  sRtc = rtc;
+  sD2d = d2d;
+  sTimer = timer;
+  sOled = oled;
+  // Today's values for the default screen
+  sD2d->update(sRtc->getYear(), sRtc->getMonth(), sRtc->getDay(), sRtc->dayLightSaving());
+  sTimer->update();
+  // Timer1 in normal mode without prescaler counts every CPU cycle
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  TCNT1 = 0;
+  TIFR1 = _BV(TOV1);
+  TIMSK1 = _BV(TOIE1);
+  sPending = true;
+}
+
+void Benchmark::update()
+{
+  while (Serial.available())
+  {
+    Serial.read();
+    sPending = true;
+  }
+  if (!sPending) return;
+  sPending = false;
+  runAll();
+}
+
+void Benchmark::runAll()
+{
+  Serial.print(F("# benchmark, build " __DATE__ " " __TIME__ ", F_CPU "));
+  Serial.println(F_CPU);
+  Serial.println(F("kernel,runs,min,avg,max"));
+  sOverhead = 0;
+  measure(F("overhead"), overhead, BENCHMARK_RUNS);
+  measure(F("sunrise_set"), sunriseSet, BENCHMARK_RUNS);
+  measure(F("day_of_week"), dayOfTheWeek, BENCHMARK_RUNS);
+  measure(F("clock_now"), clockNow, BENCHMARK_RUNS);
+  measure(F("timer_decision"), timerDecision, BENCHMARK_RUNS);
+  measure(F("oled_render"), oledRender, BENCHMARK_RUNS);
+  measure(F("persist_read"), persistRead, BENCHMARK_RUNS);
+  const uint8_t timeout = Persist::getScreenBlankTimeout();
+  measure(F("persist_write"), persistWrite, BENCHMARK_WRITE_RUNS);
+  Persist::setScreenBlankTimeout(timeout);
+  Persist::flush();
+  Serial.println(F("# end"));
+}
+
+/*
+ * The first measurement is the empty kernel; its minimum is the cost of
+ * the call and the two counter reads, taken off all later rows.
+ */
+void Benchmark::measure(const __FlashStringHelper* name, Kernel kernel, const uint16_t& runs)
+{
+  uint32_t minimum = 0xFFFFFFFF;
+  uint32_t maximum = 0;
+  uint32_t sum = 0;
+  kernel(0); // Warm up, e.g. the first I2C transfer
+  for (uint16_t run = 0; run < runs; ++run)
+  {
+    const uint32_t start = cycles();
+    kernel(run);
+    uint32_t elapsed = cycles() - start;
+    elapsed = elapsed > sOverhead ? elapsed - sOverhead : 0;
+    if (elapsed < minimum) minimum = elapsed;
+    if (elapsed > maximum) maximum = elapsed;
+    sum += elapsed;
+  }
+  if (sOverhead == 0) sOverhead = minimum;
+  Serial.print(name);
+  Serial.print(',');
+  Serial.print(runs);
+  Serial.print(',');
+  Serial.print(minimum);
+  Serial.print(',');
+  Serial.print(sum / runs);
+  Serial.print(',');
+  Serial.println(maximum);
+  Serial.flush(); // The transmit interrupts stay out of the next row
+}
+
+/*
+ * Counter and overflow count must belong together: an overflow pending
+ * while the counter already wrapped is counted here.
+ */
+uint32_t Benchmark::cycles()
+{
+  cli();
+  const uint16_t count = TCNT1;
+  uint16_t overflows = sOverflows;
+  if ((TIFR1 & _BV(TOV1)) && count < 0x8000) overflows++;
+  sei();
+  return (static_cast<uint32_t>(overflows) << 16) | count;
+}
+
+void Benchmark::overhead(const uint16_t&)
+{
+}
+
+void Benchmark::sunriseSet(const uint16_t& run)
+{
+  // Another date every run
+  uint16_t sunrise, sunset;
+  sD2d->calculate(2018, 1 + run % 12, 1 + run % 28, false, sunrise, sunset);
+  sSink = sunrise + sunset;
+}
+
+void Benchmark::dayOfTheWeek(const uint16_t& run)
+{
+  sSink = RtcControl::dayOfTheWeek(2000 + run % 70, 1 + run % 12, 1 + run % 28);
+}
+
+void Benchmark::clockNow(const uint16_t&)
+{
+  uint16_t year, minutesSinceMidnight;
+  uint8_t month, day;
+  RtcClock::now(year, month, day, minutesSinceMidnight);
+  sSink = minutesSinceMidnight;
+}
+
+void Benchmark::timerDecision(const uint16_t& run)
+{
+  uint16_t nextSwitchTime;
+  bool switchedOn;
+  sTimer->evaluate(run % 7, (run * 37) % MINUTES_PER_DAY, nextSwitchTime, switchedOn);
+  sSink = nextSwitchTime + switchedOn;
+}
+
+void Benchmark::oledRender(const uint16_t&)
+{
+  sOled->updateMenu(true);
+}
+
+void Benchmark::persistRead(const uint16_t&)
+{
+  sSink = Persist::begin();
+}
+
+void Benchmark::persistWrite(const uint16_t&)
+{
+  // Flip between two values, so every run changes the byte and the CRC
+  Persist::setScreenBlankTimeout(Persist::getScreenBlankTimeout() == 1 ? 2 : 1);
+  Persist::flush();
+}
+
+} // namespace
+
+#endif // BENCHMARK_MODE
@@ -0,0 +1,83 @@
+/*
+ * On-target benchmark mode
+ *
+ * With BENCHMARK_MODE set the sketch boots into a benchmark instead of the
+ * timer: after the normal setup() the watchdog is stopped and every kernel
+ * below runs BENCHMARK_RUNS times, timed with Timer1 counting CPU cycles.
+ * The results go out on the serial port as CSV; any byte received runs the
+ * benchmark again. Lines starting with '#' are comments:
+ *
+ *   # benchmark, build Jan  1 2024 12:00:00, F_CPU 16000000
+ *   kernel,runs,min,avg,max
+ *   overhead,100,12,12,12
+ *   sunrise_set,100,51234,51890,52678
+ *   ...
+ *   # end
+ *
+ * Times are CPU cycles with the overhead of the measurement itself (the
+ * first row) taken off. Interrupts stay enabled, the I2C and serial drivers
+ * need them; min is the time without any interrupt in between.
+ *
+ *   overhead        an empty kernel
+ *   sunrise_set     Dusk2Dawn::calculate(), sunriseSet() for dawn and dusk
+ *   day_of_week     RtcControl::dayOfTheWeek()
+ *   clock_now       the clock backend now(), an I2C read of the DS3231
+ *   timer_decision  Timer::evaluate(), the switch decision of update()
+ *   oled_render     a full redraw of the default screen
+ *   persist_read    Persist::begin(), reading and checking the settings
+ *   persist_write   one setting changed and committed to the EEPROM
+ *
+ * persist_write only runs BENCHMARK_WRITE_RUNS times, every run programs
+ * EEPROM cells and adds a record to the journal; the journal writes its
+ * queue when it is full, which shows in max. The setting is restored
+ * afterwards.
+ */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "Arduino.h"
+#include "config.h"
+
+#if BENCHMARK_MODE
+
+#include "rtccontrol.h"
+#include "dusk2dawn.h"
+#include "timer.h"
+#include "oledcontrol.h"
+
+namespace dusk_dawn_timer {
+
+class Benchmark {
+public:
+  static void begin(RtcControl* rtc, Dusk2Dawn* d2d, Timer* timer, OledControl* oled);
+  // Runs the benchmark once after begin() and again for every byte received
+  static void update();
+
+private:
+  typedef void (*Kernel)(const uint16_t& run);
+  static void runAll();
+  static void measure(const __FlashStringHelper* name, Kernel kernel, const uint16_t& runs);
+  static uint32_t cycles();
+
+  static void overhead(const uint16_t& run);
+  static void sunriseSet(const uint16_t& run);
+  static void dayOfTheWeek(const uint16_t& run);
+  static void clockNow(const uint16_t& run);
+  static void timerDecision(const uint16_t& run);
+  static void oledRender(const uint16_t& run);
+  static void persistRead(const uint16_t& run);
+  static void persistWrite(const uint16_t& run);
+
+  static RtcControl* sRtc;
+  static Dusk2Dawn* sD2d;
+  static Timer* sTimer;
+  static OledControl* sOled;
+  static bool sPending;
+  static uint32_t sOverhead;
+  static volatile uint16_t sSink; // Keeps the results of the kernels alive
+};
+
+} // namespace
+
+#endif // BENCHMARK_MODE
+#endif // BENCHMARK_H
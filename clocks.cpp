@@ -0,0 +1,148 @@
+/*
+ * Clock backends for RtcControl
+ */
+#include "clocks.h"
+#include "rtccontrol.h"
+#include <Wire.h>
+
+namespace dusk_dawn_timer {
+
+#define DS3231_ADDRESS  0x68
+#define DS3231_CONTROL  0x0E
+#define DS3231_STATUSREG 0x0F
+
+#define DS1307_ADDRESS 0x68
+#define DS1307_CLOCK_HALT 0x80 // In the seconds register
+
+// DS3231 and DS1307 share the layout of the time registers 0 to 6
+
+static uint8_t bcd2bin (uint8_t val) { return val - 6 * (val >> 4); }
+static uint8_t bin2bcd (uint8_t val) { return val + 6 * (val / 10); }
+
+static uint8_t read_i2c_register(uint8_t addr, uint8_t reg) {
+  Wire.beginTransmission(addr);
+  Wire.write((byte)reg);
+  Wire.endTransmission();
+
+  Wire.requestFrom(addr, (byte)1);
+  return Wire.read();
+}
+
+static void write_i2c_register(uint8_t addr, uint8_t reg, uint8_t val) {
+  Wire.beginTransmission(addr);
+  Wire.write((byte)reg);
+  Wire.write((byte)val);
+  Wire.endTransmission();
+}
+
+static void writeTime(uint8_t addr, const uint16_t& year, const uint8_t& month, const uint8_t& day, const uint16_t& minutesSinceMidnight) {
+  Wire.beginTransmission(addr);
+  Wire.write((byte)0); // start at location 0
+  Wire.write(bin2bcd(0)); // seconds, also starts a halted DS1307
+  Wire.write(bin2bcd(minutesSinceMidnight%MINUTES_PER_HOUR));
+  Wire.write(bin2bcd(minutesSinceMidnight/MINUTES_PER_HOUR));
+  Wire.write(bin2bcd(0));
+  Wire.write(bin2bcd(day));
+  Wire.write(bin2bcd(month));
+  Wire.write(bin2bcd(year - 2000));
+  Wire.endTransmission();
+}
+
+static void readTime(uint8_t addr, uint16_t& year, uint8_t& month, uint8_t& day, uint16_t& minutesSinceMidnight) {
+  Wire.beginTransmission(addr);
+  Wire.write((byte)0);  
+  Wire.endTransmission();
+
+  Wire.requestFrom(addr, (byte)7);
+  Wire.read(); // seconds
+  minutesSinceMidnight = bcd2bin(Wire.read()) + MINUTES_PER_HOUR * bcd2bin(Wire.read());
+  Wire.read();
+  day = bcd2bin(Wire.read());
+  month = bcd2bin(Wire.read());
+  year = bcd2bin(Wire.read()) + 2000;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DS3231
+
+void Ds3231Clock::begin() {
+  Wire.begin();
+}
+
+bool Ds3231Clock::lostPower() {
+  return (read_i2c_register(DS3231_ADDRESS, DS3231_STATUSREG) >> 7);
+}
+
+void Ds3231Clock::adjust(const uint16_t& year, const uint8_t& month, const uint8_t& day, const uint16_t& minutesSinceMidnight) {
+  writeTime(DS3231_ADDRESS, year, month, day, minutesSinceMidnight);
+
+  uint8_t statreg = read_i2c_register(DS3231_ADDRESS, DS3231_STATUSREG);
+  statreg &= ~0x80; // flip OSF bit
+  write_i2c_register(DS3231_ADDRESS, DS3231_STATUSREG, statreg);
+}
+
+void Ds3231Clock::now(uint16_t& year, uint8_t& month, uint8_t& day, uint16_t& minutesSinceMidnight) {
+  readTime(DS3231_ADDRESS, year, month, day, minutesSinceMidnight);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DS1307
+
+void Ds1307Clock::begin() {
+  Wire.begin();
+}
+
+bool Ds1307Clock::lostPower() {
+  return read_i2c_register(DS1307_ADDRESS, 0) & DS1307_CLOCK_HALT;
+}
+
+void Ds1307Clock::adjust(const uint16_t& year, const uint8_t& month, const uint8_t& day, const uint16_t& minutesSinceMidnight) {
+  writeTime(DS1307_ADDRESS, year, month, day, minutesSinceMidnight);
+}
+
+void Ds1307Clock::now(uint16_t& year, uint8_t& month, uint8_t& day, uint16_t& minutesSinceMidnight) {
+  readTime(DS1307_ADDRESS, year, month, day, minutesSinceMidnight);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// millis()
+
+bool MillisClock::sValid = false;
+uint16_t MillisClock::sYear = 2018;
+uint8_t MillisClock::sMonth = 1;
+uint8_t MillisClock::sDay = 1;
+uint16_t MillisClock::sMinutesSinceMidnight = 0;
+unsigned long MillisClock::sMinuteStart = 0;
+
+void MillisClock::adjust(const uint16_t& year, const uint8_t& month, const uint8_t& day, const uint16_t& minutesSinceMidnight) {
+  sYear = year;
+  sMonth = month;
+  sDay = day;
+  sMinutesSinceMidnight = minutesSinceMidnight;
+  sMinuteStart = millis();
+  sValid = true;
+}
+
+/*
+ * Carries the elapsed whole minutes into the date; called at least once a
+ * second, so millis() never wraps in between.
+ */
+void MillisClock::now(uint16_t& year, uint8_t& month, uint8_t& day, uint16_t& minutesSinceMidnight) {
+  while (millis() - sMinuteStart >= 60000UL)
+  {
+    sMinuteStart += 60000UL;
+    if (++sMinutesSinceMidnight < MINUTES_PER_DAY) continue;
+    sMinutesSinceMidnight = 0;
+    if (++sDay <= RtcControl::getDaysPerMonth(sMonth, sYear)) continue;
+    sDay = 1;
+    if (++sMonth <= 12) continue;
+    sMonth = 1;
+    sYear++;
+  }
+  year = sYear;
+  month = sMonth;
+  day = sDay;
+  minutesSinceMidnight = sMinutesSinceMidnight;
+}
+
+} // namespace
@@ -0,0 +1,57 @@
+/*
+ * Clock backends for RtcControl
+ *
+ * Each backend is a policy class with static functions only. RtcControl is
+ * instantiated with the one RTC_CLOCK in config.h selects and calls it
+ * without any indirection; the linker drops the unused backends.
+ *
+ *   begin()      prepare the bus or the counter
+ *   lostPower()  true when the time is not valid and must be set
+ *   adjust(...)  set the time, standard time
+ *   now(...)     read the time, standard time
+ */
+#ifndef CLOCKS_H
+#define CLOCKS_H
+
+#include "Arduino.h"
+
+namespace dusk_dawn_timer {
+
+// DS3231 on I2C, the oscillator stop flag tells a lost time
+class Ds3231Clock {
+public:
+  static void begin();
+  static bool lostPower();
+  static void adjust(const uint16_t& year, const uint8_t& month, const uint8_t& day, const uint16_t& minutesSinceMidnight);
+  static void now(uint16_t& year, uint8_t& month, uint8_t& day, uint16_t& minutesSinceMidnight);
+};
+
+// DS1307 on I2C, the clock halt bit tells a lost time
+class Ds1307Clock {
+public:
+  static void begin();
+  static bool lostPower();
+  static void adjust(const uint16_t& year, const uint8_t& month, const uint8_t& day, const uint16_t& minutesSinceMidnight);
+  static void now(uint16_t& year, uint8_t& month, uint8_t& day, uint16_t& minutesSinceMidnight);
+};
+
+// No clock chip: millis() counts from the last adjust(), the time is lost
+// at every power up and drifts with the ceramic resonator.
+class MillisClock {
+public:
+  static void begin() {}
+  static bool lostPower() { return !sValid; }
+  static void adjust(const uint16_t& year, const uint8_t& month, const uint8_t& day, const uint16_t& minutesSinceMidnight);
+  static void now(uint16_t& year, uint8_t& month, uint8_t& day, uint16_t& minutesSinceMidnight);
+
+private:
+  static bool sValid;
+  static uint16_t sYear;
+  static uint8_t sMonth;
+  static uint8_t sDay;
+  static uint16_t sMinutesSinceMidnight;
+  static unsigned long sMinuteStart; // millis() at the start of the minute above
+};
+
+} // namespace
+#endif // CLOCKS_H
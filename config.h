@@ -0,0 +1,75 @@
+/*
+ * Build options
+ */
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Diagnostics: statistics on a hidden screen (scroll past "Options" in the
+// menu) and reports on the serial port. Set to 0 to leave them out.
+#define DIAGNOSTICS 1
+
+// Loop profiler: time per module and watchdog margin, on the second page of
+// the diagnostics screen. Needs DIAGNOSTICS; set to 0 to leave it out.
+#define PROFILER 1
+
+// Telemetry: binary status frames on the serial port whenever the state
+// changes, for logging units in the field. Set to 1 to build it in.
+#define TELEMETRY 0
+
+// Remote configuration: date, time, programs, options and location set in
+// one CRC-checked frame over the serial port (extras/tools/remoteconfig.py).
+// Set to 0 to leave it out.
+#define REMOTE_CONFIG 1
+
+// Light sensor: an LDR on an analog input brings the SUNDOWN switch
+// forward on dark evenings and holds SUNUP back on dark mornings, within
+// LIGHT_WINDOW minutes of the computed time. Set to 1 to build it in; the
+// host build also builds a variant with it.
+#ifndef LIGHT_SENSOR
+#define LIGHT_SENSOR 0
+#endif
+#define LIGHT_SENSOR_CHANNEL 3 // A3
+#define LIGHT_DARK_LEVEL 200 // Filtered ADC value below which it is dark
+#define LIGHT_BRIGHT_LEVEL 260 // and above which it is light again
+#define LIGHT_WINDOW 45
+
+// Benchmark mode: boots into timing runs of the main kernels instead of
+// the timer, results as CSV on the serial port (see benchmark.h). Set to 1
+// only for benchmark builds.
+#ifndef BENCHMARK_MODE
+#define BENCHMARK_MODE 0
+#endif
+#define BENCHMARK_RUNS 100
+#define BENCHMARK_WRITE_RUNS 10
+
+#define SERIAL_BAUD 57600
+
+// Hardware backends, each build contains only the selected one. The host
+// build also builds and tests the other choices.
+//
+// Clock: CLOCK_DS3231, CLOCK_DS1307 or CLOCK_MILLIS for units without a
+// clock chip (the time must be set after every power up).
+#define CLOCK_DS3231 1
+#define CLOCK_DS1307 2
+#define CLOCK_MILLIS 3
+#ifndef RTC_CLOCK
+#define RTC_CLOCK CLOCK_DS3231
+#endif
+
+// Display: SSD1306 on OLED_SPI (software SPI) or OLED_I2C
+#define OLED_SPI 1
+#define OLED_I2C 2
+#ifndef OLED_INTERFACE
+#define OLED_INTERFACE OLED_SPI
+#endif
+#define OLED_I2C_ADDRESS 0x3C
+
+// Relay output: pin and whether the relay switches on with a low level
+#ifndef RELAY_PIN
+#define RELAY_PIN A2
+#endif
+#ifndef RELAY_ACTIVE_LOW
+#define RELAY_ACTIVE_LOW 1
+#endif
+
+#endif // CONFIG_H
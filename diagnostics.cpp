@@ -0,0 +1,116 @@
+/*
+ * Runtime diagnostics
+ */
+#include "diagnostics.h"
+#include "journal.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "memorymonitor.h"
+
+#if DIAGNOSTICS
+
+namespace dusk_dawn_timer {
+
+// ms between polls of the serial port
+#define SERIAL_POLL_INTERVAL 100
+
+// Upper bounds of the latency histogram buckets in ms, the last is open
+static const uint16_t sLatencyBounds[LATENCY_BUCKETS - 1] PROGMEM = { 10, 20, 50, 100, 200, 500, 1000 };
+
+uint16_t Diagnostics::sLatencyMin;
+uint16_t Diagnostics::sLatencyMax;
+uint32_t Diagnostics::sLatencySum;
+uint16_t Diagnostics::sLatencyCount;
+uint16_t Diagnostics::sLatencyHistogram[LATENCY_BUCKETS];
+
+void Diagnostics::begin()
+{
+  reset();
+}
+
+void Diagnostics::update()
+{
+#if !REMOTE_CONFIG
+  while (Serial.available() > 0) command(Serial.read());
+  Scheduler::runIn(SERIAL_POLL_INTERVAL);
+#endif
+}
+
+void Diagnostics::command(const char& command)
+{
+  switch (command)
+  {
+    case 'd':
+      printLatency(Serial, false);
+      Serial.print(F("Loops "));
+      Serial.print(Scheduler::getLoopCount());
+      Serial.print(F(" wakes "));
+      Serial.println(Scheduler::getWakeCount());
+      MemoryMonitor::print(Serial);
+      break;
+#if PROFILER
+    case 'p':
+      Profiler::print(Serial);
+      break;
+#endif
+    case 'j':
+      Journal::dump(Serial);
+      break;
+    case 'r':
+      reset();
+      Serial.println(F("Statistics reset"));
+      break;
+  }
+}
+
+void Diagnostics::reset()
+{
+  sLatencyMin = 0xFFFF;
+  sLatencyMax = 0;
+  sLatencySum = 0;
+  sLatencyCount = 0;
+  memset(sLatencyHistogram, 0, sizeof(sLatencyHistogram));
+  Scheduler::resetStatistics();
+  Profiler::reset();
+}
+
+void Diagnostics::recordLatency(uint16_t latency)
+{
+  if (latency < sLatencyMin) sLatencyMin = latency;
+  if (latency > sLatencyMax) sLatencyMax = latency;
+  sLatencySum += latency;
+  if (sLatencyCount < 0xFFFF) sLatencyCount++;
+  uint8_t bucket = 0;
+  while (bucket < LATENCY_BUCKETS - 1 && latency >= pgm_read_word(&sLatencyBounds[bucket])) bucket++;
+  if (sLatencyHistogram[bucket] < 0xFFFF) sLatencyHistogram[bucket]++;
+}
+
+/*
+ * Compact fits the histogram on the 21 character display lines, two buckets
+ * per line; otherwise one bucket per line.
+ */
+void Diagnostics::printLatency(Print& out, bool compact)
+{
+  out.print(F("Latency ms, events "));
+  out.println(sLatencyCount);
+  out.print(F("min "));
+  out.print(sLatencyCount ? sLatencyMin : 0);
+  out.print(F(" avg "));
+  out.print(sLatencyCount ? sLatencySum / sLatencyCount : 0);
+  out.print(F(" max "));
+  out.println(sLatencyMax);
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; ++i)
+  {
+    const bool last = i == LATENCY_BUCKETS - 1;
+    uint8_t width = out.print(last ? F(">=") : F("<"));
+    width += out.print(pgm_read_word(&sLatencyBounds[last ? i - 1 : i]));
+    width += out.print(F(": "));
+    width += out.print(sLatencyHistogram[i]);
+    if (!compact || i % 2 == 1) out.println();
+    else while (width++ < 11) out.print(' ');
+  }
+}
+
+} // namespace
+
+#endif // DIAGNOSTICS
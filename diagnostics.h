@@ -0,0 +1,56 @@
+/*
+ * Runtime diagnostics
+ *
+ * Collects statistics that help judge the firmware on a real unit. They are
+ * shown on the hidden diagnostics screen and reported on the serial port:
+ * send 'd' for a report, 'p' for the loop profile, 'r' to reset the
+ * statistics, 'j' to dump the journal. With REMOTE_CONFIG the remote
+ * configuration reads the serial port and passes these commands on.
+ * With DIAGNOSTICS set to 0 the recording functions are empty inlines.
+ */
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include "Arduino.h"
+#include "config.h"
+
+namespace dusk_dawn_timer {
+
+#define LATENCY_BUCKETS 8
+
+#if DIAGNOSTICS
+
+class Diagnostics {
+public:
+  static void begin();
+  static void update();
+  static void reset();
+  static void command(const char& command);
+
+  // Time from an input event until the frame showing its result was drawn
+  static void recordLatency(uint16_t latency);
+  static void printLatency(Print& out, bool compact);
+
+private:
+  static uint16_t sLatencyMin;
+  static uint16_t sLatencyMax;
+  static uint32_t sLatencySum;
+  static uint16_t sLatencyCount;
+  static uint16_t sLatencyHistogram[LATENCY_BUCKETS];
+};
+
+#else
+
+class Diagnostics {
+public:
+  static inline void begin() {}
+  static inline void update() {}
+  static inline void reset() {}
+  static inline void command(const char&) {}
+  static inline void recordLatency(uint16_t) {}
+};
+
+#endif // DIAGNOSTICS
+
+} // namespace
+#endif // DIAGNOSTICS_H
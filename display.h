@@ -0,0 +1,61 @@
+/*
+ * SSD1306 display backend
+ *
+ * OledDisplay is the SSD1306Ascii driver for the interface OLED_INTERFACE
+ * in config.h selects, with the pins or address of this build. Only that
+ * driver is compiled; the rest of the code sees the SSD1306Ascii API.
+ *
+ * Unlike the clock and the relay this is chosen with #if, not a policy
+ * template: the drivers are base classes from two libraries, and the
+ * Arduino IDE builds every library a sketch includes.
+ */
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "Arduino.h"
+#include "config.h"
+
+#if OLED_INTERFACE == OLED_I2C
+
+#include <Wire.h>
+#include <SSD1306AsciiWire.h>
+
+namespace dusk_dawn_timer {
+
+class OledDisplay : public SSD1306AsciiWire {
+public:
+  void begin()
+  {
+    Wire.begin();
+    Wire.setClock(400000L);
+    SSD1306AsciiWire::begin(&Adafruit128x64, OLED_I2C_ADDRESS);
+  }
+};
+
+} // namespace
+
+#else
+
+#include <SSD1306AsciiSoftSpi.h>
+
+// Software SPI pin definitions
+#define CS_PIN   12
+#define RST_PIN  8
+#define DC_PIN   11
+#define MOSI_PIN  9
+#define CLK_PIN  10
+
+namespace dusk_dawn_timer {
+
+class OledDisplay : public SSD1306AsciiSoftSpi {
+public:
+  void begin()
+  {
+    SSD1306AsciiSoftSpi::begin(&Adafruit128x64, CS_PIN, DC_PIN, CLK_PIN, MOSI_PIN, RST_PIN);
+  }
+};
+
+} // namespace
+
+#endif // OLED_INTERFACE
+#endif // DISPLAY_H
@@ -1,10 +1,23 @@
 #include <avr/wdt.h> // watchdog
+#include <avr/interrupt.h>
+#include <assert.h>
 
 #include "rtccontrol.h"
 #include "oledcontrol.h"
 #include "dusk2dawn.h"
 #include "timer.h"
 #include "rotaryencoder.h"
+#include "diagnostics.h"
+#include "persist.h"
+#include "journal.h"
+#include "eepromjobs.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "remoteconfig.h"
+#include "lightsensor.h"
+#include "benchmark.h"
+#include "eventbus.h"
 
 using namespace dusk_dawn_timer;
 
@@ -12,22 +25,65 @@ RtcControl rtcControl;
 Dusk2Dawn dusk2dawn;
 Timer timer = Timer(&rtcControl, &dusk2dawn);
 OledControl oledControl(&rtcControl, &dusk2dawn, &timer);
-RotaryEncoder rotary(&oledControl);
+RotaryEncoder rotary;
+
+/*
+ * Today's dawn and dusk, only recalculated when the date, the daylight
+ * saving time or the location changed.
+ */
+static void dateChanged(void*, uint8_t, const void*)
+{
+  dusk2dawn.update(rtcControl.getYear(), rtcControl.getMonth(), rtcControl.getDay(), rtcControl.dayLightSaving());
+}
 
 /*
  * Setup
  */
 void setup() {
+  Telemetry::begin(&rtcControl, &dusk2dawn, &timer);
+#if DIAGNOSTICS || TELEMETRY || REMOTE_CONFIG || BENCHMARK_MODE
+  Serial.begin(SERIAL_BAUD);
+#endif
+  Diagnostics::begin();
+
+  // Settings first, the other modules read them in begin()
+  Persist::begin();
+  float latitude, longitude;
+  int16_t timezone;
+  Persist::getLocation(latitude, longitude, timezone);
+  dusk2dawn.setLocation(latitude, longitude, timezone);
+
   rtcControl.begin();
+  EventBus::subscribe(BUS_DATE | BUS_LOCATION, dateChanged);
+  dateChanged(0, 0, 0);
+
+  Journal::begin(&rtcControl);
 
+  LightSensor::begin();
   timer.begin();
 
+  RemoteConfig::begin(&rtcControl, &dusk2dawn, &timer);
+
   oledControl.begin();
 
   rotary.begin();
-  
-  // Watchdog
+
+  // A module without room on the bus would silently miss its events:
+  // EVENT_BUS_SUBSCRIBERS must be raised
+  assert(!EventBus::wasFull());
+
+  // Button held at power up: factory reset, only once confirmed on the
+  // display
+  if (rotary.isButtonPressed()) oledControl.confirmFactoryReset();
+
+#if BENCHMARK_MODE
+  // No watchdog, a kernel may take longer than its timeout
+  Benchmark::begin(&rtcControl, &dusk2dawn, &timer, &oledControl);
+#else
+  // Watchdog, interrupt first so the pending EEPROM writes can be saved
   wdt_enable(WDTO_1S);
+  WDTCSR |= _BV(WDIE);
+#endif
 
   pinMode(13, OUTPUT);
   digitalWrite(13, LOW); // Switch off the annoying red led.
@@ -37,17 +93,70 @@ void setup() {
  * Main loop
  */
 void loop() {
-  rtcControl.update();
+#if BENCHMARK_MODE
+  // Instead of the timer; idle until the next byte may have come in
+  Benchmark::update();
+  Scheduler::sleep();
+  return;
+#endif
+  Profiler::beginLoop();
+  rtcControl.update(); // Publishes the minute and date changes
+  Profiler::mark(psRTC);
 
-  dusk2dawn.update(rtcControl.getYear(), rtcControl.getMonth(), rtcControl.getDay(), rtcControl.dayLightSaving());
+  if (!Scheduler::wasNotified())
+  {
+    // Tomorrow's dawn and dusk a small step at a time, not in loops woken by
+    // input; at midnight update() only swaps them in. The daylight saving
+    // time is today's, as update() sees it at midnight.
+    uint16_t year = rtcControl.getYear();
+    uint8_t month = rtcControl.getMonth();
+    uint8_t day = rtcControl.getDay();
+    RtcControl::nextDay(year, month, day);
+    dusk2dawn.prepare(year, month, day, rtcControl.dayLightSaving());
+  }
+  Profiler::mark(psDUSK2DAWN);
  
   timer.update();    
+  Profiler::mark(psTIMER);
 
   rotary.update();
+  Profiler::mark(psROTARY);
   
   oledControl.updateMenu();
-  
-  delay(50);
-  // Keep the watchdog happy
+  Profiler::mark(psOLED);
+
+  RemoteConfig::update();
+  Diagnostics::update();
+  Telemetry::update();
+
+  // Background EEPROM work
+  EepromJobs::update();
+  Persist::update();
+  Journal::update();
+  Profiler::mark(psEEPROM);
+
+  // Idle until the earliest deadline or the next input
+  Scheduler::sleep();
+  // Keep the watchdog happy, and arm its interrupt again: the hardware
+  // clears WDIE when it raises the interrupt
   wdt_reset();
+  WDTCSR |= _BV(WDIE);
+  Profiler::watchdogReset();
+}
+
+// EEPROM bytes the watchdog interrupt may still write: 3.4 ms each, well
+// within the 1 s until the reset even with a fast watchdog oscillator
+#define WATCHDOG_FLUSH_BYTES 200
+
+/*
+ * The watchdog raises this interrupt on the first timeout and resets on the
+ * next one: save what is still waiting to be written, the settings first.
+ */
+ISR(WDT_vect)
+{
+  // Not when the loop hangs in the middle of a record or a commit: the
+  // flush would go on from a stale index
+  if (EepromJobs::isLocked()) return;
+  const uint8_t committed = Persist::flush(WATCHDOG_FLUSH_BYTES);
+  Journal::flush(WATCHDOG_FLUSH_BYTES - committed);
 }
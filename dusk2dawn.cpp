@@ -7,21 +7,19 @@
  *  Most class variables removed to decrease memory usage.
  */
 
-#include "Dusk2Dawn.h"
-
-/*  Latitude and longtitude of your location must be set here.
- *   
- *  HINT: An easy way to find the longitude and latitude for any location is
- *  to find the spot in Google Maps, right click the place on the map, and
- *  select "What's here?". At the bottom, you’ll see a card with the
- *  coordinates.
- */
-#define LATITUDE 52.097105; // Utrecht
-#define LONGTITUDE 5.068294; // Utrecht
+#include "dusk2dawn.h"
+#include "eventbus.h"
 
-/*  Enter your timezone (offset to GMT) here.
- */
-#define TIMEZONE 1 // Netherlands, GMT + 1
+// The hash of a date never reaches this value, see update()
+#define DATE_HASH_INVALID 0xFF
+
+// Steps of prepare(): first and second approximation of sunrise, then of
+// sunset
+#define PREPARE_SUNRISE 0
+#define PREPARE_SUNRISE_AGAIN 1
+#define PREPARE_SUNSET 2
+#define PREPARE_SUNSET_AGAIN 3
+#define PREPARE_DONE 4
 
 namespace dusk_dawn_timer {
 
@@ -29,27 +27,114 @@ namespace dusk_dawn_timer {
 /*                                   PUBLIC                                   */
 /******************************************************************************/
 
+Dusk2Dawn::Dusk2Dawn()
+  : mSunrise(0),
+    mSunset(0),
+    mLatitude(LATITUDE),
+    mLongitude(LONGTITUDE),
+    mTimezone(TIMEZONE * 60),
+    mDateHash(DATE_HASH_INVALID),
+    mNextDate(0),
+    mNextStep(PREPARE_DONE)
+{ }
+
+void Dusk2Dawn::setLocation(float latitude, float longitude, int16_t timezone)
+{
+  mLatitude = latitude;
+  mLongitude = longitude;
+  mTimezone = timezone;
+  mDateHash = DATE_HASH_INVALID;
+  mNextDate = 0;
+}
+
 void Dusk2Dawn::update(uint16_t year, uint8_t month, uint8_t day, bool isDST)
 {
   uint8_t hash = (year-2000) + (month * 3) + (day * 2) + (40 * isDST);
   if (mDateHash != hash) // Only calculate once for each day
   {
     mDateHash = hash;
-    mSunrise = sunriseSet(true, year, month, day, isDST);
-    mSunset = sunriseSet(false, year, month, day, isDST);
+    const uint16_t sunrise = mSunrise;
+    const uint16_t sunset = mSunset;
+    if (mNextStep == PREPARE_DONE && mNextDate == dateKey(year, month, day, isDST))
+    {
+      // Calculated ahead, midnight only swaps the values
+      mSunrise = mNextSunrise;
+      mSunset = mNextSunset;
+    }
+    else
+    {
+      calculate(year, month, day, isDST, mSunrise, mSunset);
+    }
+    if (mSunrise != sunrise || mSunset != sunset) EventBus::publish(BUS_SOLAR);
   }
   
 }
 
+void Dusk2Dawn::calculate(uint16_t year, uint8_t month, uint8_t day, bool isDST, uint16_t& sunrise, uint16_t& sunset) const
+{
+  sunrise = sunriseSet(true, year, month, day, isDST);
+  sunset = sunriseSet(false, year, month, day, isDST);
+}
+
+/*
+ * A new date only starts the work, so the loop that changed the date does
+ * no calculation here. Each later call does one of the four
+ * sunriseSetUTC() calls of sunriseSet() for sunrise and sunset, with the
+ * same arithmetic, so the results equal those of calculate().
+ */
+bool Dusk2Dawn::prepare(uint16_t year, uint8_t month, uint8_t day, bool isDST)
+{
+  const uint16_t key = dateKey(year, month, day, isDST);
+  if (key != mNextDate)
+  {
+    mNextDate = key;
+    mNextStep = PREPARE_SUNRISE;
+    return true;
+  }
+  if (mNextStep == PREPARE_DONE) return false;
+
+  const bool isRise = mNextStep < PREPARE_SUNSET;
+  const float jday = jDay(year, month, day);
+  if (mNextStep == PREPARE_SUNRISE || mNextStep == PREPARE_SUNSET)
+  {
+    mNextTimeUTC = sunriseSetUTC(isRise, jday, mLatitude, mLongitude);
+  }
+  else
+  {
+    const float newJday = jday + mNextTimeUTC / (60 * 24);
+    const int time = localTime(sunriseSetUTC(isRise, newJday, mLatitude, mLongitude), isDST);
+    if (isRise) mNextSunrise = time;
+    else mNextSunset = time;
+  }
+  mNextStep++;
+  return mNextStep != PREPARE_DONE;
+}
+
 /******************************************************************************/
 /*                                  PRIVATE                                   */
 /******************************************************************************/
-int Dusk2Dawn::sunriseSet(bool isRise, int y, int m, int d, bool isDST) {
-  float latitude = LATITUDE;
-  float longitude = LONGTITUDE;
-  uint8_t timezone = TIMEZONE;
+uint16_t Dusk2Dawn::dateKey(uint16_t year, uint8_t month, uint8_t day, bool isDST)
+{
+  // Unique up to 2070 (RTC limit), never 0
+  return ((((year - 2000) * 12 + month) * 32) + day) * 2 + isDST;
+}
+
+int Dusk2Dawn::localTime(float timeUTC, bool isDST) const
+{
+  if (isnan(timeUTC))
+  {
+    // There is no sunrise or sunset, e.g. it's in the (ant)arctic.
+    return -1;
+  }
+  int timeLocal = (int) round(timeUTC + mTimezone);
+  timeLocal += (isDST) ? 60 : 0;
+  return timeLocal;
+}
+
+int Dusk2Dawn::sunriseSet(bool isRise, int y, int m, int d, bool isDST) const {
+  float latitude = mLatitude;
+  float longitude = mLongitude;
   float jday, newJday, timeUTC, newTimeUTC;
-  int timeLocal;
 
   jday    = jDay(y, m, d);
   timeUTC = sunriseSetUTC(isRise, jday, latitude, longitude);
@@ -59,15 +144,7 @@ int Dusk2Dawn::sunriseSet(bool isRise, int y, int m, int d, bool isDST) {
   newJday    = jday + timeUTC / (60 * 24);
   newTimeUTC = sunriseSetUTC(isRise, newJday, latitude, longitude);
 
-  if (!isnan(newTimeUTC)) {
-    timeLocal  = (int) round(newTimeUTC + (timezone * 60));
-    timeLocal += (isDST) ? 60 : 0;
-  } else {
-    // There is no sunrise or sunset, e.g. it's in the (ant)arctic.
-    timeLocal = -1;
-  }
-
-  return timeLocal;
+  return localTime(newTimeUTC, isDST);
 }
 
 
@@ -13,18 +13,53 @@
 #include "Arduino.h"
 #include <math.h>
 
+/*  Latitude and longtitude of your location are set here. They are the
+ *  defaults of the stored location, which can be changed at run time.
+ *   
+ *  HINT: An easy way to find the longitude and latitude for any location is
+ *  to find the spot in Google Maps, right click the place on the map, and
+ *  select "What's here?". At the bottom, you’ll see a card with the
+ *  coordinates.
+ */
+#define LATITUDE 52.097105 // Utrecht
+#define LONGTITUDE 5.068294 // Utrecht
+
+/*  Enter your timezone (offset to GMT) here.
+ */
+#define TIMEZONE 1 // Netherlands, GMT + 1
+
 namespace dusk_dawn_timer {
 
 class Dusk2Dawn {
   public:
+    Dusk2Dawn();
+    // Timezone in minutes east of GMT
+    void setLocation(float latitude, float longitude, int16_t timezone);
     void update(uint16_t year, uint8_t month, uint8_t day, bool isDST);
+    // Sunrise and sunset of any date, leaves today's values alone
+    void calculate(uint16_t year, uint8_t month, uint8_t day, bool isDST, uint16_t& sunrise, uint16_t& sunset) const;
+    // Calculates the values of the next date ahead, one sunriseSetUTC() per
+    // call; update() takes them over when the date changes to that date.
+    // Returns true while steps are left.
+    bool prepare(uint16_t year, uint8_t month, uint8_t day, bool isDST);
     uint16_t mSunrise;
     uint16_t mSunset;
   private:
+    float mLatitude;
+    float mLongitude;
+    int16_t mTimezone;
     uint8_t mDateHash;
-    static int sunrise(int y, int m, int d, bool isDST);
-    static int sunset(int y, int m, int d, bool isDST);
-    static int   sunriseSet(bool, int, int, int, bool);
+    // Values of the next date while prepare() works on them
+    uint16_t mNextDate; // dateKey(), 0 is none
+    uint8_t mNextStep;
+    float mNextTimeUTC; // First approximation of the step in progress
+    uint16_t mNextSunrise;
+    uint16_t mNextSunset;
+    static uint16_t dateKey(uint16_t year, uint8_t month, uint8_t day, bool isDST);
+    int localTime(float timeUTC, bool isDST) const;
+    int sunrise(int y, int m, int d, bool isDST) const;
+    int sunset(int y, int m, int d, bool isDST) const;
+    int   sunriseSet(bool, int, int, int, bool) const;
     static float sunriseSetUTC(bool, float, float, float);
     static float equationOfTime(float);
     static float meanObliquityOfEcliptic(float);
@@ -0,0 +1,77 @@
+/*
+ * Background EEPROM jobs
+ */
+#include "eepromjobs.h"
+#include "scheduler.h"
+#include <EEPROM.h>
+#include <avr/wdt.h>
+
+namespace dusk_dawn_timer {
+
+// Bytes per update(). Only bytes that change are programmed, so a chunk
+// takes at most 8 * 3.3 ms, far below the watchdog timeout.
+#define CHUNK_SIZE 8
+
+EepromJob EepromJobs::sQueue[EEPROM_JOB_QUEUE_SIZE];
+uint8_t EepromJobs::sFirst = 0;
+uint8_t EepromJobs::sQueued = 0;
+uint16_t EepromJobs::sDone = 0;
+uint16_t EepromJobs::sTotal = 0;
+uint16_t EepromJobs::sTotalDone = 0;
+volatile uint8_t EepromJobs::sLocks = 0;
+
+bool EepromJobs::fill(const uint16_t& address, const uint16_t& length, const uint8_t& value)
+{
+  const EepromJob job = { ejFILL, value, address, length };
+  return add(job);
+}
+
+bool EepromJobs::add(const EepromJob& job)
+{
+  if (sQueued == EEPROM_JOB_QUEUE_SIZE) return false;
+  if (sQueued == 0)
+  {
+    sTotal = 0;
+    sTotalDone = 0;
+  }
+  sQueue[(sFirst + sQueued) % EEPROM_JOB_QUEUE_SIZE] = job;
+  sQueued++;
+  sTotal += job.mLength;
+  return true;
+}
+
+void EepromJobs::update()
+{
+  for (uint8_t i = 0; i < CHUNK_SIZE && sQueued > 0; ++i)
+  {
+    const EepromJob& job = sQueue[sFirst];
+    if (sDone < job.mLength) step(job);
+    if (++sDone >= job.mLength)
+    {
+      sDone = 0;
+      sFirst = (sFirst + 1) % EEPROM_JOB_QUEUE_SIZE;
+      sQueued--;
+    }
+    sTotalDone++;
+  }
+  if (sQueued > 0) Scheduler::runIn(0);
+  wdt_reset();
+}
+
+void EepromJobs::step(const EepromJob& job)
+{
+  switch (job.mType)
+  {
+    case ejFILL:
+      EEPROM.update(job.mAddress + sDone, job.mValue);
+      break;
+  }
+}
+
+uint8_t EepromJobs::getProgress()
+{
+  if (sTotalDone >= sTotal) return 100;
+  return static_cast<uint32_t>(sTotalDone) * 100 / sTotal;
+}
+
+} // namespace
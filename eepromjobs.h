@@ -0,0 +1,57 @@
+/*
+ * Background EEPROM jobs
+ *
+ * Programming an EEPROM byte takes 3.3 ms, so filling a larger area would
+ * block the loop for seconds and trip the watchdog. Such work is queued
+ * here and done by update() in bounded chunks, one per loop. While a job
+ * runs, the other EEPROM writers (Persist, Journal) wait, and the
+ * display shows the progress.
+ */
+#ifndef EEPROM_JOBS_H
+#define EEPROM_JOBS_H
+
+#include "Arduino.h"
+
+namespace dusk_dawn_timer {
+
+#define EEPROM_JOB_QUEUE_SIZE 4
+
+#define ejFILL 1 // Set every byte to mValue
+
+struct EepromJob {
+  uint8_t mType;
+  uint8_t mValue;
+  uint16_t mAddress;
+  uint16_t mLength;
+};
+
+class EepromJobs {
+public:
+  // Return false when the queue is full
+  static bool fill(const uint16_t& address, const uint16_t& length, const uint8_t& value);
+
+  static void update(); // Call every loop
+  static bool isBusy() { return sQueued > 0; }
+  static uint8_t getProgress(); // Percent of the queued work done
+
+  // Persist and Journal hold the lock while they change their state; the
+  // watchdog interrupt must not write then. Nests.
+  static void lock() { sLocks = sLocks + 1; }
+  static void unlock() { sLocks = sLocks - 1; }
+  static bool isLocked() { return sLocks != 0; }
+
+private:
+  static bool add(const EepromJob& job);
+  static void step(const EepromJob& job);
+
+  static EepromJob sQueue[EEPROM_JOB_QUEUE_SIZE];
+  static uint8_t sFirst;
+  static uint8_t sQueued;
+  static uint16_t sDone; // Bytes of the first job done
+  static uint16_t sTotal; // Bytes of all jobs since the queue was empty
+  static uint16_t sTotalDone;
+  static volatile uint8_t sLocks;
+};
+
+} // namespace
+#endif // EEPROM_JOBS_H
@@ -0,0 +1,43 @@
+/*
+ * Change notifications between the modules
+ */
+#include "eventbus.h"
+
+namespace dusk_dawn_timer {
+
+EventBus::Subscriber EventBus::sSubscribers[EVENT_BUS_SUBSCRIBERS];
+uint8_t EventBus::sCount = 0;
+bool EventBus::sFull = false;
+
+bool EventBus::subscribe(const uint8_t& events, BusHandler handler, void* context)
+{
+  for (uint8_t i = 0; i < sCount; ++i)
+  {
+    if (sSubscribers[i].mHandler == handler && sSubscribers[i].mContext == context)
+    {
+      sSubscribers[i].mEvents |= events;
+      return true;
+    }
+  }
+  if (sCount == EVENT_BUS_SUBSCRIBERS)
+  {
+    sFull = true;
+    return false;
+  }
+  sSubscribers[sCount].mEvents = events;
+  sSubscribers[sCount].mHandler = handler;
+  sSubscribers[sCount].mContext = context;
+  sCount++;
+  return true;
+}
+
+void EventBus::publish(const uint8_t& events, const void* data)
+{
+  for (uint8_t i = 0; i < sCount; ++i)
+  {
+    const uint8_t subscribed = sSubscribers[i].mEvents & events;
+    if (subscribed) sSubscribers[i].mHandler(sSubscribers[i].mContext, subscribed, data);
+  }
+}
+
+} // namespace
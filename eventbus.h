@@ -0,0 +1,67 @@
+/*
+ * Change notifications between the modules
+ *
+ * Producers publish() when something changed, the subscribers of those
+ * events are called right away, in the order they subscribed. Consumers so
+ * only do work when there is something new instead of comparing state
+ * every loop. The subscriber table has a fixed size and is filled in
+ * setup(); nothing is allocated.
+ *
+ *   BUS_MINUTE       RtcControl, the local minute of the day
+ *   BUS_DATE         RtcControl, the local date or daylight saving time
+ *   BUS_CLOCK_SET    RtcControl, the clock was set (with date and minute)
+ *   BUS_LOCATION     RemoteConfig, the location of Dusk2Dawn
+ *   BUS_SOLAR        Dusk2Dawn, today's sunrise or sunset
+ *   BUS_RELAY        Timer, the relay or the manual override
+ *   BUS_NEXT_SWITCH  Timer, the next switch time
+ *   BUS_INPUT        RotaryEncoder, data is the UserInput (eventqueue.h)
+ *
+ * Only BUS_INPUT has data; the other subscribers ask the producer for the
+ * new state.
+ */
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include "Arduino.h"
+
+namespace dusk_dawn_timer {
+
+#define BUS_MINUTE 0x01
+#define BUS_DATE 0x02
+#define BUS_CLOCK_SET 0x04
+#define BUS_LOCATION 0x08
+#define BUS_SOLAR 0x10
+#define BUS_RELAY 0x20
+#define BUS_NEXT_SWITCH 0x40
+#define BUS_INPUT 0x80
+
+#define EVENT_BUS_SUBSCRIBERS 6
+
+// Called with the subscribed events of a publish(), context as subscribed
+typedef void (*BusHandler)(void* context, uint8_t events, const void* data);
+
+class EventBus {
+public:
+  // A handler subscribed again with the same context gets the events added.
+  // Returns false when the table is full.
+  static bool subscribe(const uint8_t& events, BusHandler handler, void* context = 0);
+  static void publish(const uint8_t& events, const void* data = 0);
+  // True once a subscribe() found the table full; setup() asserts it never
+  // did, the modules subscribe in their begin() and can't report it
+  static bool wasFull() { return sFull; }
+  static uint8_t getSubscriberCount() { return sCount; }
+
+private:
+  struct Subscriber
+  {
+    uint8_t mEvents;
+    BusHandler mHandler;
+    void* mContext;
+  };
+  static Subscriber sSubscribers[EVENT_BUS_SUBSCRIBERS];
+  static uint8_t sCount;
+  static bool sFull;
+};
+
+} // namespace
+#endif // EVENT_BUS_H
@@ -0,0 +1,83 @@
+/*
+ * Lock-free single producer / single consumer queue of input events
+ *
+ * The producer is interrupt context (the encoder ISRs), the consumer is the
+ * main loop. Each side only writes its own index, and both indexes are single
+ * bytes, so no interrupt locking is needed.
+ */
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include "Arduino.h"
+
+namespace dusk_dawn_timer {
+
+#define evNONE 0
+#define evPRESS 1
+#define evLONGPRESS 2
+#define evLEFT 3
+#define evRIGHT 4
+
+#define EVENT_QUEUE_SIZE 16 // Power of two
+#define EVENT_QUEUE_MASK (EVENT_QUEUE_SIZE - 1)
+
+// Keeps the compiler from moving the entry write past the index update
+#define memoryBarrier() __asm__ __volatile__ ("" ::: "memory")
+
+struct InputEvent
+{
+  uint8_t mEvent;
+  uint16_t mTime; // millis(), lower 16 bits
+};
+
+// An input event as published on the event bus (BUS_INPUT)
+struct UserInput
+{
+  uint8_t mEvent;
+  uint8_t mSteps; // Encoder detents, more than one when turned fast
+  uint16_t mTime; // millis(), lower 16 bits
+};
+
+class EventQueue {
+public:
+  // Producer side, call from the ISR only
+  inline bool push(uint8_t event, uint16_t time)
+  {
+    const uint8_t head = mHead;
+    const uint8_t next = (head + 1) & EVENT_QUEUE_MASK;
+    if (next == mTail)
+    {
+      mDropped++;
+      return false;
+    }
+    mEvents[head].mEvent = event;
+    mEvents[head].mTime = time;
+    memoryBarrier();
+    mHead = next;
+    return true;
+  }
+
+  // Consumer side, call from the main loop only
+  inline bool pop(InputEvent& event)
+  {
+    const uint8_t tail = mTail;
+    if (tail == mHead) return false;
+    event.mEvent = mEvents[tail].mEvent;
+    event.mTime = mEvents[tail].mTime;
+    memoryBarrier();
+    mTail = (tail + 1) & EVENT_QUEUE_MASK;
+    return true;
+  }
+
+  inline bool isEmpty() const { return mTail == mHead; }
+  inline uint8_t dropped() const { return mDropped; }
+
+private:
+  InputEvent mEvents[EVENT_QUEUE_SIZE];
+  volatile uint8_t mHead = 0;
+  volatile uint8_t mTail = 0;
+  volatile uint8_t mDropped = 0;
+};
+
+} // namespace
+#endif // EVENT_QUEUE_H
@@ -0,0 +1,347 @@
+/*
+ * Fleet schedule planner
+ *
+ * Predicts every relay transition of many units over a period, using the
+ * sketch's own Dusk2Dawn and Timer code with each unit's location and
+ * program. The units are spread over a pool of threads; each thread has its
+ * own Dusk2Dawn and Timer. The one static module they reach is the event
+ * bus, Dusk2Dawn::update() publishes BUS_SOLAR on it. The planner
+ * subscribes nothing, so the threads only read an empty table, and it
+ * refuses to plan when anything did. Timer::begin() and update() are never
+ * called, the Scheduler, Persist and the Journal stay untouched.
+ *
+ * Usage: fleetplanner [options] DEVICES
+ *
+ *   --year YYYY      plan this calendar year (default 2019)
+ *   --threads N      worker threads (default: all cores)
+ *   --out FILE       write the binary transition file
+ *   --csv FILE       write the transitions as CSV
+ *   --bench          time the planning with 1, 2, 4, ... threads
+ *
+ * DEVICES has one unit per line, '#' starts a comment:
+ *
+ *   NAME LATITUDE LONGITUDE TIMEZONE DST WEEK_ON WEEK_OFF WEEKEND_ON WEEKEND_OFF
+ *
+ * TIMEZONE is in minutes east of GMT, DST is "eu" or "none". A switch
+ * action is a time "HH:MM" or "sunrise" / "sunset" with an optional offset
+ * in minutes, e.g. "sunset+15". As on the unit, the week program applies
+ * Monday to Thursday, the weekend program Friday to Sunday.
+ *
+ * Binary file, little endian: the header "DDTP", uint16 version (1),
+ * uint16 year, uint16 days, uint32 devices, uint32 records, then per record
+ * uint16 device index, uint16 day of the year (0 based) and uint16 minute
+ * of the day with bit 15 set for on. Each device starts with its state at
+ * 00:00 on the first day.
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "dusk2dawn.h"
+#include "timer.h"
+#include "eventbus.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace dusk_dawn_timer;
+
+namespace {
+
+#define FILE_VERSION 1
+
+struct Device {
+  std::string mName;
+  float mLatitude;
+  float mLongitude;
+  int16_t mTimezone;
+  bool mEuDst;
+  SwitchAction mActions[4]; // Week on, week off, weekend on, weekend off
+};
+
+struct Transition {
+  uint16_t mDay;
+  uint16_t mMinute;
+  bool mOn;
+};
+
+bool parseAction(const std::string& text, SwitchAction& action)
+{
+  int hour, minute, offset = 0;
+  char sign;
+  if (sscanf(text.c_str(), "%d:%d", &hour, &minute) == 2)
+  {
+    if (hour < 0 || hour > 23 || minute < 0 || minute > 59) return false;
+    action = SwitchAction(TIME, hour * MINUTES_PER_HOUR + minute);
+    return true;
+  }
+  uint8_t type;
+  std::string rest;
+  if (text.compare(0, 7, "sunrise") == 0)
+  {
+    type = SUNUP;
+    rest = text.substr(7);
+  }
+  else if (text.compare(0, 6, "sunset") == 0)
+  {
+    type = SUNDOWN;
+    rest = text.substr(6);
+  }
+  else return false;
+  if (!rest.empty())
+  {
+    if (sscanf(rest.c_str(), "%c%d", &sign, &offset) != 2 || (sign != '+' && sign != '-')) return false;
+    if (sign == '-') offset = -offset;
+  }
+  action = SwitchAction(type, offset);
+  return true;
+}
+
+bool loadDevices(const char* path, std::vector<Device>& devices)
+{
+  FILE* in = fopen(path, "r");
+  if (!in)
+  {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return false;
+  }
+  char line[256];
+  int lineNumber = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), in))
+  {
+    lineNumber++;
+    char* comment = strchr(line, '#');
+    if (comment) *comment = '\0';
+    char name[64], dst[8], actions[4][16];
+    Device device;
+    int timezone;
+    const int fields = sscanf(line, "%63s %f %f %d %7s %15s %15s %15s %15s", name, &device.mLatitude,
+                              &device.mLongitude, &timezone, dst, actions[0], actions[1], actions[2], actions[3]);
+    if (fields <= 0) continue;
+    ok = fields == 9 && (strcmp(dst, "eu") == 0 || strcmp(dst, "none") == 0);
+    for (int i = 0; ok && i < 4; ++i) ok = parseAction(actions[i], device.mActions[i]);
+    if (!ok)
+    {
+      fprintf(stderr, "%s:%d: cannot parse the device\n", path, lineNumber);
+      break;
+    }
+    device.mName = name;
+    device.mTimezone = timezone;
+    device.mEuDst = strcmp(dst, "eu") == 0;
+    devices.push_back(device);
+  }
+  fclose(in);
+  return ok;
+}
+
+// Days since 1970-01-01 of the last Sunday of a month
+int32_t lastSunday(int year, unsigned month)
+{
+  const int32_t last = month == 12 ? hal::daysFromCivil(year + 1, 1, 1) - 1 : hal::daysFromCivil(year, month + 1, 1) - 1;
+  return last - (last + 4) % 7; // 1970-01-01 was a Thursday
+}
+
+/*
+ * Steps from switch time to switch time like the time-warp simulator: the
+ * state only changes at the next switch time the timer reports or at
+ * midnight. Daylight saving time is decided per day, a switch between
+ * 2:00 and 3:00 on the change-over Sundays may be off by an hour.
+ */
+void planDevice(const Device& device, int year, std::vector<Transition>& transitions)
+{
+  Dusk2Dawn d2d;
+  d2d.setLocation(device.mLatitude, device.mLongitude, device.mTimezone);
+  Timer timer(nullptr, &d2d);
+  timer.setProgram(device.mActions[0], device.mActions[1], device.mActions[2], device.mActions[3]);
+
+  const int32_t first = hal::daysFromCivil(year, 1, 1);
+  const int32_t days = hal::daysFromCivil(year + 1, 1, 1) - first;
+  const int32_t dstStart = lastSunday(year, 3);
+  const int32_t dstEnd = lastSunday(year, 10);
+  bool switchedOn = false;
+  for (int32_t day = 0; day < days; ++day)
+  {
+    int y;
+    unsigned month, dayOfMonth;
+    hal::civilFromDays(first + day, y, month, dayOfMonth);
+    const bool dst = device.mEuDst && first + day >= dstStart && first + day < dstEnd;
+    d2d.update(y, month, dayOfMonth, dst);
+    const uint8_t dayOfTheWeek = (first + day + 4) % 7;
+    uint16_t minute = 0;
+    while (minute < MINUTES_PER_DAY)
+    {
+      uint16_t next;
+      bool on;
+      timer.evaluate(dayOfTheWeek, minute, next, on);
+      if (transitions.empty() || on != switchedOn)
+      {
+        Transition transition = { static_cast<uint16_t>(day), minute, on };
+        transitions.push_back(transition);
+        switchedOn = on;
+      }
+      minute = next > minute ? next : MINUTES_PER_DAY;
+    }
+  }
+}
+
+void plan(const std::vector<Device>& devices, int year, unsigned threads, std::vector<std::vector<Transition> >& results)
+{
+  results.assign(devices.size(), std::vector<Transition>());
+  std::atomic<size_t> nextDevice(0);
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; ++i)
+  {
+    workers.push_back(std::thread([&]() {
+      for (size_t d = nextDevice++; d < devices.size(); d = nextDevice++) planDevice(devices[d], year, results[d]);
+    }));
+  }
+  for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+}
+
+void write16(FILE* out, uint16_t value)
+{
+  fputc(value & 0xFF, out);
+  fputc(value >> 8, out);
+}
+
+void write32(FILE* out, uint32_t value)
+{
+  write16(out, value & 0xFFFF);
+  write16(out, value >> 16);
+}
+
+bool writeBinary(const char* path, int year, const std::vector<std::vector<Transition> >& results)
+{
+  FILE* out = fopen(path, "wb");
+  if (!out) return false;
+  uint32_t records = 0;
+  for (size_t d = 0; d < results.size(); ++d) records += results[d].size();
+  fwrite("DDTP", 1, 4, out);
+  write16(out, FILE_VERSION);
+  write16(out, year);
+  write16(out, hal::daysFromCivil(year + 1, 1, 1) - hal::daysFromCivil(year, 1, 1));
+  write32(out, results.size());
+  write32(out, records);
+  for (size_t d = 0; d < results.size(); ++d)
+  {
+    for (size_t i = 0; i < results[d].size(); ++i)
+    {
+      const Transition& transition = results[d][i];
+      write16(out, d);
+      write16(out, transition.mDay);
+      write16(out, transition.mMinute | (transition.mOn ? 0x8000 : 0));
+    }
+  }
+  return fclose(out) == 0;
+}
+
+bool writeCsv(const char* path, int year, const std::vector<Device>& devices, const std::vector<std::vector<Transition> >& results)
+{
+  FILE* out = fopen(path, "w");
+  if (!out) return false;
+  fprintf(out, "device,date,time,state\n");
+  const int32_t first = hal::daysFromCivil(year, 1, 1);
+  for (size_t d = 0; d < results.size(); ++d)
+  {
+    for (size_t i = 0; i < results[d].size(); ++i)
+    {
+      const Transition& transition = results[d][i];
+      int y;
+      unsigned month, day;
+      hal::civilFromDays(first + transition.mDay, y, month, day);
+      fprintf(out, "%s,%04d-%02u-%02u,%02u:%02u,%s\n", devices[d].mName.c_str(), y, month, day,
+              transition.mMinute / MINUTES_PER_HOUR, transition.mMinute % MINUTES_PER_HOUR, transition.mOn ? "on" : "off");
+    }
+  }
+  return fclose(out) == 0;
+}
+
+double timedPlan(const std::vector<Device>& devices, int year, unsigned threads, std::vector<std::vector<Transition> >& results)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  plan(devices, year, threads, results);
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void usage(const char* program)
+{
+  fprintf(stderr, "Usage: %s [--year YYYY] [--threads N] [--out FILE] [--csv FILE] [--bench] DEVICES\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  int year = 2019;
+  unsigned threads = std::thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+  const char* binaryPath = nullptr;
+  const char* csvPath = nullptr;
+  const char* devicesPath = nullptr;
+  bool bench = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string option(argv[i]);
+    if (option == "--year" && i + 1 < argc) year = atoi(argv[++i]);
+    else if (option == "--threads" && i + 1 < argc) threads = atoi(argv[++i]);
+    else if (option == "--out" && i + 1 < argc) binaryPath = argv[++i];
+    else if (option == "--csv" && i + 1 < argc) csvPath = argv[++i];
+    else if (option == "--bench") bench = true;
+    else if (option[0] != '-' && !devicesPath) devicesPath = argv[i];
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (!devicesPath || threads == 0 || year < 2000 || year > 2099)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<Device> devices;
+  if (!loadDevices(devicesPath, devices)) return 1;
+  if (EventBus::getSubscriberCount() != 0)
+  {
+    // A handler would run on every worker thread at once
+    fprintf(stderr, "The event bus has subscribers, the threads would share them\n");
+    return 1;
+  }
+  std::vector<std::vector<Transition> > results;
+
+  if (bench)
+  {
+    printf("%7s %9s %11s %16s %8s\n", "threads", "devices", "seconds", "device-years/s", "speedup");
+    double single = 0;
+    for (unsigned n = 1; ; n = n * 2 > threads && n < threads ? threads : n * 2)
+    {
+      const double seconds = timedPlan(devices, year, n, results);
+      if (n == 1) single = seconds;
+      printf("%7u %9zu %11.4f %16.0f %8.2f\n", n, devices.size(), seconds, devices.size() / seconds, single / seconds);
+      if (n >= threads) break;
+    }
+  }
+  else
+  {
+    const double seconds = timedPlan(devices, year, threads, results);
+    size_t records = 0;
+    for (size_t d = 0; d < results.size(); ++d) records += results[d].size();
+    fprintf(stderr, "%zu devices, %zu transitions, %u threads, %.3f s\n", devices.size(), records, threads, seconds);
+  }
+
+  if (binaryPath && !writeBinary(binaryPath, year, results))
+  {
+    fprintf(stderr, "Cannot write %s\n", binaryPath);
+    return 1;
+  }
+  if (csvPath && !writeCsv(csvPath, year, devices, results))
+  {
+    fprintf(stderr, "Cannot write %s\n", csvPath);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Host stand-in for Arduino.h
+ *
+ * Just enough of the Arduino core to compile the sketch modules unchanged on
+ * a developer machine. Time is virtual: it only moves when the host program
+ * (or a fake peripheral, e.g. an EEPROM write) advances it.
+ */
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+#include "binary.h"
+#include "avr/pgmspace.h"
+#include "avr/interrupt.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define NUM_DIGITAL_PINS 22
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#define PI 3.1415926535897932384626433832795
+#define F_CPU 16000000UL
+
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode);
+void detachInterrupt(uint8_t interrupt);
+
+class String {
+public:
+  String(const char* value = "") : mValue(value ? value : "") {}
+  String(const __FlashStringHelper* value) : mValue(reinterpret_cast<const char*>(value)) {}
+  String(const std::string& value) : mValue(value) {}
+  explicit String(char value) : mValue(1, value) {}
+  String(int value) : mValue(std::to_string(value)) {}
+  String(unsigned int value) : mValue(std::to_string(value)) {}
+  String(long value) : mValue(std::to_string(value)) {}
+  String(unsigned long value) : mValue(std::to_string(value)) {}
+
+  String& operator+=(const String& other) { mValue += other.mValue; return *this; }
+  friend String operator+(const String& lhs, const String& rhs) { return String(lhs.mValue + rhs.mValue); }
+  bool operator==(const String& other) const { return mValue == other.mValue; }
+
+  const char* c_str() const { return mValue.c_str(); }
+  unsigned int length() const { return mValue.length(); }
+
+private:
+  std::string mValue;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* str) { return str ? write(reinterpret_cast<const uint8_t*>(str), strlen(str)) : 0; }
+
+  size_t print(const __FlashStringHelper* str) { return write(reinterpret_cast<const char*>(str)); }
+  size_t print(const String& str) { return write(str.c_str()); }
+  size_t print(const char* str) { return write(str); }
+  size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+  size_t print(unsigned char value, int base = DEC) { return print(static_cast<unsigned long>(value), base); }
+  size_t print(int value, int base = DEC) { return print(static_cast<long>(value), base); }
+  size_t print(unsigned int value, int base = DEC) { return print(static_cast<unsigned long>(value), base); }
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+  template <typename T> size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud) { mBaud = baud; }
+  void end() {}
+  int available();
+  int read();
+  int peek();
+  int availableForWrite();
+  void flush() {}
+  size_t write(uint8_t c) override;
+  using Print::write;
+  operator bool() const { return true; }
+private:
+  unsigned long mBaud = 0;
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,35 @@
+/*
+ * Host stand-in for the Arduino EEPROM library
+ *
+ * 1 KB image like the ATmega328. Every byte that is really programmed costs
+ * 3.3 ms of virtual time, so the price of a write shows up in timings.
+ */
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <stdint.h>
+
+class EEPROMClass {
+public:
+  uint8_t read(int address);
+  void write(int address, uint8_t value);
+  void update(int address, uint8_t value);
+  uint16_t length() { return 1024; }
+
+  template <typename T> T& get(int address, T& value)
+  {
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&value);
+    for (unsigned int i = 0; i < sizeof(T); ++i) bytes[i] = read(address + i);
+    return value;
+  }
+  template <typename T> const T& put(int address, const T& value)
+  {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    for (unsigned int i = 0; i < sizeof(T); ++i) update(address + i, bytes[i]);
+    return value;
+  }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // HOST_EEPROM_H
@@ -0,0 +1,82 @@
+/*
+ * Host stand-in for the SSD1306Ascii library by Bill Greiman
+ *
+ * Implements the text API the sketch uses and produces the same kind of
+ * command/data stream as the real library (cursor commands per glyph row,
+ * one RAM byte per column). The bytes go to the SSD1306 emulator returned by
+ * hostDisplay().
+ */
+#ifndef HOST_SSD1306ASCII_H
+#define HOST_SSD1306ASCII_H
+
+#include "Arduino.h"
+#include "ssd1306emu.h"
+
+#define SSD1306_MODE_CMD 0
+#define SSD1306_MODE_RAM 1
+#define SSD1306_MODE_RAM_BUF 2
+
+#define SSD1306_SETCONTRAST 0x81
+#define SSD1306_DISPLAYOFF 0xAE
+#define SSD1306_DISPLAYON 0xAF
+#define SSD1306_CHARGEPUMP 0x8D
+#define SSD1306_SETLOWCOLUMN 0x00
+#define SSD1306_SETHIGHCOLUMN 0x10
+#define SSD1306_SETSTARTPAGE 0xB0
+
+struct DevType {
+  const uint8_t* initcmds;
+  uint8_t initSize;
+  uint8_t lcdWidth;
+  uint8_t lcdHeight;
+  uint8_t colOffset;
+};
+
+extern const DevType Adafruit128x64;
+extern const DevType SH1106_128x64;
+extern const uint8_t System5x7[];
+
+// The emulated panel behind every SSD1306Ascii instance.
+Ssd1306Emulator& hostDisplay();
+
+class SSD1306Ascii : public Print {
+public:
+  void clear();
+  void clear(uint8_t c0, uint8_t c1, uint8_t r0, uint8_t r1);
+  void clearToEOL();
+  void home() { setCursor(0, 0); }
+  void setCursor(uint8_t col, uint8_t row);
+  void setCol(uint8_t col) { setCursor(col, mRow); }
+  void setRow(uint8_t row) { setCursor(mCol, row); }
+  uint8_t col() const { return mCol; }
+  uint8_t row() const { return mRow; }
+  uint8_t displayWidth() const { return mWidth; }
+  uint8_t displayRows() const { return mHeight / 8; }
+  void setFont(const uint8_t* font) { mFont = font; }
+  void set1X() { mMagFactor = 1; }
+  void set2X() { mMagFactor = 2; }
+  void setInvertMode(bool mode) { mInvertMask = mode ? 0xFF : 0; }
+  void invertDisplay(bool invert) { ssd1306WriteCmd(invert ? 0xA7 : 0xA6); }
+  void setContrast(uint8_t value);
+  void ssd1306WriteCmd(uint8_t c) { writeDisplay(c, SSD1306_MODE_CMD); }
+  void ssd1306WriteRam(uint8_t c);
+  void ssd1306WriteRamBuf(uint8_t c) { ssd1306WriteRam(c); }
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+protected:
+  void init(const DevType* dev);
+  virtual void writeDisplay(uint8_t b, uint8_t mode) = 0;
+
+private:
+  const uint8_t* mFont = nullptr;
+  uint8_t mCol = 0;
+  uint8_t mRow = 0;
+  uint8_t mWidth = 128;
+  uint8_t mHeight = 64;
+  uint8_t mColOffset = 0;
+  uint8_t mMagFactor = 1;
+  uint8_t mInvertMask = 0;
+};
+
+#endif // HOST_SSD1306ASCII_H
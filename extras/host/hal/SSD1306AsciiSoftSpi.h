@@ -0,0 +1,25 @@
+/*
+ * Host stand-in for SSD1306AsciiSoftSpi: the "SPI bus" feeds the emulator.
+ */
+#ifndef HOST_SSD1306ASCIISOFTSPI_H
+#define HOST_SSD1306ASCIISOFTSPI_H
+
+#include "SSD1306Ascii.h"
+
+class SSD1306AsciiSoftSpi : public SSD1306Ascii {
+public:
+  void begin(const DevType* dev, uint8_t cs, uint8_t dc, uint8_t clk, uint8_t data, uint8_t rst = 255)
+  {
+    (void) cs; (void) dc; (void) clk; (void) data; (void) rst;
+    hostDisplay().reset();
+    init(dev);
+  }
+
+protected:
+  void writeDisplay(uint8_t b, uint8_t mode) override
+  {
+    hostDisplay().feed(b, mode != SSD1306_MODE_CMD);
+  }
+};
+
+#endif // HOST_SSD1306ASCIISOFTSPI_H
@@ -0,0 +1,25 @@
+/*
+ * Host stand-in for SSD1306AsciiWire: the "I2C bus" feeds the emulator.
+ */
+#ifndef HOST_SSD1306ASCIIWIRE_H
+#define HOST_SSD1306ASCIIWIRE_H
+
+#include "SSD1306Ascii.h"
+
+class SSD1306AsciiWire : public SSD1306Ascii {
+public:
+  void begin(const DevType* dev, uint8_t i2cAddr, uint8_t rst = 255)
+  {
+    (void) i2cAddr; (void) rst;
+    hostDisplay().reset();
+    init(dev);
+  }
+
+protected:
+  void writeDisplay(uint8_t b, uint8_t mode) override
+  {
+    hostDisplay().feed(b, mode != SSD1306_MODE_CMD);
+  }
+};
+
+#endif // HOST_SSD1306ASCIIWIRE_H
@@ -0,0 +1,35 @@
+/*
+ * Host stand-in for the Arduino Wire (I2C) library
+ *
+ * Transactions are routed to simulated devices; see hal.h.
+ */
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <stdint.h>
+
+class TwoWire {
+public:
+  void begin() {}
+  void setClock(uint32_t frequency) { (void) frequency; }
+  void beginTransmission(uint8_t address);
+  void beginTransmission(int address) { beginTransmission(static_cast<uint8_t>(address)); }
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  uint8_t requestFrom(int address, int quantity) { return requestFrom(static_cast<uint8_t>(address), static_cast<uint8_t>(quantity)); }
+  size_t write(uint8_t value);
+  int available();
+  int read();
+
+private:
+  uint8_t mAddress = 0;
+  uint8_t mTxBuffer[32];
+  uint8_t mTxLength = 0;
+  uint8_t mRxBuffer[32];
+  uint8_t mRxLength = 0;
+  uint8_t mRxIndex = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for avr/interrupt.h
+ *
+ * Interrupt vectors become plain functions that the host program calls to
+ * simulate the hardware event, e.g. PCINT2_vect().
+ */
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include "io.h"
+
+#define ISR(vector, ...) extern "C" void vector(void); void vector(void)
+
+inline void cli() {}
+inline void sei() {}
+
+#endif // HOST_AVR_INTERRUPT_H
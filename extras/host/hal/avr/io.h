@@ -0,0 +1,73 @@
+/*
+ * Host stand-in for avr/io.h: the few ATmega328 registers the sketch touches.
+ *
+ * The host delivers PCINT2_vect on pin changes of port D,
+ * TIMER2_COMPA_vect at the Timer2 CTC rate and ADC_vect at the conversion
+ * rate of the ADC in free running mode, see hal.cpp. WDT_vect is raised by
+ * hal::watchdogExpire(). Timer1 is only there for the benchmark build; it
+ * does not count, the host has no cycles to count.
+ */
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+extern volatile uint8_t PIND;
+extern volatile uint8_t MCUSR;
+
+// Watchdog
+extern volatile uint8_t WDTCSR;
+#define WDE 3
+#define WDCE 4
+#define WDIE 6
+
+// Pin change interrupts
+extern volatile uint8_t PCICR;
+extern volatile uint8_t PCIFR;
+extern volatile uint8_t PCMSK2;
+#define PCIE2 2
+#define PCIF2 2
+
+// Timer2
+extern volatile uint8_t TCCR2A;
+extern volatile uint8_t TCCR2B;
+extern volatile uint8_t TCNT2;
+extern volatile uint8_t OCR2A;
+extern volatile uint8_t TIMSK2;
+extern volatile uint8_t TIFR2;
+#define WGM21 1
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define OCIE2A 1
+#define OCF2A 1
+
+// Timer1
+extern volatile uint8_t TCCR1A;
+extern volatile uint8_t TCCR1B;
+extern volatile uint16_t TCNT1;
+extern volatile uint8_t TIMSK1;
+extern volatile uint8_t TIFR1;
+#define CS10 0
+#define TOIE1 0
+#define TOV1 0
+
+// ADC, only free running mode; the inputs are set with hal::setAnalogInput()
+extern volatile uint8_t ADMUX;
+extern volatile uint8_t ADCSRA;
+extern volatile uint8_t ADCSRB;
+extern volatile uint8_t DIDR0;
+extern volatile uint16_t ADC;
+#define REFS0 6
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+
+#endif // HOST_AVR_IO_H
@@ -0,0 +1,29 @@
+/*
+ * Host stand-in for avr/pgmspace.h: flash and RAM share one address space.
+ */
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+
+#define pgm_read_byte(address) (*reinterpret_cast<const uint8_t*>(address))
+// Tables of pointers are read with pgm_read_word on the AVR; on the host a
+// pointer does not fit in 16 bits, so simply dereference the typed address.
+#define pgm_read_word(address) (*(address))
+#define pgm_read_dword(address) (*(address))
+#define pgm_read_float(address) (*(address))
+
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define snprintf_P snprintf
+#define sprintf_P sprintf
+
+#endif // HOST_AVR_PGMSPACE_H
@@ -0,0 +1,26 @@
+/*
+ * Host stand-in for avr/sleep.h
+ *
+ * sleep_cpu() lets virtual time run until the next interrupt: the timer 0
+ * overflow every 1.024 ms at the latest, earlier pin changes or Timer2
+ * ticks are delivered on the way.
+ */
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+#include <stdint.h>
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_ADC 1
+#define SLEEP_MODE_PWR_DOWN 2
+#define SLEEP_MODE_PWR_SAVE 3
+#define SLEEP_MODE_STANDBY 6
+#define SLEEP_MODE_EXT_STANDBY 7
+
+inline void set_sleep_mode(uint8_t mode) { (void) mode; }
+inline void sleep_enable() {}
+inline void sleep_disable() {}
+void sleep_cpu();
+inline void sleep_mode() { sleep_cpu(); }
+
+#endif // HOST_AVR_SLEEP_H
@@ -0,0 +1,509 @@
+/*
+ * Host implementations of the Arduino core, EEPROM, Wire (with a simulated
+ * DS3231) and the watchdog, all driven by one virtual clock.
+ */
+#include "hal.h"
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "Wire.h"
+#include "avr/wdt.h"
+#include "avr/sleep.h"
+
+#include <stdio.h>
+#include <deque>
+
+#define EEPROM_WRITE_TIME_US 3300
+#define DS3231_ADDRESS 0x68
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+TwoWire Wire;
+
+volatile uint8_t PIND = 0xFF;
+volatile uint8_t MCUSR = 0;
+volatile uint8_t WDTCSR = 0;
+volatile uint8_t PCICR = 0;
+volatile uint8_t PCIFR = 0;
+volatile uint8_t PCMSK2 = 0;
+volatile uint8_t TCCR2A = 0;
+volatile uint8_t TCCR2B = 0;
+volatile uint8_t TCNT2 = 0;
+volatile uint8_t OCR2A = 0;
+volatile uint8_t TIMSK2 = 0;
+volatile uint8_t TIFR2 = 0;
+volatile uint8_t TCCR1A = 0;
+volatile uint8_t TCCR1B = 0;
+volatile uint16_t TCNT1 = 0;
+volatile uint8_t TIMSK1 = 0;
+volatile uint8_t TIFR1 = 0;
+volatile uint8_t ADMUX = 0;
+volatile uint8_t ADCSRA = 0;
+volatile uint8_t ADCSRB = 0;
+volatile uint8_t DIDR0 = 0;
+volatile uint16_t ADC = 0;
+
+// Interrupt handlers the sketch may define
+extern "C" void PCINT2_vect(void) __attribute__((weak));
+extern "C" void TIMER2_COMPA_vect(void) __attribute__((weak));
+extern "C" void WDT_vect(void) __attribute__((weak));
+extern "C" void ADC_vect(void) __attribute__((weak));
+
+namespace {
+
+uint64_t sMicros = 0;
+uint64_t sNextTimer2Tick = 0;
+uint64_t sNextConversion = 0;
+uint16_t sAnalogInputs[8];
+
+uint8_t sPinMode[NUM_DIGITAL_PINS];
+uint8_t sPinState[NUM_DIGITAL_PINS];
+hal::PinListener sPinListener = nullptr;
+hal::SleepHandler sSleepHandler = nullptr;
+void (*sInterrupts[2])() = { nullptr, nullptr };
+
+uint8_t sEeprom[1024];
+unsigned long sEepromWrites = 0;
+bool sEepromErased = false;
+
+std::deque<uint8_t> sSerialInput;
+std::string sSerialOutput;
+bool sSerialEcho = false;
+
+// DS3231: time keeps running from the moment it was set
+int64_t sRtcSecondsAtSet = 0; // seconds since 2000-01-01 00:00
+uint64_t sRtcMicrosAtSet = 0;
+uint8_t sRtcStatus = 0x80;    // OSF set: "lost power" on first boot
+uint8_t sRtcControl = 0x1C;
+uint8_t sRtcPointer = 0;
+unsigned long sI2cTransactions = 0;
+
+uint8_t bin2bcd(uint8_t value) { return value + 6 * (value / 10); }
+uint8_t bcd2bin(uint8_t value) { return value - 6 * (value >> 4); }
+
+int64_t rtcSeconds()
+{
+  return sRtcSecondsAtSet + static_cast<int64_t>((sMicros - sRtcMicrosAtSet) / 1000000);
+}
+
+void rtcSetSeconds(int64_t seconds)
+{
+  sRtcSecondsAtSet = seconds;
+  sRtcMicrosAtSet = sMicros;
+}
+
+uint8_t rtcRegister(uint8_t reg)
+{
+  const int64_t seconds = rtcSeconds();
+  const int32_t days = static_cast<int32_t>(seconds / 86400);
+  const int32_t secondOfDay = static_cast<int32_t>(seconds % 86400);
+  int year;
+  unsigned month, day;
+  hal::civilFromDays(days + hal::daysFromCivil(2000, 1, 1), year, month, day);
+  switch (reg)
+  {
+    case 0: return bin2bcd(secondOfDay % 60);
+    case 1: return bin2bcd((secondOfDay / 60) % 60);
+    case 2: return bin2bcd(secondOfDay / 3600);
+    case 3: return ((days + 6) % 7) + 1; // 2000-01-01 was a Saturday
+    case 4: return bin2bcd(day);
+    case 5: return bin2bcd(month);
+    case 6: return bin2bcd(year - 2000);
+    case 0x0E: return sRtcControl;
+    case 0x0F: return sRtcStatus;
+  }
+  return 0;
+}
+
+void rtcWrite(uint8_t reg, const uint8_t* values, uint8_t count)
+{
+  if (reg == 0 && count >= 7)
+  {
+    uint8_t second = bcd2bin(values[0]);
+    uint8_t minute = bcd2bin(values[1]);
+    uint8_t hour = bcd2bin(values[2] & 0x3F);
+    uint8_t day = bcd2bin(values[4]);
+    uint8_t month = bcd2bin(values[5] & 0x1F);
+    uint16_t year = bcd2bin(values[6]) + 2000;
+    hal::rtcSet(year, month, day, hour, minute, second);
+    sRtcStatus |= 0x80; // Like the real chip, only clearing the OSF bit resets it
+    return;
+  }
+  for (uint8_t i = 0; i < count; ++i)
+  {
+    if (reg + i == 0x0E) sRtcControl = values[i];
+    else if (reg + i == 0x0F) sRtcStatus = values[i];
+  }
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+// Arduino core
+
+unsigned long millis() { return static_cast<unsigned long>(sMicros / 1000); }
+unsigned long micros() { return static_cast<unsigned long>(sMicros); }
+void delay(unsigned long ms) { hal::advanceMicros(static_cast<uint64_t>(ms) * 1000); }
+void delayMicroseconds(unsigned int us) { hal::advanceMicros(us); }
+
+// Idle until the next timer 0 overflow, which fires every 1024 us, unless a
+// host program decides when the sketch wakes up
+void sleep_cpu()
+{
+  uint64_t wake = sMicros + 1024 - sMicros % 1024;
+  if (sSleepHandler) wake = sSleepHandler(sMicros);
+  if (wake > sMicros) hal::advanceMicros(wake - sMicros);
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (pin >= NUM_DIGITAL_PINS) return;
+  sPinMode[pin] = mode;
+  if (mode == INPUT_PULLUP) sPinState[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  if (pin >= NUM_DIGITAL_PINS) return;
+  value = value ? HIGH : LOW;
+  bool changed = sPinState[pin] != value;
+  sPinState[pin] = value;
+  if (changed && sPinListener) sPinListener(pin, value);
+}
+
+int digitalRead(uint8_t pin)
+{
+  if (pin < 8) return (PIND >> pin) & 1;
+  return pin < NUM_DIGITAL_PINS ? sPinState[pin] : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+  if (pin >= A0) pin -= A0;
+  return pin < 8 ? sAnalogInputs[pin] : 0;
+}
+
+void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode)
+{
+  (void) mode;
+  if (interrupt < 2) sInterrupts[interrupt] = isr;
+}
+
+void detachInterrupt(uint8_t interrupt)
+{
+  if (interrupt < 2) sInterrupts[interrupt] = nullptr;
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+  size_t n = 0;
+  while (size--) n += write(*buffer++);
+  return n;
+}
+
+size_t Print::print(long value, int base)
+{
+  if (value < 0 && base == DEC) return print('-') + print(static_cast<unsigned long>(-value), base);
+  return print(static_cast<unsigned long>(value), base);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+  char buffer[8 * sizeof(long) + 1];
+  char* str = &buffer[sizeof(buffer) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do
+  {
+    unsigned long digit = value % base;
+    value /= base;
+    *--str = digit < 10 ? '0' + digit : 'A' + digit - 10;
+  } while (value);
+  return write(str);
+}
+
+size_t Print::print(double value, int digits)
+{
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+  return write(buffer);
+}
+
+int HardwareSerial::available() { return static_cast<int>(sSerialInput.size()); }
+
+int HardwareSerial::read()
+{
+  if (sSerialInput.empty()) return -1;
+  int value = sSerialInput.front();
+  sSerialInput.pop_front();
+  return value;
+}
+
+int HardwareSerial::peek() { return sSerialInput.empty() ? -1 : sSerialInput.front(); }
+
+int HardwareSerial::availableForWrite() { return 63; }
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  sSerialOutput.push_back(static_cast<char>(c));
+  if (sSerialEcho) fputc(c, stdout);
+  return 1;
+}
+
+void wdt_enable(uint8_t timeout) { (void) timeout; WDTCSR = _BV(WDE); }
+void wdt_disable() { WDTCSR = 0; }
+void wdt_reset() {}
+
+////////////////////////////////////////////////////////////////////////////////
+// EEPROM
+
+uint8_t EEPROMClass::read(int address)
+{
+  if (!sEepromErased) hal::eepromErase();
+  return sEeprom[address & 0x3FF];
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+  if (!sEepromErased) hal::eepromErase();
+  sEeprom[address & 0x3FF] = value;
+  sEepromWrites++;
+  sMicros += EEPROM_WRITE_TIME_US;
+}
+
+void EEPROMClass::update(int address, uint8_t value)
+{
+  if (read(address) != value) write(address, value);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Wire
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+  mAddress = address;
+  mTxLength = 0;
+}
+
+size_t TwoWire::write(uint8_t value)
+{
+  if (mTxLength >= sizeof(mTxBuffer)) return 0;
+  mTxBuffer[mTxLength++] = value;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+  (void) stop;
+  sI2cTransactions++;
+  if (mAddress != DS3231_ADDRESS) return 2; // NACK on address
+  if (mTxLength > 0)
+  {
+    sRtcPointer = mTxBuffer[0];
+    if (mTxLength > 1) rtcWrite(sRtcPointer, mTxBuffer + 1, mTxLength - 1);
+  }
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+  sI2cTransactions++;
+  mRxIndex = 0;
+  mRxLength = 0;
+  if (address != DS3231_ADDRESS) return 0;
+  if (quantity > sizeof(mRxBuffer)) quantity = sizeof(mRxBuffer);
+  for (uint8_t i = 0; i < quantity; ++i) mRxBuffer[i] = rtcRegister(sRtcPointer + i);
+  mRxLength = quantity;
+  return quantity;
+}
+
+int TwoWire::available() { return mRxLength - mRxIndex; }
+
+int TwoWire::read()
+{
+  if (mRxIndex >= mRxLength) return -1;
+  return mRxBuffer[mRxIndex++];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Host control plane
+
+namespace hal {
+
+uint64_t nowMicros() { return sMicros; }
+
+// Timer2 compare match period in CTC mode, 0 when stopped
+static uint64_t timer2Period()
+{
+  static const uint16_t prescalers[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+  const uint16_t prescaler = prescalers[TCCR2B & 0x07];
+  return prescaler * (OCR2A + 1ULL) * 1000000ULL / F_CPU;
+}
+
+// ADC conversion time (13 ADC clocks) in free running mode, 0 when stopped
+static uint64_t adcPeriod()
+{
+  const uint8_t running = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE);
+  if (!ADC_vect || (ADCSRA & running) != running || (ADCSRB & 0x07) != 0) return 0;
+  const uint8_t prescaler = 1 << ((ADCSRA & 0x07) ? (ADCSRA & 0x07) : 1);
+  return prescaler * 13ULL * 1000000ULL / F_CPU;
+}
+
+void advanceMicros(uint64_t us)
+{
+  const uint64_t end = sMicros + us;
+  // Deliver the Timer2 compare and ADC interrupts that fall in this period,
+  // in the order they occur
+  for (;;)
+  {
+    const bool timer2 = TIMER2_COMPA_vect && (TIMSK2 & _BV(OCIE2A)) && timer2Period() > 0;
+    const bool adc = adcPeriod() > 0;
+    if (timer2 && sNextTimer2Tick <= sMicros) sNextTimer2Tick = sMicros + timer2Period();
+    if (adc && sNextConversion <= sMicros) sNextConversion = sMicros + adcPeriod();
+    uint64_t next = end + 1;
+    if (timer2 && sNextTimer2Tick < next) next = sNextTimer2Tick;
+    if (adc && sNextConversion < next) next = sNextConversion;
+    if (next > end) break;
+    sMicros = next;
+    if (timer2 && sNextTimer2Tick == next)
+    {
+      sNextTimer2Tick += timer2Period();
+      TIMER2_COMPA_vect();
+    }
+    if (adc && sNextConversion == next)
+    {
+      sNextConversion += adcPeriod();
+      ADC = sAnalogInputs[ADMUX & 0x07];
+      ADC_vect();
+    }
+  }
+  sMicros = end;
+}
+
+void setPinListener(PinListener listener) { sPinListener = listener; }
+void setSleepHandler(SleepHandler handler) { sSleepHandler = handler; }
+
+void setInputPin(uint8_t pin, uint8_t value)
+{
+  if (pin < 8)
+  {
+    const uint8_t before = PIND;
+    if (value) PIND = PIND | (1 << pin);
+    else PIND = PIND & ~(1 << pin);
+    if (PIND != before && PCINT2_vect && (PCICR & _BV(PCIE2)) && (PCMSK2 & (1 << pin)))
+    {
+      PCINT2_vect();
+    }
+  }
+  else if (pin < NUM_DIGITAL_PINS)
+  {
+    sPinState[pin] = value;
+  }
+}
+
+uint8_t pinState(uint8_t pin) { return pin < NUM_DIGITAL_PINS ? sPinState[pin] : LOW; }
+
+void setAnalogInput(uint8_t channel, uint16_t value)
+{
+  if (channel < 8) sAnalogInputs[channel] = value > 1023 ? 1023 : value;
+}
+
+void fireInterrupt(uint8_t interrupt)
+{
+  if (interrupt < 2 && sInterrupts[interrupt]) sInterrupts[interrupt]();
+}
+
+bool watchdogExpire()
+{
+  if (WDTCSR & _BV(WDIE))
+  {
+    // Interrupt and system reset mode: the hardware clears WDIE, the next
+    // timeout resets
+    WDTCSR = WDTCSR & ~_BV(WDIE);
+    if (WDT_vect) WDT_vect();
+    return false;
+  }
+  return (WDTCSR & _BV(WDE)) != 0;
+}
+
+uint8_t* eepromImage()
+{
+  if (!sEepromErased) eepromErase();
+  return sEeprom;
+}
+
+void eepromErase(uint8_t value)
+{
+  memset(sEeprom, value, sizeof(sEeprom));
+  sEepromErased = true;
+}
+
+unsigned long eepromWriteCount() { return sEepromWrites; }
+
+void rtcSet(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second)
+{
+  int64_t days = daysFromCivil(year, month, day) - daysFromCivil(2000, 1, 1);
+  rtcSetSeconds(days * 86400 + hour * 3600 + minute * 60 + second);
+  sRtcStatus &= ~0x80;
+}
+
+void rtcGet(uint16_t& year, uint8_t& month, uint8_t& day, uint8_t& hour, uint8_t& minute, uint8_t& second)
+{
+  const int64_t seconds = rtcSeconds();
+  int y;
+  unsigned m, d;
+  civilFromDays(static_cast<int32_t>(seconds / 86400) + daysFromCivil(2000, 1, 1), y, m, d);
+  year = y;
+  month = m;
+  day = d;
+  hour = (seconds % 86400) / 3600;
+  minute = (seconds % 3600) / 60;
+  second = seconds % 60;
+}
+
+void rtcSetLostPower(bool lostPower)
+{
+  if (lostPower) sRtcStatus |= 0x80;
+  else sRtcStatus &= ~0x80;
+}
+
+unsigned long i2cTransactionCount() { return sI2cTransactions; }
+
+void serialInject(const uint8_t* data, size_t size)
+{
+  sSerialInput.insert(sSerialInput.end(), data, data + size);
+}
+
+std::string serialTakeOutput()
+{
+  std::string output;
+  output.swap(sSerialOutput);
+  return output;
+}
+
+void setSerialEcho(bool echo) { sSerialEcho = echo; }
+
+// Days since 1970-01-01, after Howard Hinnant's civil calendar algorithms
+int32_t daysFromCivil(int year, unsigned month, unsigned day)
+{
+  year -= month <= 2;
+  const int era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(year - era * 400);
+  const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int32_t>(doe) - 719468;
+}
+
+void civilFromDays(int32_t days, int& year, unsigned& month, unsigned& day)
+{
+  days += 719468;
+  const int era = (days >= 0 ? days : days - 146096) / 146097;
+  const unsigned doe = static_cast<unsigned>(days - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  day = doy - (153 * mp + 2) / 5 + 1;
+  month = mp < 10 ? mp + 3 : mp - 9;
+  year = static_cast<int>(yoe) + era * 400 + (month <= 2);
+}
+
+} // namespace hal
@@ -0,0 +1,61 @@
+/*
+ * Host control plane for the fake Arduino environment
+ *
+ * The sketch modules only see Arduino.h, Wire.h, EEPROM.h and SSD1306Ascii.
+ * Host programs use the functions below to drive time, inputs and the
+ * simulated peripherals behind those headers.
+ */
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+namespace hal {
+
+// Virtual time
+uint64_t nowMicros();
+void advanceMicros(uint64_t us);
+inline void advanceMillis(uint64_t ms) { advanceMicros(ms * 1000); }
+// Returns the time sleep_cpu() wakes up at, given the time it was called;
+// without a handler every sleep ends at the next timer 0 overflow.
+typedef uint64_t (*SleepHandler)(uint64_t now);
+void setSleepHandler(SleepHandler handler);
+
+// GPIO
+typedef void (*PinListener)(uint8_t pin, uint8_t value);
+void setPinListener(PinListener listener);
+void setInputPin(uint8_t pin, uint8_t value);
+uint8_t pinState(uint8_t pin);
+// Voltage on ADC channel 0-7 (A0-A7) as a conversion result, 0-1023
+void setAnalogInput(uint8_t channel, uint16_t value);
+void fireInterrupt(uint8_t interrupt);
+
+// Watchdog timeout: raises WDT_vect in interrupt mode, returns true when
+// the MCU would reset instead.
+bool watchdogExpire();
+
+// EEPROM
+uint8_t* eepromImage();
+void eepromErase(uint8_t value = 0xFF);
+unsigned long eepromWriteCount();
+
+// DS3231 at I2C address 0x68, running on virtual time
+void rtcSet(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second = 0);
+void rtcGet(uint16_t& year, uint8_t& month, uint8_t& day, uint8_t& hour, uint8_t& minute, uint8_t& second);
+void rtcSetLostPower(bool lostPower);
+unsigned long i2cTransactionCount();
+
+// Serial port
+void serialInject(const uint8_t* data, size_t size);
+std::string serialTakeOutput();
+void setSerialEcho(bool echo);
+
+// Calendar helpers shared by the fakes and the host tools
+int32_t daysFromCivil(int year, unsigned month, unsigned day);
+void civilFromDays(int32_t days, int& year, unsigned& month, unsigned& day);
+
+} // namespace hal
+
+#endif // HOST_HAL_H
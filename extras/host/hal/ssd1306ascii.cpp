@@ -0,0 +1,238 @@
+/*
+ * Host stand-in for the SSD1306Ascii library
+ */
+#include "SSD1306Ascii.h"
+
+static const uint8_t Adafruit128x64init[] = {
+  0xAE,       // display off
+  0xD5, 0x80, // clock divide
+  0xA8, 0x3F, // multiplex 64
+  0xD3, 0x00, // no display offset
+  0x40,       // start line 0
+  0x8D, 0x14, // charge pump on
+  0x20, 0x02, // page addressing mode
+  0xA1,       // segment remap
+  0xC8,       // COM scan direction
+  0xDA, 0x12, // COM pins
+  0x81, 0xCF, // contrast
+  0xD9, 0xF1, // precharge
+  0xDB, 0x40, // VCOM detect
+  0xA4,       // display from RAM
+  0xA6,       // normal, not inverted
+  0xAF        // display on
+};
+
+const DevType Adafruit128x64 = { Adafruit128x64init, sizeof(Adafruit128x64init), 128, 64, 0 };
+const DevType SH1106_128x64 = { Adafruit128x64init, sizeof(Adafruit128x64init), 128, 64, 2 };
+
+// Classic 5x7 font, ASCII 32..127. Header: size (2), width, height, first, count.
+const uint8_t System5x7[] = {
+  0x00, 0x00, 5, 7, 32, 96,
+  0x00, 0x00, 0x00, 0x00, 0x00, // ' '
+  0x00, 0x00, 0x5F, 0x00, 0x00, // !
+  0x00, 0x07, 0x00, 0x07, 0x00, // "
+  0x14, 0x7F, 0x14, 0x7F, 0x14, // #
+  0x24, 0x2A, 0x7F, 0x2A, 0x12, // $
+  0x23, 0x13, 0x08, 0x64, 0x62, // %
+  0x36, 0x49, 0x56, 0x20, 0x50, // &
+  0x00, 0x08, 0x07, 0x03, 0x00, // '
+  0x00, 0x1C, 0x22, 0x41, 0x00, // (
+  0x00, 0x41, 0x22, 0x1C, 0x00, // )
+  0x2A, 0x1C, 0x7F, 0x1C, 0x2A, // *
+  0x08, 0x08, 0x3E, 0x08, 0x08, // +
+  0x00, 0x80, 0x70, 0x30, 0x00, // ,
+  0x08, 0x08, 0x08, 0x08, 0x08, // -
+  0x00, 0x00, 0x60, 0x60, 0x00, // .
+  0x20, 0x10, 0x08, 0x04, 0x02, // /
+  0x3E, 0x51, 0x49, 0x45, 0x3E, // 0
+  0x00, 0x42, 0x7F, 0x40, 0x00, // 1
+  0x72, 0x49, 0x49, 0x49, 0x46, // 2
+  0x21, 0x41, 0x49, 0x4D, 0x33, // 3
+  0x18, 0x14, 0x12, 0x7F, 0x10, // 4
+  0x27, 0x45, 0x45, 0x45, 0x39, // 5
+  0x3C, 0x4A, 0x49, 0x49, 0x31, // 6
+  0x41, 0x21, 0x11, 0x09, 0x07, // 7
+  0x36, 0x49, 0x49, 0x49, 0x36, // 8
+  0x46, 0x49, 0x49, 0x29, 0x1E, // 9
+  0x00, 0x00, 0x14, 0x00, 0x00, // :
+  0x00, 0x40, 0x34, 0x00, 0x00, // ;
+  0x00, 0x08, 0x14, 0x22, 0x41, // <
+  0x14, 0x14, 0x14, 0x14, 0x14, // =
+  0x00, 0x41, 0x22, 0x14, 0x08, // >
+  0x02, 0x01, 0x59, 0x09, 0x06, // ?
+  0x3E, 0x41, 0x5D, 0x59, 0x4E, // @
+  0x7C, 0x12, 0x11, 0x12, 0x7C, // A
+  0x7F, 0x49, 0x49, 0x49, 0x36, // B
+  0x3E, 0x41, 0x41, 0x41, 0x22, // C
+  0x7F, 0x41, 0x41, 0x41, 0x3E, // D
+  0x7F, 0x49, 0x49, 0x49, 0x41, // E
+  0x7F, 0x09, 0x09, 0x09, 0x01, // F
+  0x3E, 0x41, 0x41, 0x51, 0x73, // G
+  0x7F, 0x08, 0x08, 0x08, 0x7F, // H
+  0x00, 0x41, 0x7F, 0x41, 0x00, // I
+  0x20, 0x40, 0x41, 0x3F, 0x01, // J
+  0x7F, 0x08, 0x14, 0x22, 0x41, // K
+  0x7F, 0x40, 0x40, 0x40, 0x40, // L
+  0x7F, 0x02, 0x1C, 0x02, 0x7F, // M
+  0x7F, 0x04, 0x08, 0x10, 0x7F, // N
+  0x3E, 0x41, 0x41, 0x41, 0x3E, // O
+  0x7F, 0x09, 0x09, 0x09, 0x06, // P
+  0x3E, 0x41, 0x51, 0x21, 0x5E, // Q
+  0x7F, 0x09, 0x19, 0x29, 0x46, // R
+  0x26, 0x49, 0x49, 0x49, 0x32, // S
+  0x03, 0x01, 0x7F, 0x01, 0x03, // T
+  0x3F, 0x40, 0x40, 0x40, 0x3F, // U
+  0x1F, 0x20, 0x40, 0x20, 0x1F, // V
+  0x3F, 0x40, 0x38, 0x40, 0x3F, // W
+  0x63, 0x14, 0x08, 0x14, 0x63, // X
+  0x03, 0x04, 0x78, 0x04, 0x03, // Y
+  0x61, 0x59, 0x49, 0x4D, 0x43, // Z
+  0x00, 0x7F, 0x41, 0x41, 0x41, // [
+  0x02, 0x04, 0x08, 0x10, 0x20, // backslash
+  0x00, 0x41, 0x41, 0x41, 0x7F, // ]
+  0x04, 0x02, 0x01, 0x02, 0x04, // ^
+  0x40, 0x40, 0x40, 0x40, 0x40, // _
+  0x00, 0x03, 0x07, 0x08, 0x00, // `
+  0x20, 0x54, 0x54, 0x78, 0x40, // a
+  0x7F, 0x28, 0x44, 0x44, 0x38, // b
+  0x38, 0x44, 0x44, 0x44, 0x28, // c
+  0x38, 0x44, 0x44, 0x28, 0x7F, // d
+  0x38, 0x54, 0x54, 0x54, 0x18, // e
+  0x00, 0x08, 0x7E, 0x09, 0x02, // f
+  0x18, 0xA4, 0xA4, 0x9C, 0x78, // g
+  0x7F, 0x08, 0x04, 0x04, 0x78, // h
+  0x00, 0x44, 0x7D, 0x40, 0x00, // i
+  0x20, 0x40, 0x40, 0x3D, 0x00, // j
+  0x7F, 0x10, 0x28, 0x44, 0x00, // k
+  0x00, 0x41, 0x7F, 0x40, 0x00, // l
+  0x7C, 0x04, 0x78, 0x04, 0x78, // m
+  0x7C, 0x08, 0x04, 0x04, 0x78, // n
+  0x38, 0x44, 0x44, 0x44, 0x38, // o
+  0xFC, 0x18, 0x24, 0x24, 0x18, // p
+  0x18, 0x24, 0x24, 0x18, 0xFC, // q
+  0x7C, 0x08, 0x04, 0x04, 0x08, // r
+  0x48, 0x54, 0x54, 0x54, 0x24, // s
+  0x04, 0x04, 0x3F, 0x44, 0x24, // t
+  0x3C, 0x40, 0x40, 0x20, 0x7C, // u
+  0x1C, 0x20, 0x40, 0x20, 0x1C, // v
+  0x3C, 0x40, 0x30, 0x40, 0x3C, // w
+  0x44, 0x28, 0x10, 0x28, 0x44, // x
+  0x4C, 0x90, 0x90, 0x90, 0x7C, // y
+  0x44, 0x64, 0x54, 0x4C, 0x44, // z
+  0x00, 0x08, 0x36, 0x41, 0x00, // {
+  0x00, 0x00, 0x77, 0x00, 0x00, // |
+  0x00, 0x41, 0x36, 0x08, 0x00, // }
+  0x02, 0x01, 0x02, 0x04, 0x02, // ~
+  0x00, 0x00, 0x00, 0x00, 0x00  // DEL
+};
+
+Ssd1306Emulator& hostDisplay()
+{
+  static Ssd1306Emulator display;
+  return display;
+}
+
+// Doubles every bit of a nibble, used for 2X magnification.
+static uint8_t scaleNibble(uint8_t nibble)
+{
+  uint8_t result = 0;
+  for (uint8_t i = 0; i < 4; ++i)
+  {
+    if (nibble & (1 << i)) result |= 3 << (2 * i);
+  }
+  return result;
+}
+
+void SSD1306Ascii::init(const DevType* dev)
+{
+  mWidth = dev->lcdWidth;
+  mHeight = dev->lcdHeight;
+  mColOffset = dev->colOffset;
+  for (uint8_t i = 0; i < dev->initSize; ++i) ssd1306WriteCmd(dev->initcmds[i]);
+  clear();
+}
+
+void SSD1306Ascii::clear()
+{
+  clear(0, displayWidth() - 1, 0, displayRows() - 1);
+}
+
+void SSD1306Ascii::clear(uint8_t c0, uint8_t c1, uint8_t r0, uint8_t r1)
+{
+  for (uint8_t r = r0; r <= r1; ++r)
+  {
+    setCursor(c0, r);
+    for (uint8_t c = c0; c <= c1; ++c) writeDisplay(mInvertMask, SSD1306_MODE_RAM_BUF);
+  }
+  setCursor(c0, r0);
+}
+
+void SSD1306Ascii::clearToEOL()
+{
+  uint8_t col = mCol;
+  uint8_t row = mRow;
+  clear(col, displayWidth() - 1, row, row + mMagFactor - 1);
+  setCursor(col, row);
+}
+
+void SSD1306Ascii::setCursor(uint8_t col, uint8_t row)
+{
+  if (row >= displayRows()) row = displayRows() - 1;
+  mCol = col;
+  mRow = row;
+  uint8_t column = col + mColOffset;
+  ssd1306WriteCmd(SSD1306_SETLOWCOLUMN | (column & 0x0F));
+  ssd1306WriteCmd(SSD1306_SETHIGHCOLUMN | (column >> 4));
+  ssd1306WriteCmd(SSD1306_SETSTARTPAGE | mRow);
+}
+
+void SSD1306Ascii::setContrast(uint8_t value)
+{
+  ssd1306WriteCmd(SSD1306_SETCONTRAST);
+  ssd1306WriteCmd(value);
+}
+
+void SSD1306Ascii::ssd1306WriteRam(uint8_t c)
+{
+  if (mCol >= mWidth) return;
+  writeDisplay(c ^ mInvertMask, SSD1306_MODE_RAM);
+  mCol++;
+}
+
+size_t SSD1306Ascii::write(uint8_t ch)
+{
+  if (!mFont) return 0;
+  const uint8_t width = mFont[2];
+  const uint8_t first = mFont[4];
+  const uint8_t count = mFont[5];
+  if (ch < first || ch >= first + count)
+  {
+    if (ch == '\r')
+    {
+      setCol(0);
+      return 1;
+    }
+    if (ch == '\n')
+    {
+      setCursor(0, mRow + mMagFactor);
+      return 1;
+    }
+    return 0;
+  }
+  const uint8_t* glyph = mFont + 6 + (ch - first) * width;
+  const uint8_t startCol = mCol;
+  const uint8_t startRow = mRow;
+  for (uint8_t m = 0; m < mMagFactor; ++m)
+  {
+    if (m) setCursor(startCol, startRow + m);
+    for (uint8_t c = 0; c < width; ++c)
+    {
+      uint8_t b = glyph[c];
+      if (mMagFactor == 2) b = scaleNibble(m ? b >> 4 : b & 0x0F);
+      for (uint8_t i = 0; i < mMagFactor; ++i) ssd1306WriteRam(b);
+    }
+    for (uint8_t i = 0; i < mMagFactor; ++i) ssd1306WriteRam(0); // letter spacing
+  }
+  if (mRow != startRow) setCursor(mCol, startRow);
+  return 1;
+}
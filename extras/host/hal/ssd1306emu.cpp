@@ -0,0 +1,201 @@
+/*
+ * SSD1306 controller emulator
+ */
+#include "ssd1306emu.h"
+
+#include <string.h>
+
+#define ADDRESSING_HORIZONTAL 0
+#define ADDRESSING_VERTICAL 1
+#define ADDRESSING_PAGE 2
+
+Ssd1306Emulator::Ssd1306Emulator()
+{
+  reset();
+}
+
+void Ssd1306Emulator::reset()
+{
+  // Power-on state according to the SSD1306 datasheet
+  memset(mRam, 0, sizeof(mRam));
+  mPage = 0;
+  mColumn = 0;
+  mAddressingMode = ADDRESSING_PAGE;
+  mColumnStart = 0;
+  mColumnEnd = WIDTH - 1;
+  mPageStart = 0;
+  mPageEnd = PAGES - 1;
+  mDisplayOn = false;
+  mChargePump = false;
+  mInverted = false;
+  mContrast = 0x7F;
+  mPendingCommand = 0;
+  mPendingArguments = 0;
+  mArgumentIndex = 0;
+  memset(&mFrame, 0, sizeof(mFrame));
+  memset(&mTotal, 0, sizeof(mTotal));
+}
+
+void Ssd1306Emulator::feed(uint8_t value, bool isData)
+{
+  mFrame.mBytes++;
+  mTotal.mBytes++;
+  if (isData)
+  {
+    mFrame.mDataBytes++;
+    mTotal.mDataBytes++;
+    data(value);
+    return;
+  }
+  mFrame.mCommandBytes++;
+  mTotal.mCommandBytes++;
+  if (mPendingArguments > 0)
+  {
+    mArguments[mArgumentIndex++] = value;
+    if (--mPendingArguments == 0) command(mPendingCommand);
+    return;
+  }
+  mFrame.mCommands++;
+  mTotal.mCommands++;
+  mPendingArguments = argumentCount(value);
+  mArgumentIndex = 0;
+  if (mPendingArguments > 0) mPendingCommand = value;
+  else command(value);
+}
+
+void Ssd1306Emulator::markFrame()
+{
+  memset(&mFrame, 0, sizeof(mFrame));
+}
+
+uint8_t Ssd1306Emulator::argumentCount(uint8_t command)
+{
+  switch (command)
+  {
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+      return 1;
+    case 0x21: case 0x22: case 0xA3:
+      return 2;
+    case 0x29: case 0x2A:
+      return 5;
+    case 0x26: case 0x27:
+      return 6;
+  }
+  return 0;
+}
+
+void Ssd1306Emulator::command(uint8_t value)
+{
+  if (value <= 0x0F)
+  {
+    mColumn = (mColumn & 0xF0) | value;
+  }
+  else if (value <= 0x1F)
+  {
+    mColumn = (mColumn & 0x0F) | ((value & 0x07) << 4);
+  }
+  else if (value >= 0xB0 && value <= 0xB7)
+  {
+    mPage = value & 0x07;
+  }
+  else
+  {
+    switch (value)
+    {
+      case 0x20: mAddressingMode = mArguments[0] & 0x03; break;
+      case 0x21:
+        mColumnStart = mArguments[0] & 0x7F;
+        mColumnEnd = mArguments[1] & 0x7F;
+        mColumn = mColumnStart;
+        break;
+      case 0x22:
+        mPageStart = mArguments[0] & 0x07;
+        mPageEnd = mArguments[1] & 0x07;
+        mPage = mPageStart;
+        break;
+      case 0x81: mContrast = mArguments[0]; break;
+      case 0x8D: mChargePump = (mArguments[0] & 0x04) != 0; break;
+      case 0xA6: mInverted = false; break;
+      case 0xA7: mInverted = true; break;
+      case 0xAE: mDisplayOn = false; break;
+      case 0xAF: mDisplayOn = true; break;
+      default: break; // Timing, scrolling and mapping commands do not change the image
+    }
+  }
+}
+
+void Ssd1306Emulator::data(uint8_t value)
+{
+  mRam[mPage][mColumn] = value;
+  switch (mAddressingMode)
+  {
+    case ADDRESSING_PAGE:
+      mColumn = (mColumn + 1) & 0x7F;
+      break;
+    case ADDRESSING_HORIZONTAL:
+      if (mColumn++ >= mColumnEnd)
+      {
+        mColumn = mColumnStart;
+        mPage = (mPage >= mPageEnd) ? mPageStart : mPage + 1;
+      }
+      break;
+    default:
+      if (mPage++ >= mPageEnd)
+      {
+        mPage = mPageStart;
+        mColumn = (mColumn >= mColumnEnd) ? mColumnStart : mColumn + 1;
+      }
+      break;
+  }
+}
+
+bool Ssd1306Emulator::pixel(uint8_t x, uint8_t y) const
+{
+  if (!mDisplayOn || x >= WIDTH || y >= HEIGHT) return false;
+  bool set = (mRam[y / 8][x] >> (y % 8)) & 1;
+  return set != mInverted;
+}
+
+void Ssd1306Emulator::writePbm(FILE* out) const
+{
+  fprintf(out, "P1\n%d %d\n", WIDTH, HEIGHT);
+  for (uint8_t y = 0; y < HEIGHT; ++y)
+  {
+    for (uint8_t x = 0; x < WIDTH; ++x)
+    {
+      fputc(pixel(x, y) ? '1' : '0', out);
+      fputc(x + 1 < WIDTH ? ' ' : '\n', out);
+    }
+  }
+}
+
+void Ssd1306Emulator::writeAscii(FILE* out) const
+{
+  // Two pixel rows per text line: ' ' none, '\'' top, '.' bottom, ':' both
+  static const char cells[] = { ' ', '\'', '.', ':' };
+  fputc('+', out);
+  for (uint8_t x = 0; x < WIDTH; ++x) fputc('-', out);
+  fputs("+\n", out);
+  for (uint8_t y = 0; y < HEIGHT; y += 2)
+  {
+    fputc('|', out);
+    for (uint8_t x = 0; x < WIDTH; ++x)
+    {
+      fputc(cells[pixel(x, y) | (pixel(x, y + 1) << 1)], out);
+    }
+    fputs("|\n", out);
+  }
+  fputc('+', out);
+  for (uint8_t x = 0; x < WIDTH; ++x) fputc('-', out);
+  fputs("+\n", out);
+}
+
+bool Ssd1306Emulator::savePbm(const char* path) const
+{
+  FILE* out = fopen(path, "w");
+  if (!out) return false;
+  writePbm(out);
+  fclose(out);
+  return true;
+}
@@ -0,0 +1,77 @@
+/*
+ * SSD1306 controller emulator
+ *
+ * Decodes the command/data byte stream a driver sends to the panel into a
+ * 128x64 framebuffer and keeps byte and command counters, so rendering code
+ * can be inspected and measured without hardware.
+ */
+#ifndef HOST_SSD1306EMU_H
+#define HOST_SSD1306EMU_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+class Ssd1306Emulator {
+public:
+  static const uint8_t WIDTH = 128;
+  static const uint8_t HEIGHT = 64;
+  static const uint8_t PAGES = HEIGHT / 8;
+
+  struct Counters {
+    unsigned long mBytes;
+    unsigned long mCommandBytes;
+    unsigned long mCommands;
+    unsigned long mDataBytes;
+  };
+
+  Ssd1306Emulator();
+  void reset();
+
+  // Byte stream input, data == false is a command byte (D/C pin low).
+  void feed(uint8_t value, bool data);
+
+  // Frame accounting: counters since the last markFrame() call.
+  const Counters& frameCounters() const { return mFrame; }
+  const Counters& totalCounters() const { return mTotal; }
+  void markFrame();
+
+  bool pixel(uint8_t x, uint8_t y) const;
+  bool displayOn() const { return mDisplayOn; }
+  bool chargePumpOn() const { return mChargePump; }
+  uint8_t contrast() const { return mContrast; }
+  bool inverted() const { return mInverted; }
+  const uint8_t* page(uint8_t page) const { return mRam[page]; }
+
+  // Snapshots of what the panel shows (blank when the display is off).
+  void writePbm(FILE* out) const;
+  void writeAscii(FILE* out) const;
+  bool savePbm(const char* path) const;
+
+private:
+  void command(uint8_t value);
+  void data(uint8_t value);
+  static uint8_t argumentCount(uint8_t command);
+
+  uint8_t mRam[PAGES][WIDTH];
+  uint8_t mPage;
+  uint8_t mColumn;
+  uint8_t mAddressingMode; // 0 horizontal, 1 vertical, 2 page
+  uint8_t mColumnStart;
+  uint8_t mColumnEnd;
+  uint8_t mPageStart;
+  uint8_t mPageEnd;
+  bool mDisplayOn;
+  bool mChargePump;
+  bool mInverted;
+  uint8_t mContrast;
+
+  uint8_t mPendingCommand;
+  uint8_t mPendingArguments;
+  uint8_t mArguments[6];
+  uint8_t mArgumentIndex;
+
+  Counters mFrame;
+  Counters mTotal;
+};
+
+#endif // HOST_SSD1306EMU_H
@@ -0,0 +1,32 @@
+/*
+ * Host stand-in for avr-libc <util/crc16.h>, the C equivalents given in
+ * the avr-libc documentation.
+ */
+#ifndef HOST_UTIL_CRC16_H
+#define HOST_UTIL_CRC16_H
+
+#include <stdint.h>
+
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t a)
+{
+  crc ^= a;
+  for (int i = 0; i < 8; ++i)
+  {
+    if (crc & 1) crc = (crc >> 1) ^ 0xA001;
+    else crc = (crc >> 1);
+  }
+  return crc;
+}
+
+static inline uint8_t _crc8_ccitt_update(uint8_t inCrc, uint8_t inData)
+{
+  uint8_t data = inCrc ^ inData;
+  for (int i = 0; i < 8; ++i)
+  {
+    if ((data & 0x80) != 0) data = (data << 1) ^ 0x07;
+    else data <<= 1;
+  }
+  return data;
+}
+
+#endif // HOST_UTIL_CRC16_H
@@ -0,0 +1,279 @@
+/*
+ * Light curve replay
+ *
+ * Feeds recorded light curves through the simulated ADC into the sketch
+ * built with LIGHT_SENSOR, and logs when the sensor turns dark or light and
+ * when the relay switches, next to the computed sunrise and sunset. Runs
+ * in virtual time, every ADC conversion is delivered.
+ *
+ * Usage: lightreplay [--golden FILE] curve.txt...
+ *
+ *   --golden    compare the log with FILE instead of printing it; the exit
+ *               status is 1 when they differ
+ *
+ * Curve files, one command per line, '#' starts a comment:
+ *   date YYYY-MM-DD          the day of the curve
+ *   week ON OFF              program, as in fleetplanner, e.g.
+ *   weekend ON OFF           "sunset+15 22:15" or "06:00 sunrise"; the
+ *                            default program when left out
+ *   HH:MM[:SS] LEVEL         ADC reading (0-1023) at that time, linear in
+ *                            between; the replay runs from the first to the
+ *                            last point
+ * Times are standard time, as the clock chip keeps it. The sketch boots
+ * with the first curve; the next curves continue on the same unit.
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "timer.h"
+#include "lightsensor.h"
+#include "persist.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+extern dusk_dawn_timer::RtcControl rtcControl;
+extern dusk_dawn_timer::Dusk2Dawn dusk2dawn;
+extern dusk_dawn_timer::Timer timer;
+
+using namespace dusk_dawn_timer;
+
+#if !LIGHT_SENSOR
+#error "Build lightreplay against the sketch with LIGHT_SENSOR set to 1"
+#endif
+
+namespace {
+
+struct Point {
+  uint32_t mSecond; // Since midnight
+  uint16_t mLevel;
+};
+
+std::string sCurve;
+std::vector<std::string> sLog;
+bool sBooted = false;
+bool sLogging = false;
+
+std::string clockTime()
+{
+  char text[16];
+  const uint16_t minutes = rtcControl.getMinutesSinceMidnight();
+  snprintf(text, sizeof(text), "%02u:%02u", minutes / MINUTES_PER_HOUR, minutes % MINUTES_PER_HOUR);
+  return text;
+}
+
+void log(const std::string& text)
+{
+  sLog.push_back(sCurve + " " + clockTime() + " " + text);
+}
+
+void relayChanged(uint8_t pin, uint8_t value)
+{
+  if (pin != RELAY_PIN || !sLogging) return;
+  log((value == LOW) == RELAY_ACTIVE_LOW ? "relay on" : "relay off");
+}
+
+bool parseAction(const char* text, SwitchAction& action)
+{
+  int hour, minute;
+  if (sscanf(text, "%d:%d", &hour, &minute) == 2)
+  {
+    action = SwitchAction(TIME, hour * MINUTES_PER_HOUR + minute);
+    return true;
+  }
+  if (strncmp(text, "sunrise", 7) == 0) action = SwitchAction(SUNUP, text[7] ? atoi(text + 7) : 0);
+  else if (strncmp(text, "sunset", 6) == 0) action = SwitchAction(SUNDOWN, text[6] ? atoi(text + 6) : 0);
+  else return false;
+  return true;
+}
+
+std::string hhmm(uint16_t minutes)
+{
+  if (minutes >= MINUTES_PER_DAY) return "--:--";
+  char text[8];
+  snprintf(text, sizeof(text), "%02u:%02u", minutes / MINUTES_PER_HOUR, minutes % MINUTES_PER_HOUR);
+  return text;
+}
+
+bool replay(const char* path)
+{
+  FILE* in = fopen(path, "r");
+  if (!in)
+  {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return false;
+  }
+  sCurve = path;
+  size_t slash = sCurve.find_last_of('/');
+  if (slash != std::string::npos) sCurve = sCurve.substr(slash + 1);
+  size_t dot = sCurve.find_last_of('.');
+  if (dot != std::string::npos) sCurve = sCurve.substr(0, dot);
+
+  int year = 0, month = 0, day = 0;
+  std::vector<Point> points;
+  SwitchAction program[4];
+  bool week = false, weekend = false;
+  char line[256];
+  int lineNumber = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), in))
+  {
+    lineNumber++;
+    char* comment = strchr(line, '#');
+    if (comment) *comment = '\0';
+    char word[32], on[32], off[32];
+    int hour, minute, second = 0, level;
+    if (sscanf(line, "%31s", word) != 1) continue;
+    if (strcmp(word, "date") == 0) ok = sscanf(line, "%*s %d-%d-%d", &year, &month, &day) == 3;
+    else if (strcmp(word, "week") == 0 || strcmp(word, "weekend") == 0)
+    {
+      const int first = strcmp(word, "week") == 0 ? 0 : 2;
+      ok = sscanf(line, "%*s %31s %31s", on, off) == 2 && parseAction(on, program[first]) && parseAction(off, program[first + 1]);
+      if (first == 0) week = true;
+      else weekend = true;
+    }
+    else if (sscanf(line, "%d:%d:%d %d", &hour, &minute, &second, &level) == 4 ||
+             (second = 0, sscanf(line, "%d:%d %d", &hour, &minute, &level) == 3))
+    {
+      Point point = { static_cast<uint32_t>((hour * 60 + minute) * 60 + second), static_cast<uint16_t>(level) };
+      ok = points.empty() || point.mSecond > points.back().mSecond;
+      points.push_back(point);
+    }
+    else ok = false;
+    if (!ok) fprintf(stderr, "%s:%d: cannot parse the line\n", path, lineNumber);
+  }
+  fclose(in);
+  if (!ok) return false;
+  if (year == 0 || points.size() < 2)
+  {
+    fprintf(stderr, "%s: needs a date and at least two points\n", path);
+    return false;
+  }
+
+  const uint32_t start = points.front().mSecond;
+  hal::rtcSet(year, month, day, start / 3600, start / 60 % 60, start % 60);
+  hal::setAnalogInput(LIGHT_SENSOR_CHANNEL, points.front().mLevel);
+  if (!sBooted)
+  {
+    setup();
+    sBooted = true;
+  }
+  else
+  {
+    // Let the unit pick up the new time
+    const uint64_t settle = hal::nowMicros() + 1100000;
+    while (hal::nowMicros() < settle) loop();
+  }
+  Persist::resetToDefaults();
+  timer.begin();
+  if (week) timer.setWeekTimer(program[0].mSwitchType, program[0].mTime, program[1].mSwitchType, program[1].mTime);
+  if (weekend) timer.setWeekendTimer(program[2].mSwitchType, program[2].mTime, program[3].mSwitchType, program[3].mTime);
+  loop();
+
+  char text[64];
+  snprintf(text, sizeof(text), "%04d-%02d-%02d sunrise %s sunset %s", year, month, day,
+           hhmm(dusk2dawn.mSunrise).c_str(), hhmm(dusk2dawn.mSunset).c_str());
+  log(text);
+  bool dark = LightSensor::isDark();
+  log(dark ? "dark" : "light");
+  log(timer.isSwitchedOn() ? "relay on" : "relay off");
+  sLogging = true;
+
+  // One step per second, the level interpolated between the points
+  size_t segment = 0;
+  for (uint32_t second = start; second <= points.back().mSecond; ++second)
+  {
+    while (points[segment + 1].mSecond < second) segment++;
+    const Point& a = points[segment];
+    const Point& b = points[segment + 1];
+    const int32_t level = a.mLevel + (static_cast<int32_t>(b.mLevel) - a.mLevel) *
+                          static_cast<int32_t>(second - a.mSecond) / static_cast<int32_t>(b.mSecond - a.mSecond);
+    hal::setAnalogInput(LIGHT_SENSOR_CHANNEL, level);
+    const uint64_t end = hal::nowMicros() + 1000000;
+    while (hal::nowMicros() < end) loop();
+    if (LightSensor::isDark() != dark)
+    {
+      dark = LightSensor::isDark();
+      snprintf(text, sizeof(text), "%s (level %u)", dark ? "dark" : "light", LightSensor::getLevel());
+      log(text);
+    }
+  }
+  snprintf(text, sizeof(text), "end, sunrise delay %u sunset advance %u", LightSensor::getSunriseDelay(), LightSensor::getSunsetAdvance());
+  log(text);
+  sLogging = false;
+  return true;
+}
+
+bool readLines(const char* path, std::vector<std::string>& lines)
+{
+  FILE* in = fopen(path, "r");
+  if (!in) return false;
+  char line[256];
+  while (fgets(line, sizeof(line), in))
+  {
+    std::string text(line);
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) text.pop_back();
+    lines.push_back(text);
+  }
+  fclose(in);
+  return true;
+}
+
+void usage(const char* program)
+{
+  fprintf(stderr, "Usage: %s [--golden FILE] curve.txt...\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  const char* golden = nullptr;
+  int first = 1;
+  for (; first < argc && argv[first][0] == '-'; ++first)
+  {
+    std::string option(argv[first]);
+    if (option == "--golden" && first + 1 < argc) golden = argv[++first];
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (first >= argc)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  hal::setPinListener(relayChanged);
+  bool ok = true;
+  for (int i = first; i < argc && ok; ++i) ok = replay(argv[i]);
+  if (!ok) return 2;
+
+  if (!golden)
+  {
+    for (size_t i = 0; i < sLog.size(); ++i) printf("%s\n", sLog[i].c_str());
+    return 0;
+  }
+  std::vector<std::string> expected;
+  if (!readLines(golden, expected))
+  {
+    fprintf(stderr, "Cannot read %s\n", golden);
+    return 2;
+  }
+  size_t differences = 0;
+  const size_t lines = std::max(expected.size(), sLog.size());
+  for (size_t i = 0; i < lines; ++i)
+  {
+    const std::string want = i < expected.size() ? expected[i] : "(none)";
+    const std::string got = i < sLog.size() ? sLog[i] : "(none)";
+    if (want == got) continue;
+    printf("line %zu: expected '%s', got '%s'\n", i + 1, want.c_str(), got.c_str());
+    differences++;
+  }
+  if (differences) printf("%zu of %zu lines differ\n", differences, lines);
+  return differences ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Micro-benchmarks of the sketch hot paths
+ *
+ * Runs the real modules against the fake Arduino environment and measures
+ * them with the host clock. The numbers are host CPU times, so only
+ * compare them with each other or with a previous run on the same machine;
+ * the AVR is roughly two orders of magnitude slower.
+ *
+ * Usage: microbench [ROUNDS]
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "rtccontrol.h"
+#include "dusk2dawn.h"
+#include "timer.h"
+#include "oledcontrol.h"
+#include "persist.h"
+#include "journal.h"
+#include "eepromjobs.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+
+using namespace dusk_dawn_timer;
+
+namespace {
+
+RtcControl sRtc;
+Dusk2Dawn sD2d;
+Timer sTimer(&sRtc, &sD2d);
+OledControl sOled(&sRtc, &sD2d, &sTimer);
+
+volatile uint32_t sSink; // Keeps results alive
+
+typedef void (*Benchmark)(long i);
+
+void dusk2dawnDay(long i)
+{
+  // Every call is another day, so the date cache never hits
+  const int day = i % 365;
+  sD2d.update(2018 + (i / 365) % 50, 1 + day / 31 % 12, 1 + day % 28, false);
+  sSink += sD2d.mSunrise;
+}
+
+void dusk2dawnStep(long i)
+{
+  // Five calls per date: the start and the four steps
+  const int day = (i / 5) % 365;
+  sSink += sD2d.prepare(2018 + (i / 1825) % 50, 1 + day / 31 % 12, 1 + day % 28, false);
+}
+
+void timerMinute(long)
+{
+  hal::advanceMillis(60000);
+  sRtc.update();
+  sD2d.update(sRtc.getYear(), sRtc.getMonth(), sRtc.getDay(), sRtc.dayLightSaving());
+  sTimer.update();
+  sSink += sTimer.getNextSwitchTime();
+}
+
+void persistSetting(long i)
+{
+  Persist::setScreenBlankTimeout(i % 30);
+  sSink += Persist::isDirty();
+}
+
+void journalLog(long i)
+{
+  Journal::log(jeMANUAL, i & 1);
+  Journal::flush();
+}
+
+void renderDefault(long)
+{
+  sOled.updateMenu(true);
+}
+
+void renderMenu(long i)
+{
+  sOled.userEvent(i % 8 < 4 ? evRIGHT : evLEFT, millis());
+  sOled.updateMenu(true);
+}
+
+/*
+ * The loop work at midnight: the clock, dawn and dusk of the new day and the
+ * timer. Every round is the midnight of another day; the day before runs
+ * the same modules at 23:59 and, with prepared set, lets prepare() finish
+ * the next day first. Each midnight is run three times and the fastest
+ * counts, so the worst midnight is not just a host scheduling hiccup.
+ * Prints the average and the worst midnight.
+ */
+void midnight(const char* name, long rounds, bool prepared)
+{
+  uint16_t year = 2018;
+  uint8_t month = 1, day = 1;
+  double sum = 0, worst = 0;
+  for (long i = 0; i < rounds; ++i)
+  {
+    const uint16_t todayYear = year;
+    const uint8_t todayMonth = month, today = day;
+    RtcControl::nextDay(year, month, day);
+    double fastest = 0;
+    for (uint8_t repeat = 0; repeat < 3; ++repeat)
+    {
+      // The DS3231 keeps standard time
+      hal::rtcSet(todayYear, todayMonth, today, sRtc.dayLightSaving() ? 22 : 23, 59);
+      hal::advanceMillis(2000);
+      sRtc.update();
+      sD2d.update(sRtc.getYear(), sRtc.getMonth(), sRtc.getDay(), sRtc.dayLightSaving());
+      if (prepared) while (sD2d.prepare(year, month, day, sRtc.dayLightSaving())) {}
+      sTimer.update();
+
+      hal::advanceMillis(60000);
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      sRtc.update();
+      sD2d.update(sRtc.getYear(), sRtc.getMonth(), sRtc.getDay(), sRtc.dayLightSaving());
+      sTimer.update();
+      const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      sSink += sTimer.getNextSwitchTime();
+      if (repeat == 0 || ns < fastest) fastest = ns;
+    }
+    sum += fastest;
+    if (fastest > worst) worst = fastest;
+    if (year > 2068) year = 2018;
+  }
+  printf("%-20s %10ld %12.1f\n", name, rounds, sum / rounds);
+  printf("%-20s %10ld %12.1f\n", (std::string(name) + "_max").c_str(), rounds, worst);
+}
+
+void run(const char* name, Benchmark benchmark, long rounds)
+{
+  benchmark(0); // Warm up
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long i = 0; i < rounds; ++i) benchmark(i);
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  printf("%-20s %10ld %12.1f\n", name, rounds, ns / rounds);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  const long rounds = argc > 1 ? atol(argv[1]) : 10000;
+  if (rounds <= 0)
+  {
+    fprintf(stderr, "Usage: %s [ROUNDS]\n", argv[0]);
+    return 2;
+  }
+
+  hal::rtcSet(2018, 6, 21, 12, 0);
+  Persist::begin();
+  sRtc.begin();
+  Journal::begin(&sRtc);
+  sTimer.begin();
+  sOled.begin();
+  // Persist::begin() queued a background erase; journal writes wait for it
+  while (EepromJobs::isBusy()) EepromJobs::update();
+
+  printf("%-20s %10s %12s\n", "benchmark", "rounds", "ns/op");
+  run("dusk2dawn_day", dusk2dawnDay, rounds);
+  run("dusk2dawn_step", dusk2dawnStep, rounds);
+  run("timer_minute", timerMinute, rounds);
+  midnight("midnight_full", rounds, false);
+  midnight("midnight_prepared", rounds, true);
+  run("persist_setting", persistSetting, rounds);
+  run("journal_log", journalLog, rounds);
+  run("render_default", renderDefault, rounds);
+  sOled.userEvent(evLONGPRESS, millis());
+  run("render_menu", renderMenu, rounds);
+  return 0;
+}
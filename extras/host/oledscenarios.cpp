@@ -0,0 +1,241 @@
+/*
+ * Scripted OLED scenarios on the SSD1306 emulator
+ *
+ * Runs the real sketch (setup() and loop()) on the host, drives the menu
+ * with scripted input and reports how many bytes, commands and data bytes
+ * were sent to the display for each named frame. Frames can be saved as PBM
+ * images or printed as ASCII art.
+ *
+ * Usage: oledscenarios [--dump DIR] [--ascii] scenario.txt...
+ *
+ * Scenario commands, one per line, '#' starts a comment:
+ *   time YYYY-MM-DD HH:MM   set the DS3231 (before boot)
+ *   boot                    run setup()
+ *   loop [N]                run N loop() iterations (default 1); each one
+ *                           idles until the sketch's next deadline
+ *   wait MS                 run loop() until MS of virtual time passed
+ *   press | longpress       press the button for 100 ms or 2.6 s
+ *   button down|up          hold or release the button
+ *   left [N] | right [N]    N encoder detents 100 ms apart (slow turning)
+ *   turn DIR N MS           burst of N detents MS apart (DIR is left or
+ *                           right), then one loop
+ *   watchdog                let the watchdog time out once
+ *   eeprom                  print the number of EEPROM bytes programmed
+ *   expect eeprom|journal N fail the scenario unless N EEPROM bytes were
+ *                           programmed or the journal holds N records
+ *   poke ADDRESS VALUE...   store bytes in the EEPROM image (before boot)
+ *   serial TEXT             send TEXT to the serial port, run one loop and
+ *                           print what the sketch answered
+ *   frame NAME              report and snapshot everything drawn since the
+ *                           previous frame command
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "SSD1306Ascii.h"
+#include "journal.h"
+
+#include <stdio.h>
+#include <string>
+
+void setup();
+void loop();
+
+namespace {
+
+const char* sDumpDir = nullptr;
+bool sAscii = false;
+
+// One detent of the quadrature encoder on pins 2 (A) and 3 (B), both high
+// at rest. Every edge raises the pin change interrupt.
+void detent(bool right)
+{
+  static const uint8_t sequence[4] = { 0x01, 0x00, 0x02, 0x03 }; // (B << 1) | A
+  for (uint8_t i = 0; i < 4; ++i)
+  {
+    const uint8_t pins = right ? sequence[i] : ((sequence[i] & 1) << 1) | (sequence[i] >> 1);
+    hal::setInputPin(2, pins & 1);
+    hal::setInputPin(3, (pins >> 1) & 1);
+  }
+}
+
+// Run loop() until MS of virtual time passed
+void wait(unsigned long ms)
+{
+  const uint64_t end = hal::nowMicros() + static_cast<uint64_t>(ms) * 1000;
+  while (hal::nowMicros() < end) loop();
+}
+
+void turn(bool right, int count)
+{
+  for (int i = 0; i < count; ++i)
+  {
+    detent(right);
+    wait(100);
+  }
+}
+
+// Button on pin 4, active low
+void press(unsigned long duration)
+{
+  hal::setInputPin(4, LOW);
+  hal::advanceMillis(duration);
+  hal::setInputPin(4, HIGH);
+  hal::advanceMillis(10);
+  loop();
+}
+
+void frame(const std::string& scenario, const std::string& name)
+{
+  Ssd1306Emulator& display = hostDisplay();
+  const Ssd1306Emulator::Counters& counters = display.frameCounters();
+  printf("%-16s %-20s %7lu %7lu %7lu %7lu\n", scenario.c_str(), name.c_str(),
+         counters.mBytes, counters.mCommands, counters.mCommandBytes, counters.mDataBytes);
+  if (sAscii) display.writeAscii(stdout);
+  if (sDumpDir)
+  {
+    std::string path = std::string(sDumpDir) + "/" + scenario + "-" + name + ".pbm";
+    if (!display.savePbm(path.c_str())) fprintf(stderr, "Cannot write %s\n", path.c_str());
+  }
+  display.markFrame();
+}
+
+bool runScenario(const char* path)
+{
+  FILE* in = fopen(path, "r");
+  if (!in)
+  {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return false;
+  }
+  std::string scenario(path);
+  size_t slash = scenario.find_last_of('/');
+  if (slash != std::string::npos) scenario = scenario.substr(slash + 1);
+  size_t dot = scenario.find_last_of('.');
+  if (dot != std::string::npos) scenario = scenario.substr(0, dot);
+
+  char line[256];
+  int lineNumber = 0;
+  bool ok = true;
+  bool failed = false; // An expectation did not hold, the scenario goes on
+  while (ok && fgets(line, sizeof(line), in))
+  {
+    lineNumber++;
+    char* comment = strchr(line, '#');
+    if (comment) *comment = '\0';
+    char command[32] = "";
+    char argument[64] = "";
+    int fields = sscanf(line, "%31s %63[^\n]", command, argument);
+    if (fields < 1) continue;
+    const int count = fields > 1 ? atoi(argument) : 1;
+    const std::string cmd(command);
+    if (cmd == "time")
+    {
+      int year, month, day, hour, minute;
+      if (sscanf(argument, "%d-%d-%d %d:%d", &year, &month, &day, &hour, &minute) == 5)
+      {
+        hal::rtcSet(year, month, day, hour, minute);
+      }
+      else ok = false;
+    }
+    else if (cmd == "boot") setup();
+    else if (cmd == "loop") for (int i = 0; i < count; ++i) loop();
+    else if (cmd == "wait") wait(atol(argument));
+    else if (cmd == "press") press(100);
+    else if (cmd == "longpress") press(2600);
+    else if (cmd == "button") hal::setInputPin(4, strcmp(argument, "down") == 0 ? LOW : HIGH);
+    else if (cmd == "left") turn(false, count);
+    else if (cmd == "right") turn(true, count);
+    else if (cmd == "turn")
+    {
+      char direction[8];
+      int detents, interval;
+      if (sscanf(argument, "%7s %d %d", direction, &detents, &interval) == 3)
+      {
+        for (int i = 0; i < detents; ++i)
+        {
+          detent(strcmp(direction, "right") == 0);
+          hal::advanceMillis(interval);
+        }
+        loop();
+      }
+      else ok = false;
+    }
+    else if (cmd == "eeprom") printf("eeprom writes %lu\n", hal::eepromWriteCount());
+    else if (cmd == "expect")
+    {
+      char what[16];
+      unsigned long expected, actual;
+      if (sscanf(argument, "%15s %lu", what, &expected) != 2) ok = false;
+      else if (strcmp(what, "eeprom") == 0) actual = hal::eepromWriteCount();
+      else if (strcmp(what, "journal") == 0) actual = dusk_dawn_timer::Journal::getCount();
+      else ok = false;
+      if (ok && actual != expected)
+      {
+        fprintf(stderr, "%s:%d: %s is %lu, expected %lu\n", path, lineNumber, what, actual, expected);
+        failed = true;
+      }
+    }
+    else if (cmd == "poke")
+    {
+      char* next = argument;
+      const long address = strtol(next, &next, 0);
+      long value;
+      for (long i = address; i < 1024 && *next; ++i)
+      {
+        char* end;
+        value = strtol(next, &end, 0);
+        if (end == next) break;
+        hal::eepromImage()[i] = static_cast<uint8_t>(value);
+        next = end;
+      }
+    }
+    else if (cmd == "watchdog")
+    {
+      if (hal::watchdogExpire()) printf("watchdog reset\n");
+    }
+    else if (cmd == "serial")
+    {
+      hal::serialInject(reinterpret_cast<const uint8_t*>(argument), strlen(argument));
+      loop();
+      fputs(hal::serialTakeOutput().c_str(), stdout);
+    }
+    else if (cmd == "frame") frame(scenario, argument);
+    else ok = false;
+    if (!ok) fprintf(stderr, "%s:%d: cannot parse '%s'\n", path, lineNumber, command);
+  }
+  fclose(in);
+  return ok && !failed;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  int first = 1;
+  for (; first < argc && argv[first][0] == '-'; ++first)
+  {
+    std::string option(argv[first]);
+    if (option == "--dump" && first + 1 < argc) sDumpDir = argv[++first];
+    else if (option == "--ascii") sAscii = true;
+    else
+    {
+      fprintf(stderr, "Usage: %s [--dump DIR] [--ascii] scenario.txt...\n", argv[0]);
+      return 2;
+    }
+  }
+  if (first >= argc)
+  {
+    fprintf(stderr, "Usage: %s [--dump DIR] [--ascii] scenario.txt...\n", argv[0]);
+    return 2;
+  }
+
+  printf("%-16s %-20s %7s %7s %7s %7s\n", "scenario", "frame", "bytes", "cmds", "cmdbyte", "data");
+  bool ok = true;
+  for (int i = first; i < argc; ++i)
+  {
+    // The sketch is one program; every scenario file continues where the
+    // previous one stopped, like a unit that keeps running.
+    ok = runScenario(argv[i]) && ok;
+  }
+  return ok ? 0 : 1;
+}
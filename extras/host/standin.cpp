@@ -0,0 +1,112 @@
+/*
+ * Stand-in device on the host
+ *
+ * Runs the real sketch and connects its serial port to standard input and
+ * output, so serial tools can talk to it without a board:
+ *
+ *   extras/tools/remoteconfig.py --standin "extras/host/build/standin --eeprom /tmp/unit.eep" --get
+ *
+ * Usage: standin [--time "YYYY-MM-DD HH:MM"] [--eeprom FILE]
+ *
+ *   --time      set the DS3231 before boot
+ *   --eeprom    load the EEPROM image from FILE when it exists, save it there
+ *               at exit
+ *
+ * Virtual time runs at about real time. At the end of the input the sketch
+ * runs a few more seconds, so the settings are committed to the EEPROM,
+ * then the number of EEPROM writes is reported on standard error.
+ */
+#include "Arduino.h"
+#include "hal.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+
+void setup();
+void loop();
+
+namespace {
+
+#define SLICE 10 // ms of virtual and real time per step
+#define SETTLE_TIME 3000 // ms to run after the end of the input
+
+// Run loop() until MS of virtual time passed, then pass the output on
+void run(unsigned long ms)
+{
+  const uint64_t end = hal::nowMicros() + static_cast<uint64_t>(ms) * 1000;
+  while (hal::nowMicros() < end) loop();
+  const std::string output = hal::serialTakeOutput();
+  if (!output.empty())
+  {
+    fwrite(output.data(), 1, output.size(), stdout);
+    fflush(stdout);
+  }
+}
+
+void usage(const char* program)
+{
+  fprintf(stderr, "Usage: %s [--time \"YYYY-MM-DD HH:MM\"] [--eeprom FILE]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  const char* eepromPath = nullptr;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string option(argv[i]);
+    int year, month, day, hour, minute;
+    if (option == "--time" && i + 1 < argc &&
+        sscanf(argv[++i], "%d-%d-%d %d:%d", &year, &month, &day, &hour, &minute) == 5)
+    {
+      hal::rtcSet(year, month, day, hour, minute);
+    }
+    else if (option == "--eeprom" && i + 1 < argc) eepromPath = argv[++i];
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (eepromPath)
+  {
+    FILE* in = fopen(eepromPath, "rb");
+    if (in)
+    {
+      if (fread(hal::eepromImage(), 1, 1024, in) != 1024) fprintf(stderr, "Short EEPROM image %s\n", eepromPath);
+      fclose(in);
+    }
+  }
+
+  setup();
+  bool open = true;
+  while (open)
+  {
+    struct pollfd input = { STDIN_FILENO, POLLIN, 0 };
+    if (poll(&input, 1, SLICE) > 0)
+    {
+      uint8_t buffer[64];
+      const ssize_t size = read(STDIN_FILENO, buffer, sizeof(buffer));
+      if (size > 0) hal::serialInject(buffer, size);
+      else open = false;
+    }
+    run(SLICE);
+  }
+  run(SETTLE_TIME);
+
+  if (eepromPath)
+  {
+    FILE* out = fopen(eepromPath, "wb");
+    if (!out || fwrite(hal::eepromImage(), 1, 1024, out) != 1024)
+    {
+      fprintf(stderr, "Cannot write %s\n", eepromPath);
+      return 1;
+    }
+    fclose(out);
+  }
+  fprintf(stderr, "eeprom writes %lu\n", hal::eepromWriteCount());
+  return 0;
+}
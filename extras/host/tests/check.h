@@ -0,0 +1,67 @@
+/*
+ * Checks for the host unit tests
+ *
+ * Each test is one program. CHECK() and CHECK_EQUAL() report a failing
+ * check with its line and carry on; main() returns testResult(), which is
+ * non-zero when any check failed, so ctest reports the test as failed.
+ */
+#ifndef HOST_TEST_CHECK_H
+#define HOST_TEST_CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace test {
+
+static int sChecks = 0;
+static int sFailures = 0;
+
+inline bool check(bool ok, const char* expression, const char* file, int line)
+{
+  sChecks++;
+  if (!ok)
+  {
+    sFailures++;
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+  }
+  return ok;
+}
+
+inline bool checkEqual(long expected, long actual, const char* expression, const char* file, int line)
+{
+  sChecks++;
+  if (expected != actual)
+  {
+    sFailures++;
+    fprintf(stderr, "%s:%d: %s is %ld, expected %ld\n", file, line, expression, actual, expected);
+  }
+  return expected == actual;
+}
+
+inline bool checkNear(long expected, long actual, long tolerance, const char* expression, const char* file, int line)
+{
+  sChecks++;
+  if (labs(expected - actual) > tolerance)
+  {
+    sFailures++;
+    fprintf(stderr, "%s:%d: %s is %ld, expected %ld +- %ld\n", file, line, expression, actual, expected, tolerance);
+    return false;
+  }
+  return true;
+}
+
+inline int testResult(const char* name)
+{
+  printf("%s: %d checks, %d failed\n", name, sChecks, sFailures);
+  return sFailures ? 1 : 0;
+}
+
+} // namespace test
+
+#define CHECK(condition) test::check((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(expected, actual) \
+  test::checkEqual(static_cast<long>(expected), static_cast<long>(actual), #actual, __FILE__, __LINE__)
+#define CHECK_NEAR(expected, actual, tolerance) \
+  test::checkNear(static_cast<long>(expected), static_cast<long>(actual), (tolerance), #actual, __FILE__, __LINE__)
+
+#endif // HOST_TEST_CHECK_H
@@ -0,0 +1,104 @@
+/*
+ * Hardware backends: the whole sketch boots and runs with the clock, the
+ * display interface and the relay polarity of the variant it is linked
+ * with (see add_sketch_variant in CMakeLists.txt).
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "SSD1306Ascii.h"
+#include "rtccontrol.h"
+#include "timer.h"
+#include "eventbus.h"
+#include "check.h"
+
+using namespace dusk_dawn_timer;
+
+void setup();
+void loop();
+extern RtcControl rtcControl;
+extern Timer timer;
+
+namespace {
+
+int16_t minutes(int hour, int minute)
+{
+  return hour * 60 + minute;
+}
+
+// Run loop() until MS of virtual time passed
+void wait(unsigned long ms)
+{
+  const uint64_t end = hal::nowMicros() + static_cast<uint64_t>(ms) * 1000;
+  while (hal::nowMicros() < end) loop();
+}
+
+uint8_t relayLevel(bool on)
+{
+  return on != RELAY_ACTIVE_LOW ? HIGH : LOW;
+}
+
+void testBoot()
+{
+  hal::rtcSet(2018, 1, 1, 12, 0); // Monday, winter time
+  setup();
+  CHECK(!EventBus::wasFull()); // Asserted in setup(), but not with NDEBUG
+  wait(1000);
+  CHECK(hostDisplay().totalCounters().mDataBytes > 0);
+#if RTC_CLOCK == CLOCK_MILLIS
+  CHECK_EQUAL(0, hal::i2cTransactionCount()); // No clock chip
+#else
+  CHECK_EQUAL(2018, rtcControl.getYear());
+  CHECK_EQUAL(minutes(12, 0), rtcControl.getMinutesSinceMidnight());
+#endif
+}
+
+void testClock()
+{
+  rtcControl.setDateTime(2018, 7, 2, minutes(12, 29)); // Summer time
+  wait(1000);
+  CHECK_EQUAL(2018, rtcControl.getYear());
+  CHECK_EQUAL(7, rtcControl.getMonth());
+  CHECK_EQUAL(2, rtcControl.getDay());
+  CHECK_EQUAL(minutes(12, 29), rtcControl.getMinutesSinceMidnight());
+  CHECK(rtcControl.dayLightSaving());
+
+  uint16_t year;
+  uint8_t month, day, hour, minute, second;
+  hal::rtcGet(year, month, day, hour, minute, second);
+#if RTC_CLOCK == CLOCK_MILLIS
+  CHECK_EQUAL(1, month); // Never written
+  CHECK_EQUAL(0, hal::i2cTransactionCount());
+#else
+  CHECK_EQUAL(7, month); // Standard time on the chip
+  CHECK_EQUAL(11, hour);
+  CHECK_EQUAL(29, minute);
+#endif
+
+  wait(61000);
+  CHECK_EQUAL(minutes(12, 30), rtcControl.getMinutesSinceMidnight());
+}
+
+void testRelay()
+{
+  timer.setProgram(SwitchAction(minutes(12, 32)), SwitchAction(minutes(12, 34)),
+                   SwitchAction(minutes(12, 32)), SwitchAction(minutes(12, 34)));
+  wait(1000);
+  CHECK(!timer.isSwitchedOn());
+  CHECK_EQUAL(relayLevel(false), hal::pinState(RELAY_PIN));
+  wait(120000UL);
+  CHECK(timer.isSwitchedOn());
+  CHECK_EQUAL(relayLevel(true), hal::pinState(RELAY_PIN));
+  wait(120000UL);
+  CHECK(!timer.isSwitchedOn());
+  CHECK_EQUAL(relayLevel(false), hal::pinState(RELAY_PIN));
+}
+
+} // namespace
+
+int main()
+{
+  testBoot();
+  testClock();
+  testRelay();
+  return test::testResult("backends");
+}
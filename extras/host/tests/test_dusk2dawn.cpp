@@ -0,0 +1,113 @@
+/*
+ * Dusk2Dawn: dawn and dusk against published times, daylight saving time,
+ * and prepare() giving the same values as a full calculation.
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "dusk2dawn.h"
+#include "eventbus.h"
+#include "check.h"
+
+using namespace dusk_dawn_timer;
+
+namespace {
+
+// The published times are rounded to the minute and use a slightly
+// different refraction model
+#define TOLERANCE 3
+
+int sSolarEvents = 0;
+
+void solarChanged(void*, uint8_t, const void*)
+{
+  sSolarEvents++;
+}
+
+int minutes(int hour, int minute)
+{
+  return hour * 60 + minute;
+}
+
+void testPublishedTimes()
+{
+  Dusk2Dawn d2d; // Utrecht, GMT + 1
+  uint16_t sunrise, sunset;
+  d2d.calculate(2018, 6, 21, true, sunrise, sunset);
+  CHECK_NEAR(minutes(5, 18), sunrise, TOLERANCE);
+  CHECK_NEAR(minutes(22, 5), sunset, TOLERANCE);
+  d2d.calculate(2018, 12, 21, false, sunrise, sunset);
+  CHECK_NEAR(minutes(8, 46), sunrise, TOLERANCE);
+  CHECK_NEAR(minutes(16, 28), sunset, TOLERANCE);
+
+  // New York, GMT - 5, and Sydney, GMT + 10, in the southern winter
+  d2d.setLocation(40.7128, -74.0060, -5 * 60);
+  d2d.calculate(2018, 6, 21, true, sunrise, sunset);
+  CHECK_NEAR(minutes(5, 25), sunrise, TOLERANCE);
+  CHECK_NEAR(minutes(20, 31), sunset, TOLERANCE);
+  d2d.setLocation(-33.8688, 151.2093, 10 * 60);
+  d2d.calculate(2018, 6, 21, false, sunrise, sunset);
+  CHECK_NEAR(minutes(7, 0), sunrise, TOLERANCE);
+  CHECK_NEAR(minutes(16, 54), sunset, TOLERANCE);
+}
+
+void testDayLightSaving()
+{
+  Dusk2Dawn d2d;
+  uint16_t sunrise, sunset, dstSunrise, dstSunset;
+  d2d.calculate(2018, 5, 1, false, sunrise, sunset);
+  d2d.calculate(2018, 5, 1, true, dstSunrise, dstSunset);
+  CHECK_EQUAL(sunrise + 60, dstSunrise);
+  CHECK_EQUAL(sunset + 60, dstSunset);
+}
+
+void testUpdate()
+{
+  Dusk2Dawn d2d;
+  uint16_t sunrise, sunset;
+  d2d.calculate(2018, 3, 10, false, sunrise, sunset);
+  sSolarEvents = 0;
+  d2d.update(2018, 3, 10, false);
+  CHECK_EQUAL(sunrise, d2d.mSunrise);
+  CHECK_EQUAL(sunset, d2d.mSunset);
+  CHECK_EQUAL(1, sSolarEvents);
+  d2d.update(2018, 3, 10, false); // Same date, nothing new
+  CHECK_EQUAL(1, sSolarEvents);
+}
+
+void testPrepare()
+{
+  Dusk2Dawn d2d;
+  d2d.update(2018, 9, 14, false);
+  // The first call only takes the date, then one step per call
+  int calls = 0;
+  while (d2d.prepare(2018, 9, 15, false) && calls < 10) calls++;
+  CHECK_EQUAL(4, calls);
+  CHECK(!d2d.prepare(2018, 9, 15, false));
+
+  uint16_t sunrise, sunset;
+  d2d.calculate(2018, 9, 15, false, sunrise, sunset);
+  sSolarEvents = 0;
+  d2d.update(2018, 9, 15, false);
+  CHECK_EQUAL(sunrise, d2d.mSunrise);
+  CHECK_EQUAL(sunset, d2d.mSunset);
+  CHECK_EQUAL(1, sSolarEvents);
+
+  // Prepared for another date: calculated in full, same result
+  while (d2d.prepare(2018, 9, 17, false)) {}
+  d2d.calculate(2018, 9, 16, false, sunrise, sunset);
+  d2d.update(2018, 9, 16, false);
+  CHECK_EQUAL(sunrise, d2d.mSunrise);
+  CHECK_EQUAL(sunset, d2d.mSunset);
+}
+
+} // namespace
+
+int main()
+{
+  EventBus::subscribe(BUS_SOLAR, solarChanged);
+  testPublishedTimes();
+  testDayLightSaving();
+  testUpdate();
+  testPrepare();
+  return test::testResult("dusk2dawn");
+}
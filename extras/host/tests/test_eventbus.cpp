@@ -0,0 +1,71 @@
+/*
+ * EventBus: subscribers get only their events, in the order they
+ * subscribed, and a full table is refused and remembered.
+ */
+#include "Arduino.h"
+#include "eventbus.h"
+#include "check.h"
+
+#include <vector>
+
+using namespace dusk_dawn_timer;
+
+namespace {
+
+struct Call
+{
+  int mSubscriber;
+  uint8_t mEvents;
+};
+
+std::vector<Call> sCalls;
+int sContexts[EVENT_BUS_SUBSCRIBERS + 1];
+
+void handler(void* context, uint8_t events, const void*)
+{
+  Call call = { static_cast<int>(static_cast<int*>(context) - sContexts), events };
+  sCalls.push_back(call);
+}
+
+void testPublish()
+{
+  CHECK(EventBus::subscribe(BUS_MINUTE | BUS_DATE, handler, &sContexts[0]));
+  CHECK(EventBus::subscribe(BUS_SOLAR, handler, &sContexts[1]));
+  CHECK(EventBus::subscribe(BUS_SOLAR, handler, &sContexts[0])); // Added
+  sCalls.clear();
+  EventBus::publish(BUS_DATE | BUS_SOLAR | BUS_RELAY);
+  if (!CHECK_EQUAL(2, sCalls.size())) return;
+  CHECK_EQUAL(0, sCalls[0].mSubscriber);
+  CHECK_EQUAL(BUS_DATE | BUS_SOLAR, sCalls[0].mEvents);
+  CHECK_EQUAL(1, sCalls[1].mSubscriber);
+  CHECK_EQUAL(BUS_SOLAR, sCalls[1].mEvents);
+
+  sCalls.clear();
+  EventBus::publish(BUS_INPUT);
+  CHECK(sCalls.empty());
+}
+
+void testFull()
+{
+  for (int i = 2; i < EVENT_BUS_SUBSCRIBERS; ++i)
+  {
+    CHECK(EventBus::subscribe(BUS_RELAY, handler, &sContexts[i]));
+  }
+  CHECK(!EventBus::wasFull());
+  CHECK(EventBus::subscribe(BUS_RELAY, handler, &sContexts[0])); // Already in
+  CHECK(!EventBus::subscribe(BUS_RELAY, handler, &sContexts[EVENT_BUS_SUBSCRIBERS]));
+  CHECK(EventBus::wasFull());
+
+  sCalls.clear();
+  EventBus::publish(BUS_RELAY);
+  CHECK_EQUAL(EVENT_BUS_SUBSCRIBERS - 1, sCalls.size()); // All but the one of BUS_SOLAR only
+}
+
+} // namespace
+
+int main()
+{
+  testPublish();
+  testFull();
+  return test::testResult("eventbus");
+}
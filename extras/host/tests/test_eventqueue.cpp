@@ -0,0 +1,95 @@
+/*
+ * EventQueue: bursts at ISR rate pass through without loss and in order,
+ * only a full queue drops (and counts) an event.
+ */
+#include "Arduino.h"
+#include "eventqueue.h"
+#include "check.h"
+
+using namespace dusk_dawn_timer;
+
+namespace {
+
+// One burst of count events pushed before the main loop gets to them
+void burst(EventQueue& queue, uint8_t count, uint16_t& pushed, uint16_t& popped, uint16_t& time)
+{
+  for (uint8_t i = 0; i < count; ++i)
+  {
+    CHECK(queue.push(i & 1 ? evLEFT : evRIGHT, time + i));
+    pushed++;
+  }
+  InputEvent event;
+  uint8_t i = 0;
+  while (queue.pop(event))
+  {
+    if (!CHECK_EQUAL(i & 1 ? evLEFT : evRIGHT, event.mEvent) || !CHECK_EQUAL(static_cast<uint16_t>(time + i), event.mTime)) break;
+    i++;
+    popped++;
+  }
+  time += count;
+}
+
+void testBursts()
+{
+  EventQueue queue;
+  uint16_t pushed = 0, popped = 0, time = 0xFF00; // The time wraps too
+  for (uint8_t count = 1; count < EVENT_QUEUE_SIZE; ++count)
+  {
+    burst(queue, count, pushed, popped, time);
+  }
+  // Full bursts at every position of the ring
+  for (uint8_t i = 0; i < EVENT_QUEUE_SIZE; ++i)
+  {
+    burst(queue, EVENT_QUEUE_SIZE - 1, pushed, popped, time);
+    burst(queue, 1, pushed, popped, time);
+  }
+  CHECK_EQUAL(0, queue.dropped());
+  CHECK_EQUAL(pushed, popped);
+  CHECK(queue.isEmpty());
+}
+
+void testInterleaved()
+{
+  // The ISR pushes between the pops of the main loop
+  EventQueue queue;
+  uint16_t pushed = 0, popped = 0;
+  InputEvent event;
+  for (uint16_t round = 0; round < 1000; ++round)
+  {
+    for (uint8_t i = 0; i < 3 + round % 5; ++i)
+    {
+      queue.push(evRIGHT, pushed++);
+    }
+    for (uint8_t i = 0; i < 3 && queue.pop(event); ++i)
+    {
+      CHECK_EQUAL(popped++, event.mTime);
+    }
+    if (round % 3 == 2) while (queue.pop(event)) CHECK_EQUAL(popped++, event.mTime);
+  }
+  while (queue.pop(event)) CHECK_EQUAL(popped++, event.mTime);
+  CHECK_EQUAL(0, queue.dropped());
+  CHECK_EQUAL(pushed, popped);
+}
+
+void testFull()
+{
+  // One slot stays free, the next event is dropped and counted
+  EventQueue queue;
+  for (uint8_t i = 0; i < EVENT_QUEUE_SIZE - 1; ++i) CHECK(queue.push(evRIGHT, i));
+  CHECK(!queue.push(evRIGHT, EVENT_QUEUE_SIZE));
+  CHECK_EQUAL(1, queue.dropped());
+  InputEvent event;
+  uint8_t popped = 0;
+  while (queue.pop(event)) popped++;
+  CHECK_EQUAL(EVENT_QUEUE_SIZE - 1, popped);
+}
+
+} // namespace
+
+int main()
+{
+  testBursts();
+  testInterleaved();
+  testFull();
+  return test::testResult("eventqueue");
+}
@@ -0,0 +1,100 @@
+/*
+ * Journal: records logged while an EEPROM job holds the writes back are
+ * queued as far as the queue reaches, the rest is dropped and counted, and
+ * the ring stays intact. An erase that finds the job queue full is queued
+ * later.
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "rtccontrol.h"
+#include "persist.h"
+#include "journal.h"
+#include "eepromjobs.h"
+#include "check.h"
+
+#include <string>
+
+using namespace dusk_dawn_timer;
+
+namespace {
+
+RtcControl sRtc;
+
+// Until the EEPROM jobs and the journal queue are done
+void writeAll()
+{
+  do
+  {
+    EepromJobs::update();
+    Journal::update();
+  } while (EepromJobs::isBusy());
+  Journal::flush();
+}
+
+void testFullWhileBusy()
+{
+  const uint8_t count = Journal::getCount();
+  CHECK(EepromJobs::fill(PERSIST_AREA_SIZE - 8, 8, 0xFF));
+  for (int16_t i = 0; i < JOURNAL_QUEUE_SIZE + 1; ++i)
+  {
+    Journal::log(jeMANUAL, i);
+  }
+  CHECK_EQUAL(1, Journal::getDropped());
+  CHECK_EQUAL(count + JOURNAL_QUEUE_SIZE, Journal::getCount());
+  writeAll();
+
+  // The ring as found after a reset: the queued records and a boot record
+  Journal::begin(&sRtc);
+  writeAll();
+  CHECK_EQUAL(count + JOURNAL_QUEUE_SIZE + 1, Journal::getCount());
+  hal::serialTakeOutput();
+  Journal::dump(Serial);
+  const std::string dump = hal::serialTakeOutput();
+  CHECK(dump.find("manual 3") != std::string::npos);
+  CHECK(dump.find("manual 4") == std::string::npos);
+  CHECK(dump.find("dropped 1") != std::string::npos);
+}
+
+void testErase()
+{
+  // The sync record of the erase is queued behind the fill
+  Journal::erase();
+  for (int16_t i = 0; i < JOURNAL_QUEUE_SIZE; ++i)
+  {
+    Journal::log(jeMANUAL, i);
+  }
+  CHECK_EQUAL(2, Journal::getDropped());
+  writeAll();
+  Journal::begin(&sRtc);
+  CHECK_EQUAL(JOURNAL_QUEUE_SIZE + 1, Journal::getCount());
+}
+
+void testEraseQueueFull()
+{
+  for (uint8_t i = 0; i < EEPROM_JOB_QUEUE_SIZE; ++i)
+  {
+    CHECK(EepromJobs::fill(PERSIST_AREA_SIZE - 8, 8, 0xFF));
+  }
+  Journal::erase();
+  Journal::log(jeMANUAL, 1);
+  CHECK_EQUAL(0, Journal::flush()); // Not before the erase
+  writeAll();
+  Journal::begin(&sRtc);
+  CHECK_EQUAL(3, Journal::getCount()); // Sync, manual and boot
+}
+
+} // namespace
+
+int main()
+{
+  hal::eepromErase();
+  hal::rtcSetLostPower(false);
+  hal::rtcSet(2018, 6, 21, 12, 0);
+  sRtc.begin();
+  Journal::begin(&sRtc);
+  writeAll();
+  testFullWhileBusy();
+  testErase();
+  testEraseQueueFull();
+  return test::testResult("journal");
+}
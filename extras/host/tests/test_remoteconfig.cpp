@@ -0,0 +1,123 @@
+/*
+ * RemoteConfig: requests through the serial port of the running sketch,
+ * a frame too long to take is skipped to its end and none of its bytes
+ * reach the diagnostics commands.
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "remoteconfig.h"
+#include "telemetry.h"
+#include "check.h"
+
+#include <util/crc16.h>
+#include <string>
+#include <vector>
+
+using namespace dusk_dawn_timer;
+
+void setup();
+void loop();
+
+namespace {
+
+#define REPLY_SIZE 36
+
+// Run loop() until MS of virtual time passed
+void wait(unsigned long ms)
+{
+  const uint64_t end = hal::nowMicros() + static_cast<uint64_t>(ms) * 1000;
+  while (hal::nowMicros() < end) loop();
+}
+
+std::vector<uint8_t> frame(uint8_t type, const std::vector<uint8_t>& payload)
+{
+  std::vector<uint8_t> data;
+  data.push_back(TELEMETRY_START);
+  data.push_back(type);
+  data.push_back(static_cast<uint8_t>(payload.size()));
+  data.insert(data.end(), payload.begin(), payload.end());
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 1; i < data.size(); ++i) crc = _crc16_update(crc, data[i]);
+  data.push_back(crc & 0xFF);
+  data.push_back(crc >> 8);
+  return data;
+}
+
+void send(const std::vector<uint8_t>& data, size_t first = 0, size_t count = ~0)
+{
+  if (first >= data.size()) return;
+  if (count > data.size() - first) count = data.size() - first;
+  hal::serialInject(data.data() + first, count);
+}
+
+// Exactly one reply with the status, nothing else
+bool checkReply(const std::string& output, uint8_t status)
+{
+  if (!CHECK_EQUAL(REPLY_SIZE, output.size())) return false;
+  return CHECK_EQUAL(TELEMETRY_START, static_cast<uint8_t>(output[0])) &&
+         CHECK_EQUAL(REMOTE_CONFIG_REPLY, static_cast<uint8_t>(output[1])) &&
+         CHECK_EQUAL(status, static_cast<uint8_t>(output[3]));
+}
+
+// A payload of nothing but diagnostics commands
+std::vector<uint8_t> commands(size_t size)
+{
+  static const char sCommands[] = "djrp";
+  std::vector<uint8_t> payload;
+  for (size_t i = 0; i < size; ++i) payload.push_back(sCommands[i % 4]);
+  return payload;
+}
+
+void testGet()
+{
+  send(frame(REMOTE_CONFIG_GET, std::vector<uint8_t>()));
+  wait(200);
+  checkReply(hal::serialTakeOutput(), REMOTE_CONFIG_OK);
+}
+
+void testOversize()
+{
+  const std::vector<uint8_t> data = frame(REMOTE_CONFIG_SET, commands(REMOTE_CONFIG_MAX_PAYLOAD + 34));
+  send(data);
+  wait(200);
+  checkReply(hal::serialTakeOutput(), REMOTE_CONFIG_BAD_REQUEST);
+
+  // The longest one, arriving in pieces between the polls
+  const std::vector<uint8_t> longest = frame(REMOTE_CONFIG_SET, commands(255));
+  for (size_t first = 0; first < longest.size(); first += 20)
+  {
+    send(longest, first, 20);
+    wait(5);
+  }
+  wait(200);
+  checkReply(hal::serialTakeOutput(), REMOTE_CONFIG_BAD_REQUEST);
+  testGet(); // In step with the frames again
+}
+
+void testCutShort()
+{
+  // The rest of the frame never comes: no reply, the next byte is a
+  // command again
+  send(frame(REMOTE_CONFIG_SET, commands(100)), 0, 40);
+  wait(400);
+  CHECK(hal::serialTakeOutput().empty());
+  const uint8_t command = 'd';
+  hal::serialInject(&command, 1);
+  wait(200);
+  CHECK(hal::serialTakeOutput().find("Loops") != std::string::npos);
+  testGet();
+}
+
+} // namespace
+
+int main()
+{
+  hal::rtcSet(2018, 6, 21, 12, 0);
+  setup();
+  wait(1000);
+  hal::serialTakeOutput();
+  testGet();
+  testOversize();
+  testCutShort();
+  return test::testResult("remoteconfig");
+}
@@ -0,0 +1,145 @@
+/*
+ * RotaryEncoder: fast encoder bursts through the pin change ISR and
+ * update() arrive complete on the event bus, with the acceleration steps
+ * at the 80 ms and 30 ms thresholds.
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "rotaryencoder.h"
+#include "eventbus.h"
+#include "check.h"
+
+#include <vector>
+
+using namespace dusk_dawn_timer;
+
+namespace {
+
+RotaryEncoder sRotary;
+std::vector<UserInput> sInputs;
+
+void inputReceived(void*, uint8_t, const void* data)
+{
+  sInputs.push_back(*static_cast<const UserInput*>(data));
+}
+
+// One detent on pins 2 (A) and 3 (B), every edge raises the ISR
+void detent(bool right)
+{
+  static const uint8_t sequence[4] = { 0x01, 0x00, 0x02, 0x03 }; // (B << 1) | A
+  for (uint8_t i = 0; i < 4; ++i)
+  {
+    const uint8_t pins = right ? sequence[i] : ((sequence[i] & 1) << 1) | (sequence[i] >> 1);
+    hal::setInputPin(2, pins & 1);
+    hal::setInputPin(3, (pins >> 1) & 1);
+  }
+}
+
+// count detents interval ms apart, all queued before one update()
+void turn(bool right, uint8_t count, unsigned long interval)
+{
+  for (uint8_t i = 0; i < count; ++i)
+  {
+    if (i) hal::advanceMillis(interval);
+    detent(right);
+  }
+}
+
+void pause()
+{
+  hal::advanceMillis(500);
+  sRotary.update();
+  sInputs.clear();
+}
+
+void testBurst()
+{
+  // As fast as a hand turns it, the most the queue holds
+  pause();
+  turn(true, EVENT_QUEUE_SIZE - 1, 1);
+  sRotary.update();
+  CHECK_EQUAL(0, sRotary.droppedEvents());
+  CHECK_EQUAL(EVENT_QUEUE_SIZE - 1, sInputs.size());
+  for (size_t i = 0; i < sInputs.size(); ++i) CHECK_EQUAL(evRIGHT, sInputs[i].mEvent);
+
+  // The year from 2018 to 2070 in a few fast spins, updates in between
+  pause();
+  uint16_t pushed = 0;
+  for (uint8_t spin = 0; spin < 6; ++spin)
+  {
+    turn(false, 12, 20);
+    pushed += 12;
+    sRotary.update();
+    hal::advanceMillis(20);
+  }
+  CHECK_EQUAL(0, sRotary.droppedEvents());
+  CHECK_EQUAL(pushed, sInputs.size());
+  uint16_t steps = 0;
+  for (size_t i = 0; i < sInputs.size(); ++i) steps += sInputs[i].mSteps;
+  CHECK_EQUAL(1 + (pushed - 1) * 10, steps);
+}
+
+void testAcceleration()
+{
+  pause();
+  detent(true);
+  const unsigned long intervals[] = { 200, 80, 79, 30, 29, 10 };
+  const uint8_t expected[] = { 1, 1, 4, 4, 10, 10 };
+  for (uint8_t i = 0; i < 6; ++i)
+  {
+    hal::advanceMillis(intervals[i]);
+    detent(true);
+  }
+  hal::advanceMillis(10);
+  detent(false); // A change of direction starts again
+  sRotary.update();
+  CHECK_EQUAL(0, sRotary.droppedEvents());
+  if (!CHECK_EQUAL(8, sInputs.size())) return;
+  CHECK_EQUAL(1, sInputs[0].mSteps);
+  for (uint8_t i = 0; i < 6; ++i)
+  {
+    test::checkEqual(expected[i], sInputs[i + 1].mSteps, "steps", __FILE__, __LINE__);
+  }
+  CHECK_EQUAL(evLEFT, sInputs[7].mEvent);
+  CHECK_EQUAL(1, sInputs[7].mSteps);
+}
+
+void testButton()
+{
+  pause();
+  hal::setInputPin(4, LOW);
+  hal::advanceMillis(100);
+  hal::setInputPin(4, HIGH);
+  hal::advanceMillis(10);
+  turn(true, 3, 20);
+  sRotary.update();
+  if (!CHECK_EQUAL(4, sInputs.size())) return;
+  CHECK_EQUAL(evPRESS, sInputs[0].mEvent);
+  CHECK_EQUAL(1, sInputs[0].mSteps);
+  CHECK_EQUAL(1, sInputs[1].mSteps);
+  CHECK_EQUAL(10, sInputs[2].mSteps);
+}
+
+void testOverflow()
+{
+  // More than the queue holds between two updates is counted, not lost
+  // unnoticed
+  pause();
+  turn(true, EVENT_QUEUE_SIZE + 4, 1);
+  sRotary.update();
+  CHECK_EQUAL(EVENT_QUEUE_SIZE - 1, sInputs.size());
+  CHECK_EQUAL(5, sRotary.droppedEvents());
+}
+
+} // namespace
+
+int main()
+{
+  EventBus::subscribe(BUS_INPUT, inputReceived);
+  sRotary.begin();
+  testBurst();
+  testAcceleration();
+  testButton();
+  testOverflow();
+  return test::testResult("rotaryencoder");
+}
@@ -0,0 +1,170 @@
+/*
+ * RtcControl: calendar helpers, and local time with the daylight saving
+ * switches on the DS3231 fake, which keeps standard time.
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "rtccontrol.h"
+#include "eventbus.h"
+#include "journal.h"
+#include "check.h"
+
+using namespace dusk_dawn_timer;
+
+namespace {
+
+uint8_t sEvents = 0;
+uint8_t sPublished = 0;
+
+void rtcChanged(void*, uint8_t events, const void*)
+{
+  sEvents |= events;
+  sPublished++;
+}
+
+void testDayOfTheWeek()
+{
+  CHECK_EQUAL(1, RtcControl::dayOfTheWeek(2018, 1, 1)); // Monday
+  CHECK_EQUAL(2, RtcControl::dayOfTheWeek(2000, 2, 29)); // Tuesday
+  CHECK_EQUAL(0, RtcControl::dayOfTheWeek(2018, 10, 28)); // Sunday
+  CHECK_EQUAL(3, RtcControl::dayOfTheWeek(2024, 12, 25)); // Wednesday
+  CHECK_EQUAL(6, RtcControl::dayOfTheWeek(2070, 1, 4)); // Saturday
+}
+
+void testCalendar()
+{
+  CHECK_EQUAL(29, RtcControl::getDaysPerMonth(2, 2020));
+  CHECK_EQUAL(28, RtcControl::getDaysPerMonth(2, 2019));
+  CHECK_EQUAL(30, RtcControl::getDaysPerMonth(4, 2019));
+  CHECK_EQUAL(31, RtcControl::getDaysPerMonth(12, 2019));
+
+  uint16_t year = 2018;
+  uint8_t month = 12, day = 31;
+  RtcControl::nextDay(year, month, day);
+  CHECK(year == 2019 && month == 1 && day == 1);
+  year = 2020; month = 2; day = 28;
+  RtcControl::nextDay(year, month, day);
+  CHECK(year == 2020 && month == 2 && day == 29);
+  RtcControl::nextDay(year, month, day);
+  CHECK(year == 2020 && month == 3 && day == 1);
+}
+
+void testIsDayLightSaving()
+{
+  // EU rules: from the last Sunday of March to the last Sunday of October
+  CHECK(!RtcControl::isDayLightSaving(2018, 1, 15));
+  CHECK(!RtcControl::isDayLightSaving(2018, 3, 24));
+  CHECK(RtcControl::isDayLightSaving(2018, 3, 25));
+  CHECK(RtcControl::isDayLightSaving(2018, 7, 1));
+  CHECK(RtcControl::isDayLightSaving(2018, 10, 27));
+  CHECK(!RtcControl::isDayLightSaving(2018, 10, 28));
+  CHECK(!RtcControl::isDayLightSaving(2019, 3, 30));
+  CHECK(RtcControl::isDayLightSaving(2019, 3, 31));
+  CHECK(RtcControl::isDayLightSaving(2019, 10, 26));
+  CHECK(!RtcControl::isDayLightSaving(2019, 10, 27));
+}
+
+// The DS3231 at a standard time; the journal logs with the clock under test
+void begin(RtcControl& rtc, uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second = 0)
+{
+  hal::rtcSetLostPower(false);
+  hal::rtcSet(year, month, day, hour, minute, second);
+  rtc.begin();
+  Journal::begin(&rtc);
+}
+
+// Let the clock run on and take the new time
+void advance(RtcControl& rtc, unsigned long seconds)
+{
+  hal::advanceMillis(seconds * 1000UL);
+  rtc.update();
+}
+
+void testSpringForward()
+{
+  RtcControl rtc;
+  begin(rtc, 2018, 3, 25, 1, 58, 30);
+  CHECK(!rtc.dayLightSaving());
+  CHECK_EQUAL(1 * 60 + 58, rtc.getMinutesSinceMidnight());
+  CHECK_EQUAL(0, rtc.getDayOfTheWeek());
+
+  advance(rtc, 60);
+  CHECK(!rtc.dayLightSaving());
+  CHECK_EQUAL(1 * 60 + 59, rtc.getMinutesSinceMidnight());
+  sEvents = 0;
+  advance(rtc, 60); // 02:00 standard time is 03:00 summer time
+  CHECK(rtc.dayLightSaving());
+  CHECK_EQUAL(3 * 60, rtc.getMinutesSinceMidnight());
+  CHECK_EQUAL(25, rtc.getDay());
+  CHECK_EQUAL(BUS_DATE | BUS_MINUTE, sEvents);
+}
+
+void testFallBack()
+{
+  RtcControl rtc;
+  begin(rtc, 2018, 10, 27, 23, 0);
+  CHECK(rtc.dayLightSaving());
+  CHECK_EQUAL(0, rtc.getMinutesSinceMidnight()); // 00:00 on the 28th
+  CHECK_EQUAL(28, rtc.getDay());
+  advance(rtc, 2);
+  CHECK_EQUAL(0, rtc.getDayOfTheWeek()); // Of the local date
+
+  hal::rtcSet(2018, 10, 28, 1, 59, 30);
+  advance(rtc, 2);
+  CHECK(rtc.dayLightSaving());
+  CHECK_EQUAL(2 * 60 + 59, rtc.getMinutesSinceMidnight());
+  sEvents = 0;
+  advance(rtc, 60); // 02:00 standard time, 03:00 summer time is 02:00 again
+  CHECK(!rtc.dayLightSaving());
+  CHECK_EQUAL(2 * 60, rtc.getMinutesSinceMidnight());
+  CHECK_EQUAL(BUS_DATE | BUS_MINUTE, sEvents);
+  advance(rtc, 3600); // The hour is not repeated a second time
+  CHECK(!rtc.dayLightSaving());
+  CHECK_EQUAL(3 * 60, rtc.getMinutesSinceMidnight());
+}
+
+void testMonthEndInSummerTime()
+{
+  // 23:30 standard time on the last day of a month is the next month
+  RtcControl rtc;
+  begin(rtc, 2018, 6, 30, 23, 30);
+  CHECK_EQUAL(7, rtc.getMonth());
+  CHECK_EQUAL(1, rtc.getDay());
+  CHECK_EQUAL(30, rtc.getMinutesSinceMidnight());
+  advance(rtc, 2);
+  CHECK_EQUAL(0, rtc.getDayOfTheWeek()); // 2018-07-01
+}
+
+void testSetDateTime()
+{
+  RtcControl rtc;
+  begin(rtc, 2018, 1, 1, 12, 0);
+  sEvents = 0;
+  sPublished = 0;
+  rtc.setDateTime(2018, 8, 15, 14 * 60 + 30); // Local, summer time
+  CHECK_EQUAL(BUS_CLOCK_SET | BUS_DATE | BUS_MINUTE, sEvents);
+  CHECK_EQUAL(1, sPublished); // Each subscriber works once
+  CHECK(rtc.dayLightSaving());
+  CHECK_EQUAL(14 * 60 + 30, rtc.getMinutesSinceMidnight());
+  CHECK_EQUAL(3, rtc.getDayOfTheWeek());
+  uint16_t year;
+  uint8_t month, day, hour, minute, second;
+  hal::rtcGet(year, month, day, hour, minute, second);
+  CHECK_EQUAL(13, hour); // Standard time in the chip
+  CHECK_EQUAL(30, minute);
+}
+
+} // namespace
+
+int main()
+{
+  EventBus::subscribe(BUS_MINUTE | BUS_DATE | BUS_CLOCK_SET, rtcChanged);
+  testDayOfTheWeek();
+  testCalendar();
+  testIsDayLightSaving();
+  testSpringForward();
+  testFallBack();
+  testMonthEndInSummerTime();
+  testSetDateTime();
+  return test::testResult("rtccontrol");
+}
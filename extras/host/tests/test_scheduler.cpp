@@ -0,0 +1,129 @@
+/*
+ * Scheduler on the virtual clock: which deadline ends a sleep, what skips
+ * it, the longest sleep, the wrap of millis() and the statistics.
+ *
+ * Each sleep_cpu() wakes exactly 1 ms later here, so a sleep of N ms is N
+ * wakes.
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "scheduler.h"
+#include "check.h"
+
+using namespace dusk_dawn_timer;
+
+namespace {
+
+uint64_t sNotifyAt = 0; // Virtual time in ms an "ISR" calls notify(), 0 is never
+
+uint64_t wakeEveryMillisecond(uint64_t now)
+{
+  const uint64_t wake = now + 1000;
+  if (sNotifyAt && wake / 1000 == sNotifyAt) Scheduler::notify();
+  return wake;
+}
+
+// Milliseconds one sleep() took
+unsigned long sleepTime()
+{
+  const uint64_t start = hal::nowMicros();
+  Scheduler::sleep();
+  return (hal::nowMicros() - start) / 1000;
+}
+
+void testEarliestDeadline()
+{
+  const unsigned long now = millis();
+  Scheduler::runAt(now + 50);
+  Scheduler::runAt(now + 20);
+  Scheduler::runAt(now + 80);
+  Scheduler::runIn(30);
+  CHECK_EQUAL(20, sleepTime());
+  CHECK(!Scheduler::wasNotified());
+  // A deadline only counts for the next sleep
+  Scheduler::runIn(40);
+  CHECK_EQUAL(40, sleepTime());
+}
+
+void testNoSleep()
+{
+  Scheduler::runIn(100);
+  Scheduler::runIn(0);
+  CHECK_EQUAL(0, sleepTime());
+  CHECK(!Scheduler::wasNotified());
+
+  Scheduler::notify();
+  Scheduler::runIn(100);
+  CHECK_EQUAL(0, sleepTime());
+  CHECK(Scheduler::wasNotified());
+  Scheduler::runIn(5);
+  CHECK_EQUAL(5, sleepTime());
+  CHECK(!Scheduler::wasNotified());
+
+  // Input during the sleep ends it
+  sNotifyAt = millis() + 7;
+  Scheduler::runIn(100);
+  CHECK_EQUAL(7, sleepTime());
+  CHECK(Scheduler::wasNotified());
+  sNotifyAt = 0;
+}
+
+void testMaxSleep()
+{
+  CHECK_EQUAL(MAX_SLEEP, sleepTime());
+  Scheduler::runIn(5000);
+  CHECK_EQUAL(MAX_SLEEP, sleepTime());
+  Scheduler::runIn(MAX_SLEEP - 1);
+  CHECK_EQUAL(MAX_SLEEP - 1, sleepTime());
+}
+
+void testWrap()
+{
+  // 100 ms before millis() wraps on the AVR, 2^32 ms after the start
+  const uint64_t wrap = 0x100000000ULL;
+  hal::advanceMillis(wrap - 100 - millis());
+  const unsigned long now = millis();
+  Scheduler::runIn(300);
+  CHECK_EQUAL(300, sleepTime());
+
+  hal::advanceMillis(wrap * 2 - 100 - millis());
+  Scheduler::runAt(now + wrap + 250); // After the wrap
+  Scheduler::runAt(now + wrap + 50); // Before it
+  CHECK_EQUAL(50, sleepTime());
+  Scheduler::runAt(now + wrap + 250);
+  CHECK_EQUAL(200, sleepTime());
+
+  hal::advanceMillis(wrap * 3 - 100 - millis());
+  CHECK_EQUAL(MAX_SLEEP, sleepTime()); // No deadline, across the wrap
+}
+
+void testStatistics()
+{
+  Scheduler::resetStatistics();
+  CHECK_EQUAL(0, Scheduler::getLoopCount());
+  CHECK_EQUAL(0, Scheduler::getWakeCount());
+  for (uint8_t i = 0; i < 3; ++i)
+  {
+    Scheduler::runIn(10);
+    sleepTime();
+  }
+  Scheduler::runIn(0);
+  sleepTime();
+  Scheduler::notify();
+  sleepTime();
+  CHECK_EQUAL(5, Scheduler::getLoopCount());
+  CHECK_EQUAL(30, Scheduler::getWakeCount());
+}
+
+} // namespace
+
+int main()
+{
+  hal::setSleepHandler(wakeEveryMillisecond);
+  testEarliestDeadline();
+  testNoSleep();
+  testMaxSleep();
+  testStatistics();
+  testWrap();
+  return test::testResult("scheduler");
+}
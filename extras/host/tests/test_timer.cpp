@@ -0,0 +1,148 @@
+/*
+ * Timer: switch decisions of the week and weekend programs, at fixed
+ * times and relative to dawn and dusk, and the relay with a manual switch.
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "config.h"
+#include "rtccontrol.h"
+#include "dusk2dawn.h"
+#include "timer.h"
+#include "journal.h"
+#include "check.h"
+
+using namespace dusk_dawn_timer;
+
+namespace {
+
+#define MONDAY 1
+#define THURSDAY 4
+#define FRIDAY 5
+#define SUNDAY 0
+
+int16_t minutes(int hour, int minute)
+{
+  return hour * 60 + minute;
+}
+
+// The switch state and the next switch time at a moment of a day
+void checkAt(const Timer& timer, uint8_t dayOfTheWeek, int minute, bool on, int next, int line)
+{
+  uint16_t nextSwitchTime;
+  bool switchedOn;
+  timer.evaluate(dayOfTheWeek, minute, nextSwitchTime, switchedOn);
+  test::check(switchedOn == on, on ? "switched on" : "switched off", __FILE__, line);
+  test::checkEqual(next, nextSwitchTime, "next switch time", __FILE__, line);
+}
+
+#define CHECK_AT(timer, day, minute, on, next) checkAt(timer, day, minute, on, next, __LINE__)
+
+void testFixedTimes()
+{
+  Dusk2Dawn d2d;
+  Timer timer(nullptr, &d2d);
+  timer.setProgram(SwitchAction(minutes(7, 0)), SwitchAction(minutes(22, 0)),
+                   SwitchAction(minutes(9, 0)), SwitchAction(minutes(23, 30)));
+  CHECK_AT(timer, MONDAY, minutes(6, 59), false, minutes(7, 0));
+  CHECK_AT(timer, MONDAY, minutes(7, 0), true, minutes(22, 0));
+  CHECK_AT(timer, MONDAY, minutes(21, 59), true, minutes(22, 0));
+  CHECK_AT(timer, MONDAY, minutes(22, 0), false, minutes(7, 0)); // Tuesday's
+  // Monday to Thursday is the week program, Friday to Sunday the weekend
+  CHECK_AT(timer, THURSDAY, minutes(23, 0), false, minutes(9, 0)); // Friday's
+  CHECK_AT(timer, FRIDAY, minutes(8, 0), false, minutes(9, 0));
+  CHECK_AT(timer, FRIDAY, minutes(23, 0), true, minutes(23, 30));
+  CHECK_AT(timer, SUNDAY, minutes(23, 45), false, minutes(7, 0)); // Monday's
+}
+
+void testOvernight()
+{
+  // On in the evening, off the next morning
+  Dusk2Dawn d2d;
+  Timer timer(nullptr, &d2d);
+  timer.setProgram(SwitchAction(minutes(22, 0)), SwitchAction(minutes(6, 0)),
+                   SwitchAction(minutes(22, 0)), SwitchAction(minutes(6, 0)));
+  CHECK_AT(timer, MONDAY, minutes(3, 0), true, minutes(6, 0));
+  CHECK_AT(timer, MONDAY, minutes(12, 0), false, minutes(22, 0));
+  CHECK_AT(timer, MONDAY, minutes(22, 30), true, minutes(6, 0));
+}
+
+void testSolar()
+{
+  Dusk2Dawn d2d;
+  d2d.mSunrise = minutes(5, 20);
+  d2d.mSunset = minutes(21, 50);
+  Timer timer(nullptr, &d2d);
+  timer.setProgram(SwitchAction(SUNDOWN, 15), SwitchAction(minutes(23, 0)),
+                   SwitchAction(minutes(6, 0)), SwitchAction(SUNUP, -10));
+  CHECK_AT(timer, MONDAY, minutes(21, 0), false, minutes(22, 5));
+  CHECK_AT(timer, MONDAY, minutes(22, 5), true, minutes(23, 0));
+  CHECK_AT(timer, SUNDAY, minutes(5, 0), true, minutes(5, 10));
+  CHECK_AT(timer, SUNDAY, minutes(5, 10), false, minutes(6, 0));
+  CHECK_AT(timer, SUNDAY, minutes(6, 30), false, minutes(22, 5)); // Monday's
+
+  // Another day's solar times leave today's alone
+  int16_t on, off;
+  timer.getSwitchTimes(MONDAY, minutes(7, 0), minutes(18, 0), on, off);
+  CHECK_EQUAL(minutes(18, 15), on);
+  CHECK_EQUAL(minutes(23, 0), off);
+  timer.getSwitchTimes(SUNDAY, minutes(7, 0), minutes(18, 0), on, off);
+  CHECK_EQUAL(minutes(6, 0), on);
+  CHECK_EQUAL(minutes(6, 50), off);
+  CHECK_AT(timer, MONDAY, minutes(21, 0), false, minutes(22, 5));
+}
+
+bool relayOn()
+{
+  return hal::pinState(RELAY_PIN) == (RELAY_ACTIVE_LOW ? LOW : HIGH);
+}
+
+void testRelay()
+{
+  RtcControl rtc;
+  Dusk2Dawn d2d;
+  Timer timer(&rtc, &d2d);
+  hal::rtcSetLostPower(false);
+  hal::rtcSet(2018, 1, 1, 6, 58); // Monday, winter time
+  rtc.begin();
+  Journal::begin(&rtc);
+  timer.begin();
+  timer.setProgram(SwitchAction(minutes(7, 0)), SwitchAction(minutes(22, 0)),
+                   SwitchAction(minutes(7, 0)), SwitchAction(minutes(22, 0)));
+  timer.update();
+  CHECK(!timer.isSwitchedOn());
+  CHECK(!relayOn());
+
+  hal::advanceMillis(120000UL);
+  rtc.update();
+  timer.update();
+  CHECK(timer.isSwitchedOn());
+  CHECK(relayOn());
+
+  // Switched by hand until the next switch time, then the program again
+  timer.manualSwitch();
+  timer.update();
+  CHECK(timer.isSwitchedManual());
+  CHECK(!relayOn());
+  hal::rtcSet(2018, 1, 1, 21, 59, 30);
+  hal::advanceMillis(2000);
+  rtc.update();
+  timer.update();
+  CHECK(!relayOn());
+  hal::advanceMillis(60000UL);
+  rtc.update();
+  timer.update();
+  CHECK(!timer.isSwitchedManual());
+  CHECK(!relayOn());
+  CHECK_EQUAL(minutes(7, 0), timer.getNextSwitchTime());
+}
+
+} // namespace
+
+int main()
+{
+  testFixedTimes();
+  testOvernight();
+  testSolar();
+  testRelay();
+  return test::testResult("timer");
+}
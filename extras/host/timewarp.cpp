@@ -0,0 +1,165 @@
+/*
+ * Time-warp simulator
+ *
+ * Runs the real sketch (setup() and loop()) for months or years of virtual
+ * time and logs every relay transition. Instead of idling through every
+ * timer 0 tick, each sleep of the sketch jumps straight to the next event
+ * that can matter: the next switch time of the timer or the next full hour
+ * (midnight, the daylight saving checks), whichever comes first.
+ * Transitions are logged in standard time, as the DS3231 keeps it.
+ *
+ * Usage: timewarp [--start YYYY-MM-DD] [--days N] [--minutes] [--golden FILE]
+ *
+ *   --start     first day, the simulation starts at 00:00 (default 2018-01-01)
+ *   --days      number of days to run (default 366)
+ *   --minutes   wake every minute instead of jumping, to cross-check the
+ *               jumps
+ *   --golden    compare the transitions with FILE instead of printing them;
+ *               the exit status is 1 when they differ
+ */
+#include "Arduino.h"
+#include "hal.h"
+#include "timer.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+extern dusk_dawn_timer::RtcControl rtcControl;
+extern dusk_dawn_timer::Timer timer;
+
+namespace {
+
+#define RELAY_PIN A2 // Active low
+
+bool sEveryMinute = false;
+std::vector<std::string> sTransitions;
+
+std::string rtcTimeString()
+{
+  uint16_t year;
+  uint8_t month, day, hour, minute, second;
+  hal::rtcGet(year, month, day, hour, minute, second);
+  char text[32];
+  snprintf(text, sizeof(text), "%04u-%02u-%02u %02u:%02u", year, month, day, hour, minute);
+  return text;
+}
+
+void relayChanged(uint8_t pin, uint8_t value)
+{
+  if (pin != RELAY_PIN) return;
+  sTransitions.push_back(rtcTimeString() + (value == LOW ? " on" : " off"));
+}
+
+uint64_t nextEvent(uint64_t now)
+{
+  uint16_t year;
+  uint8_t month, day, hour, minute, second;
+  hal::rtcGet(year, month, day, hour, minute, second);
+  const uint16_t minuteOfDay = hour * 60 + minute;
+  uint16_t next = minuteOfDay + 1;
+  if (!sEveryMinute)
+  {
+    next = (hour + 1) * 60;
+    // The switch times are local time, the DS3231 keeps standard time
+    const int16_t switchTime = timer.getNextSwitchTime() - (rtcControl.dayLightSaving() ? 60 : 0);
+    if (switchTime > minuteOfDay && switchTime < next) next = switchTime;
+  }
+  return now + (static_cast<uint64_t>(next - minuteOfDay) * 60 - second) * 1000000;
+}
+
+bool readLines(const char* path, std::vector<std::string>& lines)
+{
+  FILE* in = fopen(path, "r");
+  if (!in) return false;
+  char line[128];
+  while (fgets(line, sizeof(line), in))
+  {
+    std::string text(line);
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) text.pop_back();
+    if (!text.empty()) lines.push_back(text);
+  }
+  fclose(in);
+  return true;
+}
+
+// Prints the lines that differ, at most a screenful; returns the count
+size_t compare(const std::vector<std::string>& expected, const std::vector<std::string>& actual)
+{
+  size_t differences = 0;
+  const size_t lines = std::max(expected.size(), actual.size());
+  for (size_t i = 0; i < lines; ++i)
+  {
+    const std::string want = i < expected.size() ? expected[i] : "(none)";
+    const std::string got = i < actual.size() ? actual[i] : "(none)";
+    if (want == got) continue;
+    if (++differences <= 20) printf("line %zu: expected '%s', got '%s'\n", i + 1, want.c_str(), got.c_str());
+  }
+  return differences;
+}
+
+void usage(const char* program)
+{
+  fprintf(stderr, "Usage: %s [--start YYYY-MM-DD] [--days N] [--minutes] [--golden FILE]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  int year = 2018, month = 1, day = 1;
+  long days = 366;
+  const char* golden = nullptr;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string option(argv[i]);
+    if (option == "--start" && i + 1 < argc && sscanf(argv[i + 1], "%d-%d-%d", &year, &month, &day) == 3) i++;
+    else if (option == "--days" && i + 1 < argc) days = atol(argv[++i]);
+    else if (option == "--minutes") sEveryMinute = true;
+    else if (option == "--golden" && i + 1 < argc) golden = argv[++i];
+    else
+    {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (days <= 0)
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  hal::rtcSet(year, month, day, 0, 0);
+  hal::setPinListener(relayChanged);
+  hal::setSleepHandler(nextEvent);
+  setup();
+  const uint64_t end = hal::nowMicros() + static_cast<uint64_t>(days) * 86400 * 1000000;
+  unsigned long loops = 0;
+  while (hal::nowMicros() < end)
+  {
+    loop();
+    loops++;
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fprintf(stderr, "%ld days, %zu transitions, %lu loops in %.3f s (%.1f years/s)\n",
+          days, sTransitions.size(), loops, seconds, days / 365.25 / seconds);
+
+  if (!golden)
+  {
+    for (size_t i = 0; i < sTransitions.size(); ++i) printf("%s\n", sTransitions[i].c_str());
+    return 0;
+  }
+  std::vector<std::string> expected;
+  if (!readLines(golden, expected))
+  {
+    fprintf(stderr, "Cannot read %s\n", golden);
+    return 2;
+  }
+  const size_t differences = compare(expected, sTransitions);
+  if (differences) printf("%zu of %zu lines differ\n", differences, std::max(expected.size(), sTransitions.size()));
+  return differences ? 1 : 0;
+}
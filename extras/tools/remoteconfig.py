@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""Read or push the configuration of a timer over the serial port.
+
+Sends one remote configuration frame (see remoteconfig.h) and prints the
+configuration the unit replies with. Without settings it only reads:
+
+    extras/tools/remoteconfig.py --port /dev/ttyUSB0
+    extras/tools/remoteconfig.py --port /dev/ttyUSB0 --time now \\
+        --week sunset+15 22:15 --weekend sunset+15 22:45 --blank 5 \\
+        --location 52.0971 5.0683 60
+
+--standin runs a command instead, e.g. the host build of the sketch
+(extras/host/standin), and talks to it over its standard input and output.
+A switch action is "HH:MM", "sunrise" or "sunset" with an optional offset in
+minutes, e.g. "sunset-10". Reading a serial port needs pyserial.
+"""
+
+import argparse
+import datetime
+import os
+import re
+import select
+import shlex
+import struct
+import subprocess
+import sys
+import time
+
+from telemetry import START, Decoder, crc16
+
+GET = 0x10
+SET = 0x11
+REPLY = 0x90
+
+DATE_TIME, WEEK, WEEKEND, OPTIONS, LOCATION = 0x01, 0x02, 0x04, 0x08, 0x10
+FIELDS = ((DATE_TIME, 'time'), (WEEK, 'week'), (WEEKEND, 'weekend'), (OPTIONS, 'options'),
+          (LOCATION, 'location'))
+STATUS = ('ok', 'bad CRC', 'bad value', 'bad request')
+
+TIME, SUNUP, SUNDOWN = 0, 1, 2
+REPLY_FORMAT = '<BBHBBHBhBhBhBhBffh'
+
+REPLY_TIMEOUT = 3  # seconds
+
+
+def frame(frame_type, payload=b''):
+    body = bytes([frame_type, len(payload)]) + payload
+    return bytes([START]) + body + struct.pack('<H', crc16(body))
+
+
+def parse_action(text):
+    match = re.fullmatch(r'(\d{1,2}):(\d{2})', text)
+    if match:
+        hour, minute = int(match.group(1)), int(match.group(2))
+        if hour > 23 or minute > 59:
+            raise argparse.ArgumentTypeError('invalid time %s' % text)
+        return TIME, hour * 60 + minute
+    match = re.fullmatch(r'(sunrise|sunset)([+-]\d+)?', text)
+    if not match:
+        raise argparse.ArgumentTypeError('invalid switch action %s' % text)
+    offset = int(match.group(2) or 0)
+    if not -59 <= offset <= 59:
+        raise argparse.ArgumentTypeError('offset out of range in %s' % text)
+    return SUNUP if match.group(1) == 'sunrise' else SUNDOWN, offset
+
+
+def format_action(action_type, value):
+    if action_type == TIME:
+        return '%02d:%02d' % (value // 60, value % 60)
+    name = 'sunrise' if action_type == SUNUP else 'sunset'
+    return name + ('%+d' % value if value else '')
+
+
+def set_payload(args):
+    fields = 0
+    payload = b''
+    if args.time:
+        when = datetime.datetime.now() if args.time == 'now' else \
+            datetime.datetime.strptime(args.time, '%Y-%m-%d %H:%M')
+        fields |= DATE_TIME
+        payload += struct.pack('<HBBH', when.year, when.month, when.day, when.hour * 60 + when.minute)
+    for bit, program in ((WEEK, args.week), (WEEKEND, args.weekend)):
+        if program:
+            fields |= bit
+            on, off = (parse_action(action) for action in program)
+            payload += struct.pack('<BhBh', on[0], on[1], off[0], off[1])
+    if args.blank is not None:
+        fields |= OPTIONS
+        payload += struct.pack('<B', args.blank)
+    if args.location:
+        fields |= LOCATION
+        latitude, longitude, timezone = args.location
+        payload += struct.pack('<ffh', float(latitude), float(longitude), int(timezone))
+    return bytes([fields]) + payload if fields else None
+
+
+def print_reply(payload):
+    (status, applied, year, month, day, minutes, week_on_type, week_on, week_off_type, week_off,
+     weekend_on_type, weekend_on, weekend_off_type, weekend_off, blank, latitude, longitude,
+     timezone) = struct.unpack(REPLY_FORMAT, payload)
+    print('status    %s' % (STATUS[status] if status < len(STATUS) else status))
+    print('applied   %s' % (' '.join(name for bit, name in FIELDS if applied & bit) or '-'))
+    print('time      %04d-%02d-%02d %02d:%02d' % (year, month, day, minutes // 60, minutes % 60))
+    print('week      %s %s' % (format_action(week_on_type, week_on), format_action(week_off_type, week_off)))
+    print('weekend   %s %s' % (format_action(weekend_on_type, weekend_on),
+                               format_action(weekend_off_type, weekend_off)))
+    print('blank     %s' % ('%d min' % blank if blank else 'never'))
+    print('location  %.4f %.4f GMT%+g' % (latitude, longitude, timezone / 60))
+    return status
+
+
+class Standin:
+    """A command that stands in for the serial port."""
+
+    def __init__(self, command):
+        self.process = subprocess.Popen(shlex.split(command), stdin=subprocess.PIPE,
+                                        stdout=subprocess.PIPE)
+
+    def write(self, data):
+        self.process.stdin.write(data)
+        self.process.stdin.flush()
+
+    def read(self, timeout):
+        ready, _, _ = select.select([self.process.stdout], [], [], timeout)
+        return os.read(self.process.stdout.fileno(), 256) if ready else b''
+
+    def close(self):
+        self.process.stdin.close()
+        self.process.wait()
+
+
+class Port:
+    def __init__(self, device, baud):
+        import serial
+        self.port = serial.Serial(device, baud, timeout=0.1)
+
+    def write(self, data):
+        self.port.write(data)
+
+    def read(self, timeout):
+        return self.port.read(256)
+
+    def close(self):
+        self.port.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument('--port', help='serial port of the unit')
+    target.add_argument('--standin', metavar='COMMAND', help='command that stands in for a unit')
+    parser.add_argument('--baud', type=int, default=57600)
+    parser.add_argument('--time', help='"now" or "YYYY-MM-DD HH:MM", local time')
+    parser.add_argument('--week', nargs=2, metavar=('ON', 'OFF'), help='Monday to Thursday program')
+    parser.add_argument('--weekend', nargs=2, metavar=('ON', 'OFF'), help='Friday to Sunday program')
+    parser.add_argument('--blank', type=int, help='screen blank timeout in minutes, 0 never')
+    parser.add_argument('--location', nargs=3, metavar=('LAT', 'LON', 'TZ'),
+                        help='degrees and time zone in minutes east of GMT')
+    args = parser.parse_args()
+
+    try:
+        payload = set_payload(args)
+    except (argparse.ArgumentTypeError, ValueError) as error:
+        parser.error(str(error))
+    request = frame(SET, payload) if payload else frame(GET)
+
+    link = Standin(args.standin) if args.standin else Port(args.port, args.baud)
+    decoder = Decoder()
+    status = None
+    try:
+        if args.port:
+            time.sleep(2)  # Opening the port resets an Arduino, wait for the boot
+        link.write(request)
+        deadline = time.time() + REPLY_TIMEOUT
+        while status is None and time.time() < deadline:
+            for frame_type, reply in decoder.feed(link.read(0.1)):
+                if frame_type == REPLY and len(reply) == struct.calcsize(REPLY_FORMAT):
+                    status = print_reply(reply)
+                    break
+    finally:
+        link.close()
+    if status is None:
+        print('No reply', file=sys.stderr)
+        return 1
+    return 0 if status == 0 else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
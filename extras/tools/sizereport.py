@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Static RAM and flash per module from an Arduino build directory.
+
+Runs avr-size on every object file of the build and on the linked ELF, and
+checks the totals against a budget:
+
+    arduino-cli compile --build-path /tmp/build .
+    extras/tools/sizereport.py /tmp/build
+
+Sketch modules are listed one by one; the Arduino core and each library are
+summed up as one line. Whatever SRAM is left after the static data is shared
+by the heap and the stack, compare it with the stack high-water mark on the
+diagnostics screen.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+RAM_SIZE = 2048     # ATmega328
+FLASH_SIZE = 32256  # 32 KB less the 512 byte bootloader
+
+# Constant data outside PROGMEM (.rodata) is copied to the SRAM like .data
+FLASH_SECTIONS = ('.text', '.progmem', '.data', '.rodata', '.jumptables')
+RAM_SECTIONS = ('.data', '.rodata', '.bss', '.noinit')
+
+
+def section_sizes(size_tool, path):
+    """Section name to size, from the System V output of size -A."""
+    output = subprocess.run([size_tool, '-A', path], check=True,
+                            stdout=subprocess.PIPE, universal_newlines=True).stdout
+    sizes = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0].startswith('.') and fields[1].isdigit():
+            sizes[fields[0]] = sizes.get(fields[0], 0) + int(fields[1])
+    return sizes
+
+
+def summarize(sizes):
+    """Flash, initialized RAM and zeroed RAM of a set of sections."""
+    def total(prefixes):
+        return sum(size for name, size in sizes.items()
+                   if any(name == p or name.startswith(p + '.') for p in prefixes))
+    data = total(('.data', '.rodata'))
+    bss = total(('.bss', '.noinit'))
+    return total(FLASH_SECTIONS), data, bss
+
+
+def module_name(build_dir, path):
+    """Sketch objects by file, the core and libraries as one group each."""
+    parts = os.path.relpath(path, build_dir).split(os.sep)
+    if parts[0] == 'core':
+        return 'core'
+    if parts[0] == 'libraries' and len(parts) > 1:
+        return parts[1]
+    name = os.path.basename(path)
+    for suffix in ('.cpp.o', '.ino.o', '.c.o', '.S.o', '.o'):
+        if name.endswith(suffix):
+            return name[:-len(suffix)] + '.o'
+    return name
+
+
+def find_files(build_dir, suffix):
+    for root, _, files in os.walk(build_dir):
+        for name in sorted(files):
+            if name.endswith(suffix):
+                yield os.path.join(root, name)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('build_dir', help='build directory with the object files')
+    parser.add_argument('--size', default='avr-size', help='size tool (default avr-size)')
+    parser.add_argument('--ram-budget', type=int, default=RAM_SIZE,
+                        help='static RAM allowed in bytes (default %d)' % RAM_SIZE)
+    parser.add_argument('--flash-budget', type=int, default=FLASH_SIZE,
+                        help='flash allowed in bytes (default %d)' % FLASH_SIZE)
+    args = parser.parse_args()
+
+    modules = {}
+    for path in find_files(args.build_dir, '.o'):
+        flash, data, bss = summarize(section_sizes(args.size, path))
+        name = module_name(args.build_dir, path)
+        total = modules.setdefault(name, [0, 0, 0])
+        total[0] += flash
+        total[1] += data
+        total[2] += bss
+    if not modules:
+        sys.exit('No object files in %s' % args.build_dir)
+
+    print('%-24s %7s %7s %7s %7s' % ('module', 'flash', 'data', 'bss', 'ram'))
+    for name, (flash, data, bss) in sorted(modules.items(), key=lambda m: (-(m[1][1] + m[1][2]), m[0])):
+        print('%-24s %7d %7d %7d %7d' % (name, flash, data, bss, data + bss))
+    flash = sum(m[0] for m in modules.values())
+    ram = sum(m[1] + m[2] for m in modules.values())
+    print('%-24s %7d %15s %7d' % ('objects', flash, '', ram))
+
+    # The linked program drops unused code and adds the vectors and libc
+    elves = list(find_files(args.build_dir, '.elf'))
+    if elves:
+        flash, data, bss = summarize(section_sizes(args.size, elves[0]))
+        ram = data + bss
+        print('%-24s %7d %7d %7d %7d' % (os.path.basename(elves[0]), flash, data, bss, ram))
+
+    print('SRAM left for heap and stack: %d bytes' % (RAM_SIZE - ram))
+    over = False
+    if ram > args.ram_budget:
+        print('Static RAM %d exceeds the budget of %d bytes' % (ram, args.ram_budget))
+        over = True
+    if flash > args.flash_budget:
+        print('Flash %d exceeds the budget of %d bytes' % (flash, args.flash_budget))
+        over = True
+    sys.exit(1 if over else 0)
+
+
+if __name__ == '__main__':
+    main()
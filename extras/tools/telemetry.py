@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Decode the binary telemetry frames of the timer (see telemetry.h).
+
+Reads a capture file, standard input or a serial port and prints one line
+per valid frame:
+
+    extras/tools/telemetry.py capture.bin
+    extras/tools/telemetry.py --port /dev/ttyUSB0 --baud 57600
+
+Bytes outside frames, such as the text reports of the diagnostics, are
+skipped; frames with a bad CRC are counted and skipped as well. --csv
+prints comma separated values instead. Reading a serial port needs pyserial.
+"""
+
+import argparse
+import struct
+import sys
+
+START = 0xA5
+STATUS = 1
+STATUS_FORMAT = '<BHBBHBHHHIIBH'
+STATUS_SIZE = struct.calcsize(STATUS_FORMAT)
+
+REASONS = ((0x01, 'boot'), (0x02, 'relay'), (0x04, 'next'), (0x08, 'day'), (0x10, 'clock'))
+RESET_CAUSES = ((0x01, 'power-on'), (0x02, 'external'), (0x04, 'brown-out'), (0x08, 'watchdog'))
+
+FIELDS = ('reasons', 'date', 'time', 'relay', 'manual', 'dst', 'next', 'sunrise', 'sunset',
+          'loops', 'wakes', 'reset', 'dropped')
+
+
+def crc16(data, crc=0xFFFF):
+    """avr-libc _crc16_update."""
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def bits(value, names):
+    return '+'.join(name for bit, name in names if value & bit) or '-'
+
+
+def hhmm(minutes):
+    if minutes >= 24 * 60:
+        return '--:--'
+    return '%02d:%02d' % (minutes // 60, minutes % 60)
+
+
+class Decoder:
+    """Incremental frame decoder, feed() returns (type, payload) of the
+    complete frames."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.crc_errors = 0
+        self.skipped = 0
+
+    def feed(self, data):
+        self.buffer.extend(data)
+        frames = []
+        while True:
+            start = self.buffer.find(START)
+            if start < 0:
+                self.skipped += len(self.buffer)
+                self.buffer.clear()
+                break
+            self.skipped += start
+            del self.buffer[:start]
+            if len(self.buffer) < 3:
+                break
+            size = 3 + self.buffer[2] + 2
+            if len(self.buffer) < size:
+                break
+            body = bytes(self.buffer[1:size - 2])
+            crc, = struct.unpack('<H', self.buffer[size - 2:size])
+            if crc16(body) != crc:
+                # Not a frame after all, resync on the next start byte
+                self.crc_errors += 1
+                del self.buffer[:1]
+                continue
+            del self.buffer[:size]
+            frames.append((body[0], body[2:]))
+        return frames
+
+
+def decode_status(payload):
+    (reasons, year, month, day, minutes, flags, next_switch, sunrise, sunset,
+     loops, wakes, reset, dropped) = struct.unpack(STATUS_FORMAT, payload)
+    return {
+        'reasons': bits(reasons, REASONS),
+        'date': '%04d-%02d-%02d' % (year, month, day),
+        'time': hhmm(minutes),
+        'relay': 'on' if flags & 0x01 else 'off',
+        'manual': int(bool(flags & 0x02)),
+        'dst': int(bool(flags & 0x04)),
+        'next': hhmm(next_switch),
+        'sunrise': hhmm(sunrise),
+        'sunset': hhmm(sunset),
+        'loops': loops,
+        'wakes': wakes,
+        'reset': bits(reset, RESET_CAUSES),
+        'dropped': dropped,
+    }
+
+
+def chunks(args):
+    if args.port:
+        import serial
+        with serial.Serial(args.port, args.baud, timeout=1) as port:
+            while True:
+                yield port.read(256)
+    else:
+        source = open(args.file, 'rb') if args.file != '-' else sys.stdin.buffer
+        with source:
+            while True:
+                data = source.read(4096)
+                if not data:
+                    break
+                yield data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('file', nargs='?', default='-', help='capture file, - for standard input')
+    parser.add_argument('--port', help='serial port to read instead of a file')
+    parser.add_argument('--baud', type=int, default=57600)
+    parser.add_argument('--csv', action='store_true', help='comma separated output')
+    args = parser.parse_args()
+
+    decoder = Decoder()
+    if args.csv:
+        print(','.join(FIELDS))
+    try:
+        for data in chunks(args):
+            for frame_type, payload in decoder.feed(data):
+                if frame_type != STATUS or len(payload) != STATUS_SIZE:
+                    continue
+                frame = decode_status(payload)
+                if args.csv:
+                    print(','.join(str(frame[field]) for field in FIELDS))
+                else:
+                    print('%(date)s %(time)s %(reasons)-12s relay %(relay)-3s next %(next)s '
+                          'sun %(sunrise)s-%(sunset)s loops %(loops)d wakes %(wakes)d '
+                          'reset %(reset)s dropped %(dropped)d' % frame)
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    if decoder.crc_errors:
+        print('%d bad frames' % decoder.crc_errors, file=sys.stderr)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,333 @@
+/*
+ * Append-only journal of switch events and settings changes (EEPROM)
+ */
+#include "journal.h"
+#include "persist.h"
+#include "eepromjobs.h"
+#include "scheduler.h"
+#include <EEPROM.h>
+
+namespace dusk_dawn_timer {
+
+#define JOURNAL_START PERSIST_AREA_SIZE
+// (1024 - JOURNAL_START) / sizeof(JournalRecord); not a multiple of 256, so
+// the 8 bit sequence number always breaks at the head.
+#define JOURNAL_SLOTS 160
+
+#define JOURNAL_BYTES (JOURNAL_SLOTS * sizeof(JournalRecord))
+
+#define FIRST_YEAR 2000
+
+#define WRITE_BYTES 2 // Bytes programmed per update(), 3.3 ms each
+
+static const char JBOOT[] PROGMEM = "boot";
+static const char JTIME_SET[] PROGMEM = "time set";
+static const char JSYNC[] PROGMEM = "sync";
+static const char JSWITCH[] PROGMEM = "switch";
+static const char JMANUAL[] PROGMEM = "manual";
+static const char JWEEK_ON[] PROGMEM = "week on";
+static const char JWEEK_OFF[] PROGMEM = "week off";
+static const char JWEEKEND_ON[] PROGMEM = "weekend on";
+static const char JWEEKEND_OFF[] PROGMEM = "weekend off";
+static const char JBLANK_TIMEOUT[] PROGMEM = "blank timeout";
+static const char JFACTORY_RESET[] PROGMEM = "factory reset";
+static const char JLOCATION[] PROGMEM = "location";
+
+const char* const sEventNames[] PROGMEM = {JBOOT, JTIME_SET, JSYNC, JSWITCH, JMANUAL,
+  JWEEK_ON, JWEEK_OFF, JWEEKEND_ON, JWEEKEND_OFF, JBLANK_TIMEOUT, JFACTORY_RESET, JLOCATION};
+
+RtcControl* Journal::sRtc;
+uint8_t Journal::sHead;
+uint8_t Journal::sCount;
+uint8_t Journal::sSequence;
+uint32_t Journal::sLastTime;
+JournalRecord Journal::sQueue[JOURNAL_QUEUE_SIZE];
+uint8_t Journal::sQueueFirst;
+uint8_t Journal::sQueued;
+uint8_t Journal::sQueueByte;
+uint8_t Journal::sDropped;
+bool Journal::sErasePending;
+
+void Journal::begin(RtcControl* rtc)
+{
+  sRtc = rtc;
+  sHead = 0;
+  sCount = 0;
+  sSequence = 0;
+  JournalRecord record;
+  read(0, record);
+  if (isUsed(record))
+  {
+    uint8_t sequence = record.mSequence;
+    uint8_t slot = 1;
+    for (; slot < JOURNAL_SLOTS; ++slot)
+    {
+      read(slot, record);
+      if (!isUsed(record) || record.mSequence != static_cast<uint8_t>(sequence + 1)) break;
+      sequence = record.mSequence;
+    }
+    sHead = slot % JOURNAL_SLOTS;
+    sSequence = sequence + 1;
+    sCount = (slot < JOURNAL_SLOTS && !isUsed(record)) ? slot : JOURNAL_SLOTS;
+  }
+  logAbsolute(jeBOOT);
+}
+
+void Journal::log(const uint8_t& code, const int16_t& value)
+{
+  EepromJobs::lock();
+  const uint32_t time = now();
+  if (time < sLastTime || time - sLastTime > 0xFFFF)
+  {
+    logAbsolute(jeSYNC);
+  }
+  if (append(code, time - sLastTime, value)) sLastTime = time;
+  EepromJobs::unlock();
+}
+
+void Journal::timeSet()
+{
+  EepromJobs::lock();
+  logAbsolute(jeTIME_SET);
+  EepromJobs::unlock();
+}
+
+void Journal::logAbsolute(const uint8_t& code)
+{
+  const uint32_t time = now();
+  if (append(code, time & 0xFFFF, time >> 16)) sLastTime = time;
+}
+
+/*
+ * Minutes since 2000-01-01, local time.
+ */
+uint32_t Journal::now()
+{
+  const uint16_t year = sRtc->getYear();
+  uint16_t days = sRtc->getDay() - 1;
+  for (uint8_t month = 1; month < sRtc->getMonth(); ++month)
+  {
+    days += RtcControl::getDaysPerMonth(month, year);
+  }
+  for (uint16_t y = FIRST_YEAR; y < year; ++y)
+  {
+    days += (y % 4 == 0) ? 366 : 365; // Good until 2099
+  }
+  return static_cast<uint32_t>(days) * MINUTES_PER_DAY + sRtc->getMinutesSinceMidnight();
+}
+
+/*
+ * Queues the record and reserves its slot. When the queue is full the
+ * oldest records are written right away; while an EEPROM job runs they
+ * cannot be, and the record is dropped. Returns false then.
+ */
+bool Journal::append(const uint8_t& code, const uint16_t& delta, const int16_t& value)
+{
+  if (sQueued == JOURNAL_QUEUE_SIZE) flush();
+  if (sQueued == JOURNAL_QUEUE_SIZE)
+  {
+    if (sDropped < 0xFF) sDropped++;
+    return false;
+  }
+  JournalRecord& record = sQueue[(sQueueFirst + sQueued) % JOURNAL_QUEUE_SIZE];
+  record.mSequence = sSequence++;
+  record.mCode = code;
+  record.mDelta = delta;
+  record.mValue = value;
+  sQueued++;
+  sHead = (sHead + 1) % JOURNAL_SLOTS;
+  if (sCount < JOURNAL_SLOTS) sCount++;
+  return true;
+}
+
+void Journal::update()
+{
+  if (sErasePending && EepromJobs::fill(JOURNAL_START, JOURNAL_BYTES, 0xFF)) sErasePending = false;
+  if (isErasing())
+  {
+    if (sErasePending) Scheduler::runIn(0);
+    return;
+  }
+  EepromJobs::lock();
+  for (uint8_t i = 0; i < WRITE_BYTES && sQueued > 0; ++i)
+  {
+    writeByte();
+  }
+  EepromJobs::unlock();
+  if (sQueued > 0) Scheduler::runIn(0);
+}
+
+/*
+ * Queued records are dropped; the journal restarts with the absolute time.
+ * When the EEPROM job queue is full, update() queues the erase later and
+ * nothing is written until then.
+ */
+void Journal::erase()
+{
+  EepromJobs::lock();
+  sHead = 0;
+  sCount = 0;
+  sQueueFirst = 0;
+  sQueued = 0;
+  sQueueByte = 0;
+  sErasePending = !EepromJobs::fill(JOURNAL_START, JOURNAL_BYTES, 0xFF);
+  logAbsolute(jeSYNC);
+  EepromJobs::unlock();
+}
+
+/*
+ * Also called from the watchdog interrupt, before the watchdog resets a
+ * hanging loop, unless the loop hangs holding the EepromJobs lock.
+ */
+uint8_t Journal::flush(const uint8_t& maxBytes)
+{
+  if (isErasing()) return 0;
+  uint8_t written = 0;
+  while (sQueued > 0 && written < maxBytes)
+  {
+    writeByte();
+    written++;
+  }
+  return written;
+}
+
+/*
+ * Programs the next byte of the first queued record. The sequence number
+ * is written last: a write interrupted by a reset leaves the previous
+ * sequence number and cannot move the head.
+ */
+void Journal::writeByte()
+{
+  const uint8_t slot = (sHead + JOURNAL_SLOTS - sQueued) % JOURNAL_SLOTS;
+  const uint8_t index = (sQueueByte + 1) % sizeof(JournalRecord); // 1..5, then 0
+  EEPROM.update(JOURNAL_START + slot * sizeof(JournalRecord) + index,
+                reinterpret_cast<const uint8_t*>(&sQueue[sQueueFirst])[index]);
+  if (++sQueueByte == sizeof(JournalRecord))
+  {
+    sQueueByte = 0;
+    sQueueFirst = (sQueueFirst + 1) % JOURNAL_QUEUE_SIZE;
+    sQueued--;
+  }
+}
+
+void Journal::read(const uint8_t& slot, JournalRecord& record)
+{
+  EEPROM.get(JOURNAL_START + slot * sizeof(JournalRecord), record);
+}
+
+bool Journal::isUsed(const JournalRecord& record)
+{
+  return record.mCode != 0x00 && record.mCode != 0xFF;
+}
+
+/*
+ * Also while another EEPROM job runs: the journal area may be the next one
+ * to be erased.
+ */
+bool Journal::isErasing()
+{
+  return sErasePending || EepromJobs::isBusy();
+}
+
+/*
+ * Prints the journal, oldest record first. Records before the first
+ * absolute time stamp have no time.
+ */
+void Journal::dump(Print& out)
+{
+  if (isErasing())
+  {
+    out.println(F("Journal busy"));
+    return;
+  }
+  EepromJobs::lock();
+  flush();
+  EepromJobs::unlock();
+  out.print(F("Journal, records "));
+  out.print(sCount);
+  if (sDropped)
+  {
+    out.print(F(", dropped "));
+    out.print(sDropped);
+  }
+  out.println();
+  uint8_t slot = (sHead + JOURNAL_SLOTS - sCount) % JOURNAL_SLOTS;
+  uint32_t time = 0;
+  bool timeKnown = false;
+  for (uint8_t i = 0; i < sCount; ++i)
+  {
+    JournalRecord record;
+    read(slot, record);
+    slot = (slot + 1) % JOURNAL_SLOTS;
+    if (record.mCode <= jeSYNC)
+    {
+      time = (static_cast<uint32_t>(static_cast<uint16_t>(record.mValue)) << 16) | record.mDelta;
+      timeKnown = true;
+    }
+    else
+    {
+      time += record.mDelta;
+    }
+    if (timeKnown) printTime(out, time);
+    else out.print(F("????" "-??" "-?? ??:??")); // Split, "??-" is a trigraph
+    out.print(' ');
+    if (record.mCode > jeLOCATION)
+    {
+      out.print(F("code "));
+      out.print(record.mCode);
+    }
+    else
+    {
+      out.print((const __FlashStringHelper*) pgm_read_word(&sEventNames[record.mCode - 1]));
+    }
+    switch (record.mCode)
+    {
+      case jeSWITCH:
+        out.print(record.mValue & JOURNAL_SWITCH_ON ? F(" on") : F(" off"));
+        if (record.mValue & JOURNAL_SWITCH_MANUAL) out.print(F(" (manual)"));
+        break;
+      case jeWEEK_ON:
+      case jeWEEK_OFF:
+      case jeWEEKEND_ON:
+      case jeWEEKEND_OFF:
+        out.print(F(" type "));
+        out.print(static_cast<uint16_t>(record.mValue) >> 13);
+        out.print(F(" time "));
+        out.print(static_cast<int16_t>(record.mValue << 3) >> 3);
+        break;
+      case jeMANUAL:
+      case jeBLANK_TIMEOUT:
+      case jeLOCATION:
+        out.print(' ');
+        out.print(record.mValue);
+        break;
+    }
+    out.println();
+  }
+}
+
+void Journal::printTime(Print& out, uint32_t minutes)
+{
+  uint16_t days = minutes / MINUTES_PER_DAY;
+  minutes %= MINUTES_PER_DAY;
+  uint16_t year = FIRST_YEAR;
+  while (days >= ((year % 4 == 0) ? 366 : 365))
+  {
+    days -= (year % 4 == 0) ? 366 : 365;
+    year++;
+  }
+  uint8_t month = 1;
+  while (days >= RtcControl::getDaysPerMonth(month, year))
+  {
+    days -= RtcControl::getDaysPerMonth(month, year);
+    month++;
+  }
+  const uint8_t day = days + 1;
+  // 16 characters, sized for any uint16_t year so the format can't truncate
+  char text[22];
+  snprintf_P(text, sizeof(text), PSTR("%04u-%02hhu-%02hhu %02hhu:%02hhu"), year, month, day,
+             RtcControl::hours(minutes), RtcControl::minutes(minutes));
+  out.print(text);
+}
+
+} // namespace
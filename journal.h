@@ -0,0 +1,92 @@
+/*
+ * Append-only journal of switch events and settings changes (EEPROM)
+ *
+ * The EEPROM behind the configuration block is a ring of fixed size
+ * records. Every record carries a sequence number that increments by one;
+ * the newest record is the one where that sequence breaks. Records are
+ * written in order around the ring, so every cell is programmed equally
+ * often.
+ * Time stamps are minute deltas to the previous record. Boot, setting the
+ * clock and deltas that do not fit write a record with the absolute time.
+ * log() only queues the record in RAM, update() programs it a few bytes per
+ * call.
+ */
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "Arduino.h"
+#include "rtccontrol.h"
+
+namespace dusk_dawn_timer {
+
+// Event codes, 0x00 and 0xFF mark an unused record
+#define jeBOOT 1         // Absolute time
+#define jeTIME_SET 2     // Absolute time, the clock was set to it
+#define jeSYNC 3         // Absolute time, delta did not fit
+#define jeSWITCH 4       // Relay switched, value JOURNAL_SWITCH_* bits
+#define jeMANUAL 5       // Manual override, value 1 set, 0 cancelled
+#define jeWEEK_ON 6      // Program changed, value journalProgram()
+#define jeWEEK_OFF 7
+#define jeWEEKEND_ON 8
+#define jeWEEKEND_OFF 9
+#define jeBLANK_TIMEOUT 10 // Screen blank timeout changed, value minutes
+#define jeFACTORY_RESET 11
+#define jeLOCATION 12    // Location changed, value time zone in minutes
+
+#define JOURNAL_SWITCH_ON 1
+#define JOURNAL_SWITCH_MANUAL 2
+
+// Program value: switch type in the upper 3 bits, 13 bit signed time
+inline int16_t journalProgram(const uint8_t& type, const int16_t& time) { return (type << 13) | (time & 0x1FFF); }
+
+#define JOURNAL_QUEUE_SIZE 4
+
+struct JournalRecord {
+  uint8_t mSequence;
+  uint8_t mCode;
+  uint16_t mDelta; // Minutes since the previous record
+  int16_t mValue;
+} __attribute__((packed));
+
+class Journal {
+public:
+  // Finds the head of the ring and writes the boot record
+  static void begin(RtcControl* rtc);
+  static void log(const uint8_t& code, const int16_t& value = 0);
+  static void timeSet(); // Call after the clock was set
+  static void update(); // Call every loop
+  // Writes all queued records now, or at most maxBytes of them; returns
+  // the bytes written
+  static uint8_t flush(const uint8_t& maxBytes = 0xFF);
+  static void erase(); // Empties the journal, erasing runs in the background
+  static void dump(Print& out);
+  static uint8_t getCount() { return sCount; } // Records kept, queued ones included
+  // Records lost because the queue was full while an EEPROM job ran
+  static uint8_t getDropped() { return sDropped; }
+
+private:
+  static uint32_t now();
+  static void logAbsolute(const uint8_t& code);
+  static bool append(const uint8_t& code, const uint16_t& delta, const int16_t& value);
+  static void writeByte();
+  static void read(const uint8_t& slot, JournalRecord& record);
+  static bool isUsed(const JournalRecord& record);
+  static bool isErasing();
+  static void printTime(Print& out, uint32_t minutes);
+
+  static RtcControl* sRtc;
+  static uint8_t sHead;     // Next slot to write
+  static uint8_t sCount;    // Used slots
+  static uint8_t sSequence; // Sequence number of the next record
+  static uint32_t sLastTime; // Minutes since 2000-01-01 of the last record
+
+  static JournalRecord sQueue[JOURNAL_QUEUE_SIZE]; // Not written yet
+  static uint8_t sQueueFirst;
+  static uint8_t sQueued;
+  static uint8_t sQueueByte; // Bytes of the first queued record written
+  static uint8_t sDropped;
+  static bool sErasePending; // The EEPROM job queue had no room for the erase
+};
+
+} // namespace
+#endif // JOURNAL_H
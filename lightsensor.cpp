@@ -0,0 +1,112 @@
+/*
+ * Light sensor (LDR) for overcast evenings and mornings
+ */
+#include "lightsensor.h"
+
+#if LIGHT_SENSOR
+
+#include <avr/interrupt.h>
+
+namespace dusk_dawn_timer {
+
+// Conversions take 13 ADC clocks at 16 MHz / 128, about 9600 per second.
+// The interrupt sums blocks of 256 (37 per second) and moves the average
+// 1/1024 of the way to each block: a time constant of about half a minute,
+// so headlights or someone passing by do not count.
+#define BLOCK_SHIFT 8
+#define AVERAGE_SHIFT 10
+#define FRACTION_SHIFT 8 // Extra bits of the average, against rounding
+#define LEVEL_SHIFT (BLOCK_SHIFT + FRACTION_SHIFT)
+
+#define LIGHT_NONE 0xFFFF
+
+volatile uint32_t LightSensor::sAverage;
+volatile bool LightSensor::sDark;
+uint32_t LightSensor::sBlockSum;
+uint8_t LightSensor::sBlockCount;
+uint16_t LightSensor::sLastMinute;
+uint16_t LightSensor::sLastSunrise;
+uint16_t LightSensor::sLastSunset;
+uint16_t LightSensor::sDusk = LIGHT_NONE;
+uint16_t LightSensor::sDawn = LIGHT_NONE;
+uint8_t LightSensor::sSunriseDelay;
+uint8_t LightSensor::sSunsetAdvance;
+
+void LightSensor::conversion(uint16_t value)
+{
+  sBlockSum += value;
+  if (++sBlockCount != 0) return; // 256 conversions
+  // Fixed point: the average is kept as a block sum with fraction bits
+  const int32_t difference = (static_cast<int32_t>(sBlockSum) << FRACTION_SHIFT) - static_cast<int32_t>(sAverage);
+  sAverage += difference / (1L << AVERAGE_SHIFT);
+  sBlockSum = 0;
+  const uint16_t level = sAverage >> LEVEL_SHIFT;
+  if (sDark && level > LIGHT_BRIGHT_LEVEL) sDark = false;
+  else if (!sDark && level < LIGHT_DARK_LEVEL) sDark = true;
+}
+
+void LightSensor::begin()
+{
+  // Start from one conversion instead of from dark
+  const uint16_t first = analogRead(A0 + LIGHT_SENSOR_CHANNEL);
+  sAverage = static_cast<uint32_t>(first) << LEVEL_SHIFT;
+  sDark = first < LIGHT_DARK_LEVEL;
+
+  ADMUX = _BV(REFS0) | LIGHT_SENSOR_CHANNEL; // AVcc reference
+  DIDR0 = _BV(LIGHT_SENSOR_CHANNEL); // No digital input buffer on the pin
+  ADCSRB = 0; // Free running
+  ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+  ADCSRA |= _BV(ADSC);
+}
+
+uint16_t LightSensor::getLevel()
+{
+  cli();
+  const uint32_t average = sAverage;
+  sei();
+  return average >> LEVEL_SHIFT;
+}
+
+/*
+ * A new day starts when the time goes back or the computed sunrise or
+ * sunset changes (the clock was set). The shifts are kept once decided, a
+ * cloud after the light came does not hold the sunrise again.
+ */
+void LightSensor::update(const uint16_t& minutesSinceMidnight, const uint16_t& sunrise, const uint16_t& sunset)
+{
+  if (minutesSinceMidnight < sLastMinute || sunrise != sLastSunrise || sunset != sLastSunset)
+  {
+    sDusk = LIGHT_NONE;
+    sDawn = LIGHT_NONE;
+  }
+  sLastMinute = minutesSinceMidnight;
+  sLastSunrise = sunrise;
+  sLastSunset = sunset;
+  const bool dark = sDark;
+
+  if (sDusk == LIGHT_NONE && dark && minutesSinceMidnight < sunset && minutesSinceMidnight + LIGHT_WINDOW >= sunset)
+  {
+    sDusk = minutesSinceMidnight;
+  }
+  sSunsetAdvance = sDusk == LIGHT_NONE ? 0 : sunset - sDusk;
+
+  if (sDawn == LIGHT_NONE && minutesSinceMidnight >= sunrise)
+  {
+    // Started after the window (power up, clock set): nothing to hold back
+    if (minutesSinceMidnight > sunrise + LIGHT_WINDOW) sDawn = sunrise;
+    else if (!dark || minutesSinceMidnight == sunrise + LIGHT_WINDOW) sDawn = minutesSinceMidnight;
+  }
+  // Still dark: the sunrise is the next minute
+  if (sDawn != LIGHT_NONE) sSunriseDelay = sDawn - sunrise;
+  else if (minutesSinceMidnight >= sunrise) sSunriseDelay = minutesSinceMidnight + 1 - sunrise;
+  else sSunriseDelay = 0;
+}
+
+} // namespace
+
+ISR(ADC_vect)
+{
+  dusk_dawn_timer::LightSensor::conversion(ADC);
+}
+
+#endif // LIGHT_SENSOR
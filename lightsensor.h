@@ -0,0 +1,68 @@
+/*
+ * Light sensor (LDR) for overcast evenings and mornings
+ *
+ * An LDR from LIGHT_SENSOR_CHANNEL to 5V with a resistor to GND reads high
+ * in daylight. The ADC converts it continuously in free running mode; the
+ * interrupt averages blocks of conversions, smooths them with an
+ * exponential moving average and decides dark or light with hysteresis. The
+ * loop only reads the result, it never waits for a conversion.
+ *
+ * Within LIGHT_WINDOW minutes before the computed sunset, the first dark
+ * minute becomes the sunset of the day; after the computed sunrise, the
+ * sunrise is held back until it is light, at most LIGHT_WINDOW minutes.
+ * Timer applies these shifts to the SUNDOWN and SUNUP switch actions.
+ * With LIGHT_SENSOR set to 0 all calls are empty inlines.
+ */
+#ifndef LIGHT_SENSOR_H
+#define LIGHT_SENSOR_H
+
+#include "Arduino.h"
+#include "config.h"
+
+namespace dusk_dawn_timer {
+
+#if LIGHT_SENSOR
+
+class LightSensor {
+public:
+  static void begin();
+  // Call every loop with the time and today's computed sunrise and sunset
+  static void update(const uint16_t& minutesSinceMidnight, const uint16_t& sunrise, const uint16_t& sunset);
+  // Minutes the light moves today's sunrise later and sunset earlier
+  static uint8_t getSunriseDelay() { return sSunriseDelay; }
+  static uint8_t getSunsetAdvance() { return sSunsetAdvance; }
+  // Filtered level, 0-1023
+  static uint16_t getLevel();
+  static bool isDark() { return sDark; }
+
+  // Interrupt side, from the ADC conversion complete ISR
+  static void conversion(uint16_t value);
+
+private:
+  static volatile uint32_t sAverage; // Filtered block sum, fixed point
+  static volatile bool sDark;
+  static uint32_t sBlockSum;
+  static uint8_t sBlockCount;
+  static uint16_t sLastMinute;
+  static uint16_t sLastSunrise;
+  static uint16_t sLastSunset;
+  static uint16_t sDusk; // First dark minute before sunset, or LIGHT_NONE
+  static uint16_t sDawn; // First light minute after sunrise, or LIGHT_NONE
+  static uint8_t sSunriseDelay;
+  static uint8_t sSunsetAdvance;
+};
+
+#else
+
+class LightSensor {
+public:
+  static inline void begin() {}
+  static inline void update(const uint16_t&, const uint16_t&, const uint16_t&) {}
+  static inline uint8_t getSunriseDelay() { return 0; }
+  static inline uint8_t getSunsetAdvance() { return 0; }
+};
+
+#endif // LIGHT_SENSOR
+
+} // namespace
+#endif // LIGHT_SENSOR_H
@@ -0,0 +1,104 @@
+/*
+ * SRAM monitor
+ */
+#include "memorymonitor.h"
+
+#if DIAGNOSTICS
+
+#define STACK_PAINT 0xC5
+// Paint bytes in a row that end the stack; a single one may be a value the
+// stack holds
+#define STACK_PAINT_RUN 4
+
+#ifdef __AVR__
+
+extern uint8_t _end; // End of the static data, the heap starts here
+extern uint8_t __stack; // RAMEND, the stack starts here
+extern char* __brkval; // End of the heap, 0 until the first malloc()
+
+/*
+ * Runs from .init3: the stack pointer is set, the constructors have not
+ * run yet. Naked and without calls, so it uses no stack itself.
+ */
+void paintStack() __attribute__((naked, used, section(".init3")));
+void paintStack()
+{
+  for (uint8_t* p = &_end; p <= &__stack; ++p) *p = STACK_PAINT;
+}
+
+static uint8_t* heapEnd()
+{
+  return __brkval ? reinterpret_cast<uint8_t*>(__brkval) : &_end;
+}
+
+static uint8_t* stackPointer()
+{
+  return reinterpret_cast<uint8_t*>(SP);
+}
+
+static uint8_t* stackEnd()
+{
+  return &__stack;
+}
+
+#else
+
+// The host build has no AVR memory map; report an empty one
+static uint8_t* heapEnd() { return nullptr; }
+static uint8_t* stackPointer() { return nullptr; }
+static uint8_t* stackEnd() { return nullptr; }
+
+#endif // __AVR__
+
+namespace dusk_dawn_timer {
+
+uint16_t MemoryMonitor::getFreeMemory()
+{
+  return stackPointer() - heapEnd();
+}
+
+/*
+ * Lowest address the stack ever reached. Scans down from the stack
+ * pointer, the heap may have written over the paint below its current
+ * end: free() of the top block lowers it again.
+ */
+static const uint8_t* stackBottom()
+{
+  const uint8_t* p = stackPointer();
+  const uint8_t* heap = heapEnd();
+  uint8_t run = 0;
+  while (p > heap && run < STACK_PAINT_RUN)
+  {
+    --p;
+    run = *p == STACK_PAINT ? run + 1 : 0;
+  }
+  return p + run;
+}
+
+uint16_t MemoryMonitor::getMinimumFree()
+{
+  return stackBottom() - heapEnd();
+}
+
+uint16_t MemoryMonitor::getStackHighWater()
+{
+  return stackEnd() - stackBottom();
+}
+
+/*
+ * Free memory now and at the worst, and the deepest stack, in one display
+ * line.
+ */
+void MemoryMonitor::print(Print& out)
+{
+  out.print(F("free "));
+  out.print(getFreeMemory());
+  out.print('/');
+  out.print(getMinimumFree());
+  out.print(F(" stk "));
+  out.println(getStackHighWater());
+}
+
+} // namespace
+
+#endif // DIAGNOSTICS
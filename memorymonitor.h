@@ -0,0 +1,34 @@
+/*
+ * SRAM monitor
+ *
+ * The stack grows down from the end of the SRAM towards the heap (String
+ * temporaries) and the static data. At boot, before the constructors run,
+ * the free area is painted with a pattern; the bytes the stack never
+ * reached still hold it, which gives the high-water mark.
+ * Part of the diagnostics, only compiled with DIAGNOSTICS set.
+ */
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include "Arduino.h"
+#include "config.h"
+
+#if DIAGNOSTICS
+
+namespace dusk_dawn_timer {
+
+class MemoryMonitor {
+public:
+  // Bytes between the heap and the stack right now
+  static uint16_t getFreeMemory();
+  // Bytes between the heap and the deepest point the stack ever reached
+  static uint16_t getMinimumFree();
+  // Deepest stack use since boot in bytes
+  static uint16_t getStackHighWater();
+  static void print(Print& out);
+};
+
+} // namespace
+
+#endif // DIAGNOSTICS
+#endif // MEMORY_MONITOR_H
@@ -5,16 +5,26 @@
 #include "rotaryencoder.h"
 #include "dusk2dawn.h"
 #include "persist.h"
-
-// Using software SPI
-// pin definitions
-#define CS_PIN   12
-#define RST_PIN  8
-#define DC_PIN   11
-#define MOSI_PIN  9
-#define CLK_PIN  10
+#include "diagnostics.h"
+#include "eepromjobs.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "memorymonitor.h"
+#include "eventbus.h"
 
 #define SCREEN_TIMEOUT 60000 // 1 minute
+#define FRAME_INTERVAL 40 // Minimum time between two redraws, coalesces bursts of events
+#define STATISTICS_PERIOD 1000
+
+// SSD1306 commands used for power and brightness management
+#define OLED_DISPLAY_OFF 0xAE
+#define OLED_DISPLAY_ON 0xAF
+#define OLED_CHARGE_PUMP 0x8D
+#define OLED_CHARGE_PUMP_OFF 0x10
+#define OLED_CHARGE_PUMP_ON 0x14
+
+#define DAY_CONTRAST 0xCF // Adafruit 128x64 default
+#define NIGHT_CONTRAST 0x10 // Between dusk and dawn
 
 #define NONE_SCREEN 0
 #define BLANK_SCREEN 1
@@ -23,29 +33,77 @@
 #define SET_TIME_SCREEN 4
 #define SET_TIMER_SCREEN 5
 #define SET_OPTIONS 6
+#define DIAGNOSTICS_SCREEN 7
+#define BUSY_SCREEN 8 // Background EEPROM work, ignores input
+#define UPCOMING_SCREEN 9
+#define FACTORY_RESET_SCREEN 10 // Button held at power up, "No" selected
 
 #define MENU_OPTION_WEEK_TIMER 1
 #define MENU_OPTION_WEEKEND_TIMER 2
 
+// Menu lines, the diagnostics line is only shown while selected
+#define MENU_UPCOMING 4
+#define MENU_OPTIONS 5
+#define MENU_DIAGNOSTICS 6
+#if DIAGNOSTICS
+#define MENU_LAST MENU_DIAGNOSTICS
+#else
+#define MENU_LAST MENU_OPTIONS
+#endif
+
+// Scroll bar of the upcoming days screen, right most column of pages 2 - 7
+#define SCROLL_BAR_X 127
+#define SCROLL_BAR_TOP 16
+#define SCROLL_BAR_HEIGHT 48
+#define SCROLL_THUMB_HEIGHT (SCROLL_BAR_HEIGHT * UPCOMING_ROWS / UPCOMING_DAYS)
+
 namespace dusk_dawn_timer {
   
 OledControl::OledControl(RtcControl* rtc, Dusk2Dawn* d2d, Timer* timer)
 :   mRealTimeClock(rtc),
     mD2d(d2d),
     mTimer(timer),
+    mRenderer(&mOled),
     mCurrentScreen(DEFAULT_SCREEN)
 { }
 
 void OledControl::begin()
 {
-  mOled.begin(&Adafruit128x64, CS_PIN, DC_PIN, CLK_PIN, MOSI_PIN, RST_PIN);
+  mOled.begin();
   mOled.setFont(System5x7);
+  enterScreen(DEFAULT_SCREEN);
+  updateContrast(mRealTimeClock->getMinutesSinceMidnight());
   updateMenu(true);
+  EventBus::subscribe(BUS_MINUTE | BUS_DATE | BUS_LOCATION | BUS_SOLAR | BUS_RELAY | BUS_NEXT_SWITCH | BUS_INPUT,
+                      busEvent, this);
 }
 
-void OledControl::userEvent(uint8_t event)
+/*
+ * Everything that changes the screen besides the EEPROM jobs and the
+ * statistics comes from the event bus.
+ */
+void OledControl::busEvent(void* context, uint8_t events, const void* data)
 {
-  mEvent = event;
+  OledControl* oled = static_cast<OledControl*>(context);
+  if (events & BUS_INPUT)
+  {
+    const UserInput* input = static_cast<const UserInput*>(data);
+    oled->userEvent(input->mEvent, input->mTime, input->mSteps);
+    return;
+  }
+  if (events & BUS_SOLAR) oled->updateContrast(oled->mRealTimeClock->getMinutesSinceMidnight());
+  if (events & BUS_MINUTE) oled->minuteTick(oled->mRealTimeClock->getMinutesSinceMidnight());
+  if ((events & (BUS_SOLAR | BUS_RELAY | BUS_NEXT_SWITCH)) && oled->mCurrentScreen == DEFAULT_SCREEN)
+  {
+    oled->mDirty = true;
+  }
+  if ((events & (BUS_DATE | BUS_LOCATION)) && oled->mCurrentScreen == UPCOMING_SCREEN)
+  {
+    // The list starts at the new today, or the days need recalculating
+    const uint8_t selection = oled->mSelection;
+    oled->enterScreen(UPCOMING_SCREEN);
+    oled->mSelection = selection;
+  }
 }
 
 static const char SU[] PROGMEM = "Su";
@@ -63,12 +121,50 @@ static const char SUP[] PROGMEM = "Dawn ";
 static const char SDOWN[] PROGMEM = "Dusk ";
 
 const char* const sTimerTypes[] PROGMEM = {TI, SUP, SDOWN};
-  
-void OledControl::updateMenu(bool forceupdate) {
-  unsigned long now = millis();
+
+/*
+ * Input handling. Events are applied to the menu state immediately, the
+ * screen itself is redrawn later by updateMenu(). Several events arriving
+ * within one frame interval therefore result in a single redraw.
+ * Turning the encoder fast gives more than one step; that only applies to
+ * number fields, menus always move one line.
+ * The time the event was raised (millis()) is kept to measure how long it
+ * takes until its result is on the display.
+ */
+void OledControl::userEvent(uint8_t event, uint16_t time, uint8_t steps)
+{
+  if (!mInputPending)
+  {
+    mInputPending = true;
+    mInputTime = time;
+  }
+  if ((event != evLEFT && event != evRIGHT) || !isNumberField()) steps = 1;
+  while (steps--)
+  {
+    handleEvent(event);
+  }
+}
+
+bool OledControl::isNumberField() const
+{
+  switch (mCurrentScreen)
+  {
+    case SET_TIME_SCREEN:
+    case SET_OPTIONS:
+      return true;
+    case SET_TIMER_SCREEN:
+      return mSelection != 0 && mSelection != 3; // Not a timer type
+  }
+  return false;
+}
+
+void OledControl::handleEvent(uint8_t event)
+{
+  if (event == evNONE) return;
+  mDirty = true;
+  const uint16_t minutesSinceMidnight = mRealTimeClock->getMinutesSinceMidnight();
   uint8_t newscreen = NONE_SCREEN;
-  uint16_t minutesSinceMidnight = mRealTimeClock->getMinutesSinceMidnight();
-  if (mCurrentScreen != DEFAULT_SCREEN && mEvent == evLONGPRESS) 
+  if (mCurrentScreen != DEFAULT_SCREEN && event == evLONGPRESS) 
   {
     newscreen = DEFAULT_SCREEN;
   }
@@ -79,79 +175,16 @@ void OledControl::updateMenu(bool forceupdate) {
       case BLANK_SCREEN:
       {
         // Any event switched screen on
-        if (mEvent != evNONE) newscreen = DEFAULT_SCREEN;
+        newscreen = DEFAULT_SCREEN;
         break;
       }
       case DEFAULT_SCREEN:
       {
-        if (forceupdate)
-        {
-          mMenuData[0] = minutesSinceMidnight;
-          mMenuData[1] = Persist::getScreenBlankTimeout();
-        }
-        if (mEvent == evNONE)
-        {
-            const uint8_t dayOfTheWeek = mRealTimeClock->getDayOfTheWeek();
-            mOled.home();
-            for (uint8_t i = 0; i<7; ++i)
-            {
-              mOled.setCol(i * 18);
-              if (i == dayOfTheWeek)
-              {                
-                char day[3];
-                strcpy_P(day, (char*) pgm_read_word( &sDaysOfTheWeek[dayOfTheWeek] ) );
-                mOled.print(day);                
-              }
-              else
-              {
-                mOled.print(F("  "));
-              }
-            }
-            mOled.print(F("\n"));        
-            mOled.println();
-            mOled.set2X();
-            mOled.setCol(34);
-            mOled.println(timeString(minutesSinceMidnight) );
-            mOled.set1X();
-            mOled.println();
-            if (mTimer->isSwitchedManual())
-            {
-              mOled.setInvertMode(true);
-              mOled.setCol(2);
-              mOled.print(F("Manual"));
-              mOled.setInvertMode(false);
-            }
-            else
-            {
-              mOled.setCol(2);
-              mOled.print(F(" Timer "));
-            }
-            mOled.setCol(42);
-            mOled.print(mTimer->isSwitchedOn() ? F("ON ") : F("OFF"));
-            mOled.setCol(66);
-            mOled.print(F("until"));
-            mOled.setCol(99);
-            mOled.println(timeString(mTimer->getNextSwitchTime()));
-            mOled.println();
-            printTimerType(1); // Dawn
-            mOled.setCol(28);
-            mOled.print(timeString(mD2d->mSunrise) );
-            mOled.setCol(70);
-            printTimerType(2); // Dusk
-            mOled.setCol(99);            
-            mOled.println(timeString(mD2d->mSunset) );
-            if (mMenuData[1] != 0 &&
-                ((mMenuData[0] < minutesSinceMidnight && (minutesSinceMidnight - mMenuData[0] >= mMenuData[1])) ||
-                 (mMenuData[0] > minutesSinceMidnight && ((MINUTES_PER_DAY - mMenuData[0] + minutesSinceMidnight) >= mMenuData[1]))))
-            {
-              newscreen = BLANK_SCREEN;
-            }
-        }
-        else if (mEvent == evLONGPRESS)
+        if (event == evLONGPRESS)
         {
           newscreen = MENU_SCREEN;
         }
-        else if (mEvent == evPRESS)
+        else if (event == evPRESS)
         {
           mTimer->manualSwitch();
           mMenuData[0] = minutesSinceMidnight;
@@ -164,12 +197,7 @@ void OledControl::updateMenu(bool forceupdate) {
       }
       case MENU_SCREEN:
       {
-        if (forceupdate)
-        {
-          mSelection = 0;
-          mEvent = evNONE;
-        }
-        if (mEvent == evPRESS)
+        if (event == evPRESS)
         {
           if (mSelection == 0) newscreen = DEFAULT_SCREEN;
           else if (mSelection == 1) newscreen = SET_TIME_SCREEN;
@@ -183,39 +211,25 @@ void OledControl::updateMenu(bool forceupdate) {
             mMenuOption = MENU_OPTION_WEEKEND_TIMER;
             newscreen = SET_TIMER_SCREEN;
           }
-          else if (mSelection == 4) newscreen = SET_OPTIONS;
+          else if (mSelection == MENU_UPCOMING) newscreen = UPCOMING_SCREEN;
+          else if (mSelection == MENU_OPTIONS) newscreen = SET_OPTIONS;
+#if DIAGNOSTICS
+          else if (mSelection == MENU_DIAGNOSTICS) newscreen = DIAGNOSTICS_SCREEN;
+#endif
         }
-        else if (mEvent == evLEFT && mSelection>0)
+        else if (event == evLEFT && mSelection>0)
         {
           mSelection--;
         }
-        else if (mEvent == evRIGHT && mSelection<4)
+        else if (event == evRIGHT && mSelection<MENU_LAST)
         {
           mSelection++;
         }
-        mOled.home();
-        mOled.println();
-        printSelectable(mSelection == 0, F("Back"));
-        mOled.println();
-        printSelectable(mSelection == 1, F("Set time"));
-        printSelectable(mSelection == 2, F("Week day program"));
-        printSelectable(mSelection == 3, F("Weekend program"));
-        mOled.println();
-        printSelectable(mSelection == 4, F("Options"));
         break;
       }
       case SET_TIME_SCREEN:
       {
-        if (forceupdate)
-        {
-            mSelection = 0;
-            mMenuData[0] = mRealTimeClock->getYear();
-            mMenuData[1] = mRealTimeClock->getMonth();
-            mMenuData[2] = mRealTimeClock->getDay();
-            mMenuData[3] = RtcControl::hours(minutesSinceMidnight);
-            mMenuData[4] = RtcControl::minutes(minutesSinceMidnight);
-        }
-        if (mEvent == evPRESS)
+        if (event == evPRESS)
         {
           if (mSelection < 4) mSelection++; // Next step;
           else 
@@ -225,70 +239,26 @@ void OledControl::updateMenu(bool forceupdate) {
             newscreen = MENU_SCREEN;
           }
         }
-        else if (mEvent == evLEFT && mMenuData[mSelection] > (mSelection < 3 ? 1 : 0))
+        else if (event == evLEFT && mMenuData[mSelection] > (mSelection < 3 ? 1 : 0))
         {
           mMenuData[mSelection]--;
         }
-        else if (mEvent == evRIGHT && notMaxValue())
+        else if (event == evRIGHT && notMaxValue())
         {
           mMenuData[mSelection]++;
         }
-        mOled.home();
-        mOled.print(F("Year:    "));
-        mOled.println(String(mMenuData[0]));
-        if (mSelection > 0)
-        {
-          mOled.print(F("Month:    "));
-          mOled.print(mMenuData[1] < 10 ? " " : "");
-          mOled.println(String(mMenuData[1]));
-        }
-        if (mSelection > 1) 
-        {
-          mOled.print(F("Day:      "));
-          mOled.print(mMenuData[2] < 10 ? "0" : "");
-          mOled.println(String(mMenuData[2]));
-        }
-        if (mSelection > 2)
-        {
-          mOled.println();
-          mOled.print(F("Time:  "));
-          mOled.print(twoDigitString(mMenuData[3]));
-        }
-        if (mSelection > 3) 
-        {
-          mOled.print(F(" : "));
-          mOled.print(twoDigitString(mMenuData[4]));
-        }
         break;
       }
       case SET_TIMER_SCREEN:
       {
-        if (forceupdate)
-        {
-            mSelection = 0;
-            if (mMenuOption == MENU_OPTION_WEEK_TIMER)
-            {
-              mMenuData[0] = mTimer->getWeekDayOnType();
-              timerTime(mMenuData[0], mTimer->getWeekDayOnTime(), mMenuData[1], mMenuData[2]);
-              mMenuData[3] = mTimer->getWeekDayOffType();
-              timerTime(mMenuData[3], mTimer->getWeekDayOffTime(), mMenuData[4], mMenuData[5]);
-            }
-            else
-            {
-              mMenuData[0] = mTimer->getWeekendOnType();
-              timerTime(mMenuData[0], mTimer->getWeekendOnTime(), mMenuData[1], mMenuData[2]);
-              mMenuData[3] = mTimer->getWeekendOffType();
-              timerTime(mMenuData[3], mTimer->getWeekendOffTime(), mMenuData[4], mMenuData[5]);
-            }
-        }
-        if (mEvent == evPRESS)
+        if (event == evPRESS)
         {
           bool done = false;
           if (mSelection < 5)
           {
             mSelection++; // Next step;
-            if ((mSelection == 2 || mSelection == 4) && 
-                 mMenuData[mSelection - 2] != TIME) 
+            if ((mSelection == 2 && mMenuData[0] != TIME) ||
+                (mSelection == 4 && mMenuData[3] != TIME))
             {
               mSelection++; // skip unused variable
               done = mSelection >= 5;
@@ -312,7 +282,7 @@ void OledControl::updateMenu(bool forceupdate) {
             newscreen = MENU_SCREEN;
           }
         }
-        else if (mEvent == evLEFT)
+        else if (event == evLEFT)
         {
           if (((mSelection == 0 || mSelection == 3) && mMenuData[mSelection] > 0) ||
               ((mSelection == 1 || mSelection == 4) && mMenuData[mSelection - 1] != TIME && mMenuData[mSelection] > -59) ||
@@ -323,7 +293,7 @@ void OledControl::updateMenu(bool forceupdate) {
           }
           
         }
-        else if (mEvent == evRIGHT)
+        else if (event == evRIGHT)
         {
           if (((mSelection == 0 || mSelection == 3) && mMenuData[mSelection] < 2) ||
               ((mSelection == 1 || mSelection == 4) && mMenuData[mSelection - 1] != TIME && mMenuData[mSelection] < 59) ||
@@ -333,90 +303,630 @@ void OledControl::updateMenu(bool forceupdate) {
             mMenuData[mSelection]++;
           }
         }
-        mOled.home();
-        uint8_t begin = (mMenuOption == MENU_OPTION_WEEK_TIMER) ? 0 : 5;
-        uint8_t end = (mMenuOption == MENU_OPTION_WEEK_TIMER) ? 4 : 6;
-        for (int i = begin; i <= end; ++i)
-        {
-            mOled.setCol(i * 18);
-            char day[3];
-            strcpy_P(day, (char*) pgm_read_word( &sDaysOfTheWeek[i] ) );
-            mOled.print(day);
-        }
-        mOled.println();
-        mOled.println();
-        mOled.print(F("Switch at:  "));
-        printTimerType(mMenuData[0]);
-        if (mSelection > 0)
-        {
-          mOled.println();
-          mOled.print(F("Time on:    "));
-          printTimerTime1(mMenuData[0], mMenuData[1]);
-        }
-        if (mSelection > 1) 
-        {
-          printTimerTime2(mMenuData[0], mMenuData[2]);
-        }
-        if (mSelection > 2)
-        {
-          mOled.println();
-          mOled.println();
-          mOled.print(F("Switch off: "));
-          printTimerType(mMenuData[3]);
-        }
-        if (mSelection > 3)
-        {
-          mOled.println();
-          mOled.print(F("Time off:   "));
-          printTimerTime1(mMenuData[3], mMenuData[4]);
-        }
-        if (mSelection > 4) 
-        {
-          printTimerTime2(mMenuData[3], mMenuData[5]);
-        }
         break;
       }
       case SET_OPTIONS:
       {
-        if (forceupdate)
-        {
-          mSelection = Persist::getScreenBlankTimeout();
-        }
-        if (mEvent == evPRESS)
+        if (event == evPRESS)
         {
           Persist::setScreenBlankTimeout(mSelection);
           newscreen = MENU_SCREEN;
         }
-        else if (mEvent == evLEFT && mSelection>0)
+        else if (event == evLEFT && mSelection>0)
         {
           mSelection--;
         }
-        else if (mEvent == evRIGHT && mSelection<30)
+        else if (event == evRIGHT && mSelection<30)
         {
           mSelection++;
         }
-        mOled.home();
-        mOled.println();
-        mOled.print(F("Screen timout: "));
-        if (mSelection == 0) mOled.print(F("Never "));
-        else
+        break; 
+      }
+      case UPCOMING_SCREEN:
+      {
+        // Turning scrolls one day, rows that come into view are calculated
+        // by updateUpcoming()
+        if (event == evPRESS) newscreen = MENU_SCREEN;
+        else if (event == evLEFT && mSelection > 0) mSelection--;
+        else if (event == evRIGHT && mSelection < UPCOMING_DAYS - UPCOMING_ROWS) mSelection++;
+        break;
+      }
+      case FACTORY_RESET_SCREEN:
+      {
+        if (event == evPRESS)
         {
-          mOled.print(twoDigitString(mSelection) );
-          mOled.print(F(" min"));
+          if (mSelection == 1) factoryReset();
+          newscreen = DEFAULT_SCREEN;
         }
-        break; 
+        else if (event == evLEFT) mSelection = 0;
+        else if (event == evRIGHT) mSelection = 1;
+        break;
+      }
+#if DIAGNOSTICS
+      case DIAGNOSTICS_SCREEN:
+      {
+        if (event == evPRESS) newscreen = MENU_SCREEN;
+#if PROFILER
+        else if ((event == evLEFT && mSelection > 0) || (event == evRIGHT && mSelection < 1))
+        {
+          // Turning flips between the latency and the profiler page
+          mSelection = event == evRIGHT;
+          mClearScreen = true;
+        }
+#endif
+        break;
       }
+#endif
     };
   }
-  mEvent = evNONE;
   if (newscreen != NONE_SCREEN)
+  {
+    enterScreen(newscreen);
+  }
+}
+
+/*
+ * Initializes the menu state of a screen; the screen is cleared and drawn
+ * with the next frame.
+ */
+void OledControl::enterScreen(uint8_t screen)
+{
+  const uint16_t minutesSinceMidnight = mRealTimeClock->getMinutesSinceMidnight();
+  mCurrentScreen = screen;
+  if (screen == BLANK_SCREEN)
+  {
+    // Nothing to draw, power down the panel instead
+    sleepDisplay();
+    return;
+  }
+  mClearScreen = true;
+  mDirty = true;
+  switch (screen)
+  {
+    case DEFAULT_SCREEN:
+    {
+      mMenuData[0] = minutesSinceMidnight;
+      mMenuData[1] = Persist::getScreenBlankTimeout();
+      break;
+    }
+    case MENU_SCREEN:
+    {
+      mSelection = 0;
+      break;
+    }
+    case SET_TIME_SCREEN:
+    {
+      mSelection = 0;
+      mMenuData[0] = mRealTimeClock->getYear();
+      mMenuData[1] = mRealTimeClock->getMonth();
+      mMenuData[2] = mRealTimeClock->getDay();
+      mMenuData[3] = RtcControl::hours(minutesSinceMidnight);
+      mMenuData[4] = RtcControl::minutes(minutesSinceMidnight);
+      break;
+    }
+    case SET_TIMER_SCREEN:
+    {
+      mSelection = 0;
+      if (mMenuOption == MENU_OPTION_WEEK_TIMER)
+      {
+        mMenuData[0] = mTimer->getWeekDayOnType();
+        timerTime(mMenuData[0], mTimer->getWeekDayOnTime(), mMenuData[1], mMenuData[2]);
+        mMenuData[3] = mTimer->getWeekDayOffType();
+        timerTime(mMenuData[3], mTimer->getWeekDayOffTime(), mMenuData[4], mMenuData[5]);
+      }
+      else
+      {
+        mMenuData[0] = mTimer->getWeekendOnType();
+        timerTime(mMenuData[0], mTimer->getWeekendOnTime(), mMenuData[1], mMenuData[2]);
+        mMenuData[3] = mTimer->getWeekendOffType();
+        timerTime(mMenuData[3], mTimer->getWeekendOffTime(), mMenuData[4], mMenuData[5]);
+      }
+      break;
+    }
+    case SET_OPTIONS:
+    {
+      mSelection = Persist::getScreenBlankTimeout();
+      break;
+    }
+    case FACTORY_RESET_SCREEN:
+    {
+      mSelection = 0;
+      break;
+    }
+    case UPCOMING_SCREEN:
+    {
+      // Nothing is calculated here, the rows follow one per loop
+      mSelection = 0;
+      mMenuData[0] = mRealTimeClock->getYear();
+      mMenuData[1] = mRealTimeClock->getMonth();
+      mMenuData[2] = mRealTimeClock->getDay();
+      mMenuData[3] = mRealTimeClock->getDayOfTheWeek();
+      for (uint8_t i = 0; i < UPCOMING_ROWS; ++i) mUpcoming[i].mOffset = UPCOMING_DAYS;
+      break;
+    }
+#if DIAGNOSTICS
+    case DIAGNOSTICS_SCREEN:
+    {
+      mSelection = 0;
+      break;
+    }
+#endif
+  }
+}
+
+/*
+ * Called every loop. Redraws only when the screen is dirty and the frame
+ * interval has elapsed; the events marking it dirty come from busEvent().
+ */
+void OledControl::updateMenu(bool forceUpdate)
+{
+  if (EepromJobs::isBusy())
+  {
+    if (mCurrentScreen != BUSY_SCREEN) enterScreen(BUSY_SCREEN);
+    else if (EepromJobs::getProgress() != mShownProgress) mDirty = true;
+  }
+  else if (mCurrentScreen == BUSY_SCREEN)
+  {
+    enterScreen(DEFAULT_SCREEN);
+  }
+  if (mCurrentScreen == UPCOMING_SCREEN) updateUpcoming();
+  
+  const unsigned long now = millis();
+  if (forceUpdate || (mDirty && now - mLastFrameTime >= FRAME_INTERVAL))
+  {
+    render(now);
+  }
+  
+  if (now - mStatisticsStart >= STATISTICS_PERIOD)
+  {
+    mFramesPerSecond = mFrameCount;
+    mAverageRenderTime = mFrameCount ? mRenderTimeSum / mFrameCount : 0;
+    mFrameCount = 0;
+    mRenderTimeSum = 0;
+    mStatisticsStart = now;
+#if DIAGNOSTICS
+    if (mCurrentScreen == DIAGNOSTICS_SCREEN)
+    {
+      // Numbers change width, redraw the whole screen
+      mClearScreen = true;
+      mDirty = true;
+    }
+#endif
+  }
+
+  // Wake up for the next frame
+  if (mDirty) Scheduler::runAt(mLastFrameTime + FRAME_INTERVAL);
+#if DIAGNOSTICS
+  if (mCurrentScreen == DIAGNOSTICS_SCREEN) Scheduler::runAt(mStatisticsStart + STATISTICS_PERIOD);
+#endif
+}
+
+void OledControl::minuteTick(const uint16_t& minutesSinceMidnight)
+{
+  updateContrast(minutesSinceMidnight);
+  if (mCurrentScreen != DEFAULT_SCREEN) return;
+  mDirty = true;
+  if (mMenuData[1] != 0 &&
+      ((mMenuData[0] < minutesSinceMidnight && (minutesSinceMidnight - mMenuData[0] >= mMenuData[1])) ||
+       (mMenuData[0] > minutesSinceMidnight && ((MINUTES_PER_DAY - mMenuData[0] + minutesSinceMidnight) >= mMenuData[1]))))
+  {
+    enterScreen(BLANK_SCREEN);
+  }
+}
+
+void OledControl::render(const unsigned long& now)
+{
+  const unsigned long start = micros();
+  if (mClearScreen)
   {
     mOled.clear();
-    mCurrentScreen = newscreen;
-    updateMenu(true);
+    mClearScreen = false;
+  }
+  switch (mCurrentScreen)
+  {
+    case DEFAULT_SCREEN: renderDefault(); break;
+    case MENU_SCREEN: renderMenu(); break;
+    case SET_TIME_SCREEN: renderSetTime(); break;
+    case SET_TIMER_SCREEN: renderSetTimer(); break;
+    case SET_OPTIONS: renderOptions(); break;
+    case BUSY_SCREEN: renderBusy(); break;
+    case FACTORY_RESET_SCREEN: renderFactoryReset(); break;
+    case UPCOMING_SCREEN: renderUpcoming(); break;
+#if DIAGNOSTICS
+    case DIAGNOSTICS_SCREEN: renderDiagnostics(); break;
+#endif
+    default: break; // BLANK_SCREEN, nothing to draw
+  }
+  if (mDisplayAsleep && mCurrentScreen != BLANK_SCREEN)
+  {
+    // Switch on only after the new content is in the display RAM
+    wakeDisplay();
+  }
+  mDirty = false;
+  mLastFrameTime = now;
+  mFrameCount++;
+  mRenderTimeSum += micros() - start;
+  if (mInputPending)
+  {
+    Diagnostics::recordLatency(static_cast<uint16_t>(millis()) - mInputTime);
+    mInputPending = false;
+  }
+}
+
+/*
+ * Blanking switches the panel off completely: display off and charge pump
+ * off draws only a few micro amps and stops OLED burn-in.
+ */
+void OledControl::sleepDisplay()
+{
+  if (mDisplayAsleep) return;
+  mOled.ssd1306WriteCmd(OLED_DISPLAY_OFF);
+  mOled.ssd1306WriteCmd(OLED_CHARGE_PUMP);
+  mOled.ssd1306WriteCmd(OLED_CHARGE_PUMP_OFF);
+  mDisplayAsleep = true;
+}
+
+void OledControl::wakeDisplay()
+{
+  mOled.ssd1306WriteCmd(OLED_CHARGE_PUMP);
+  mOled.ssd1306WriteCmd(OLED_CHARGE_PUMP_ON);
+  mOled.ssd1306WriteCmd(OLED_DISPLAY_ON);
+  mDisplayAsleep = false;
+}
+
+/*
+ * Dims the display between dusk and dawn.
+ */
+void OledControl::updateContrast(const uint16_t& minutesSinceMidnight)
+{
+  uint8_t contrast = DAY_CONTRAST;
+  if (mD2d->mSunrise < MINUTES_PER_DAY && mD2d->mSunset < MINUTES_PER_DAY && // No polar day or night
+      (minutesSinceMidnight < mD2d->mSunrise || minutesSinceMidnight >= mD2d->mSunset))
+  {
+    contrast = NIGHT_CONTRAST;
+  }
+  if (contrast != mContrast)
+  {
+    mOled.setContrast(contrast);
+    mContrast = contrast;
+  }
+}
+
+void OledControl::renderDefault()
+{
+  const uint16_t minutesSinceMidnight = mRealTimeClock->getMinutesSinceMidnight();
+  const uint8_t dayOfTheWeek = mRealTimeClock->getDayOfTheWeek();
+  mOled.home();
+  for (uint8_t i = 0; i<7; ++i)
+  {
+    mOled.setCol(i * 18);
+    if (i == dayOfTheWeek)
+    {                
+      char day[3];
+      strcpy_P(day, (char*) pgm_read_word( &sDaysOfTheWeek[dayOfTheWeek] ) );
+      mOled.print(day);                
+    }
+    else
+    {
+      mOled.print(F("  "));
+    }
+  }
+
+  // Clock in large digits, pages 2 and 3
+  mRenderer.firstPage(2, 3, 34, 92);
+  do
+  {
+    mRenderer.drawTime(34, 16, minutesSinceMidnight);
+  } while (mRenderer.nextPage());
+
+  mOled.setCursor(0, 5);
+  if (mTimer->isSwitchedManual())
+  {
+    mOled.setInvertMode(true);
+    mOled.setCol(2);
+    mOled.print(F("Manual"));
+    mOled.setInvertMode(false);
+  }
+  else
+  {
+    mOled.setCol(2);
+    mOled.print(F(" Timer "));
+  }
+  mOled.setCol(42);
+  mOled.print(mTimer->isSwitchedOn() ? F("ON ") : F("OFF"));
+  mOled.setCol(66);
+  mOled.print(F("until"));
+  mOled.setCol(99);
+  mOled.print(timeString(mTimer->getNextSwitchTime()));
+
+  // Today's program on a 24 hour timeline, page 6
+  int16_t switchOn, switchOff;
+  mTimer->getTodaysSwitchTimes(switchOn, switchOff);
+  mRenderer.firstPage(6, 6);
+  do
+  {
+    mRenderer.drawTimeline(48, switchOn, switchOff, mD2d->mSunrise, mD2d->mSunset, minutesSinceMidnight);
+  } while (mRenderer.nextPage());
+
+  mOled.setCursor(0, 7);
+  printTimerType(1); // Dawn
+  mOled.setCol(28);
+  mOled.print(timeString(mD2d->mSunrise) );
+  mOled.setCol(70);
+  printTimerType(2); // Dusk
+  mOled.setCol(99);            
+  mOled.print(timeString(mD2d->mSunset) );
+}
+
+void OledControl::renderMenu()
+{
+  mOled.home();
+  mOled.println();
+  printSelectable(mSelection == 0, F("Back"));
+  mOled.println();
+  printSelectable(mSelection == 1, F("Set time"));
+  printSelectable(mSelection == 2, F("Week day program"));
+  printSelectable(mSelection == 3, F("Weekend program"));
+  printSelectable(mSelection == MENU_UPCOMING, F("Next 7 days"));
+  if (mSelection == MENU_DIAGNOSTICS) printSelectable(true, F("Diagnostics"));
+  else printSelectable(mSelection == MENU_OPTIONS, F("Options    "));
+}
+
+void OledControl::renderSetTime()
+{
+  mOled.home();
+  mOled.print(F("Year:    "));
+  mOled.println(String(mMenuData[0]));
+  if (mSelection > 0)
+  {
+    mOled.print(F("Month:    "));
+    mOled.print(mMenuData[1] < 10 ? " " : "");
+    mOled.println(String(mMenuData[1]));
+  }
+  if (mSelection > 1) 
+  {
+    mOled.print(F("Day:      "));
+    mOled.print(mMenuData[2] < 10 ? "0" : "");
+    mOled.println(String(mMenuData[2]));
+  }
+  if (mSelection > 2)
+  {
+    mOled.println();
+    mOled.print(F("Time:  "));
+    mOled.print(twoDigitString(mMenuData[3]));
+  }
+  if (mSelection > 3) 
+  {
+    mOled.print(F(" : "));
+    mOled.print(twoDigitString(mMenuData[4]));
+  }
+}
+
+void OledControl::renderSetTimer()
+{
+  mOled.home();
+  uint8_t begin = (mMenuOption == MENU_OPTION_WEEK_TIMER) ? 0 : 5;
+  uint8_t end = (mMenuOption == MENU_OPTION_WEEK_TIMER) ? 4 : 6;
+  for (int i = begin; i <= end; ++i)
+  {
+      mOled.setCol(i * 18);
+      char day[3];
+      strcpy_P(day, (char*) pgm_read_word( &sDaysOfTheWeek[i] ) );
+      mOled.print(day);
+  }
+  mOled.println();
+  mOled.println();
+  mOled.print(F("Switch at:  "));
+  printTimerType(mMenuData[0]);
+  if (mSelection > 0)
+  {
+    mOled.println();
+    mOled.print(F("Time on:    "));
+    printTimerTime1(mMenuData[0], mMenuData[1]);
+  }
+  if (mSelection > 1) 
+  {
+    printTimerTime2(mMenuData[0], mMenuData[2]);
+  }
+  if (mSelection > 2)
+  {
+    mOled.println();
+    mOled.println();
+    mOled.print(F("Switch off: "));
+    printTimerType(mMenuData[3]);
+  }
+  if (mSelection > 3)
+  {
+    mOled.println();
+    mOled.print(F("Time off:   "));
+    printTimerTime1(mMenuData[3], mMenuData[4]);
+  }
+  if (mSelection > 4) 
+  {
+    printTimerTime2(mMenuData[3], mMenuData[5]);
   }
 }
 
+void OledControl::renderOptions()
+{
+  mOled.home();
+  mOled.println();
+  mOled.print(F("Screen timout: "));
+  if (mSelection == 0) mOled.print(F("Never "));
+  else
+  {
+    mOled.print(twoDigitString(mSelection) );
+    mOled.print(F(" min"));
+  }
+}
+
+void OledControl::renderBusy()
+{
+  mShownProgress = EepromJobs::getProgress();
+  mOled.setCursor(22, 2);
+  mOled.print(F("Updating memory"));
+  mOled.setCursor(52, 3);
+  mOled.print(mShownProgress);
+  mOled.print(F("% "));
+
+  // Progress bar, page 5
+  mRenderer.firstPage(5, 5, 13, 114);
+  do
+  {
+    mRenderer.hLine(13, 40, 102);
+    mRenderer.hLine(13, 47, 102);
+    mRenderer.vLine(13, 40, 8);
+    mRenderer.vLine(114, 40, 8);
+    mRenderer.fillRect(14, 42, mShownProgress, 4);
+  } while (mRenderer.nextPage());
+}
+
+void OledControl::confirmFactoryReset()
+{
+  enterScreen(FACTORY_RESET_SCREEN);
+}
+
+void OledControl::renderFactoryReset()
+{
+  mOled.home();
+  mOled.println();
+  mOled.println(F("Factory reset?"));
+  mOled.println(F("Erases all settings"));
+  mOled.println(F("and the journal."));
+  mOled.println();
+  printSelectable(mSelection == 0, F("No"));
+  printSelectable(mSelection == 1, F("Yes"));
+}
+
+/*
+ * The erasing runs in the background behind the busy screen; the defaults
+ * take effect right away, as if set in the menu.
+ */
+void OledControl::factoryReset()
+{
+  Persist::factoryReset();
+  mTimer->loadProgram();
+  float latitude, longitude;
+  int16_t timezone;
+  Persist::getLocation(latitude, longitude, timezone);
+  mD2d->setLocation(latitude, longitude, timezone);
+  EventBus::publish(BUS_LOCATION);
+}
+
+/*
+ * Calculates at most one row on screen that is not known yet. A row of a
+ * later day takes two sunrise/sunset calculations, doing them one row per
+ * loop keeps the input handling in between responsive. Today's row takes
+ * the solar times already calculated.
+ */
+void OledControl::updateUpcoming()
+{
+  for (uint8_t i = 0; i < UPCOMING_ROWS; ++i)
+  {
+    const uint8_t offset = mSelection + i;
+    UpcomingRow& row = mUpcoming[offset % UPCOMING_ROWS];
+    if (row.mOffset == offset) continue;
+    const uint8_t dayOfTheWeek = (mMenuData[3] + offset) % 7;
+    if (offset == 0)
+    {
+      row.mSunrise = mD2d->mSunrise;
+      row.mSunset = mD2d->mSunset;
+    }
+    else
+    {
+      uint16_t year;
+      uint8_t month, day;
+      upcomingDate(offset, year, month, day);
+      mD2d->calculate(year, month, day, RtcControl::isDayLightSaving(year, month, day), row.mSunrise, row.mSunset);
+    }
+    mTimer->getSwitchTimes(dayOfTheWeek, row.mSunrise, row.mSunset, row.mSwitchOn, row.mSwitchOff);
+    row.mOffset = offset;
+    mDirty = true;
+    Scheduler::runIn(0); // Next row in the next loop
+    return;
+  }
+}
+
+void OledControl::upcomingDate(const uint8_t& offset, uint16_t& year, uint8_t& month, uint8_t& day) const
+{
+  year = mMenuData[0];
+  month = mMenuData[1];
+  day = mMenuData[2];
+  for (uint8_t i = 0; i < offset; ++i) RtcControl::nextDay(year, month, day);
+}
+
+void OledControl::renderUpcoming()
+{
+  mOled.home();
+  mOled.print(F("Next 7 days"));
+  for (uint8_t i = 0; i < UPCOMING_ROWS; ++i)
+  {
+    // Two lines per day: the program, then dawn and dusk
+    const uint8_t offset = mSelection + i;
+    const UpcomingRow& row = mUpcoming[offset % UPCOMING_ROWS];
+    const bool known = row.mOffset == offset;
+    uint16_t year;
+    uint8_t month, day;
+    upcomingDate(offset, year, month, day);
+    char dayName[3];
+    strcpy_P(dayName, (char*) pgm_read_word( &sDaysOfTheWeek[(mMenuData[3] + offset) % 7] ) );
+    mOled.setCursor(0, 2 + i * 2);
+    mOled.print(dayName);
+    mOled.setCol(18);
+    mOled.print(twoDigitString(day) + F("-") + twoDigitString(month));
+    mOled.setCol(60);
+    printUpcomingTime(row.mSwitchOn, known);
+    mOled.print(known ? F("-") : F(" "));
+    printUpcomingTime(row.mSwitchOff, known);
+    mOled.setCursor(0, 3 + i * 2);
+    printTimerType(1); // Dawn
+    printUpcomingTime(row.mSunrise, known);
+    mOled.setCol(66);
+    printTimerType(2); // Dusk
+    printUpcomingTime(row.mSunset, known);
+  }
+
+  mRenderer.firstPage(2, 7, SCROLL_BAR_X, SCROLL_BAR_X);
+  do
+  {
+    mRenderer.vLine(SCROLL_BAR_X, SCROLL_BAR_TOP + mSelection * (SCROLL_BAR_HEIGHT - SCROLL_THUMB_HEIGHT) / (UPCOMING_DAYS - UPCOMING_ROWS), SCROLL_THUMB_HEIGHT);
+  } while (mRenderer.nextPage());
+}
+
+/*
+ * Blank while the row is not calculated yet, dashes for a switch or sun
+ * time outside the day (polar day or night, an offset past midnight).
+ */
+void OledControl::printUpcomingTime(const int16_t& time, bool known)
+{
+  if (!known) mOled.print(F("     "));
+  else if (time < 0 || time >= MINUTES_PER_DAY) mOled.print(F("--:--"));
+  else mOled.print(timeString(time));
+}
+
+#if DIAGNOSTICS
+void OledControl::renderDiagnostics()
+{
+  mOled.home();
+#if PROFILER
+  if (mSelection == 1)
+  {
+    Profiler::print(mOled);
+    return;
+  }
+#endif
+  Diagnostics::printLatency(mOled, true);
+  mOled.setCursor(0, 6);
+  MemoryMonitor::print(mOled);
+  mOled.setCursor(0, 7);
+  mOled.print(F("fps "));
+  mOled.print(mFramesPerSecond);
+  mOled.print(F(" render "));
+  mOled.print(mAverageRenderTime);
+  mOled.print(F("us"));
+}
+#endif
+
 bool OledControl::notMaxValue()
 {
   switch (mSelection)
@@ -427,7 +937,8 @@ bool OledControl::notMaxValue()
     case 3: return mMenuData[mSelection] < 23; // Hours
     case 4: return mMenuData[mSelection] < MINUTES_PER_HOUR-1; // Minutes, counting from 0
   }
-}  
+  return false;
+}
 
 String OledControl::twoDigitString(const int16_t& value)
 {
@@ -445,7 +956,7 @@ String OledControl::timeString(const uint16_t& minutesSinceMidnight)
   return timeString(RtcControl::hours(minutesSinceMidnight), RtcControl::minutes(minutesSinceMidnight));
 }
 
-void OledControl::printSelectable(bool selected, class __FlashStringHelper * line) const
+void OledControl::printSelectable(bool selected, const __FlashStringHelper* line)
 {
     mOled.print(selected ? ">" : " ");
     mOled.println(line);
@@ -6,50 +6,114 @@
 #define OLEDCONTROL_H
 
 #include "SSD1306Ascii.h"
-#include "SSD1306AsciiSoftSpi.h"
+#include "display.h"
 
 #include "rtccontrol.h"
 #include "dusk2dawn.h"
 #include "timer.h"
+#include "pagerenderer.h"
+#include "eventqueue.h"
+#include "config.h"
 
 namespace dusk_dawn_timer {
 
-#define evNONE 0
-#define evPRESS 1
-#define evLONGPRESS 2
-#define evLEFT 3
-#define evRIGHT 4
+// Upcoming days screen: the days listed and the rows on screen at once
+#define UPCOMING_DAYS 7
+#define UPCOMING_ROWS 3
+
+// One day of the upcoming days screen
+struct UpcomingRow
+{
+  uint8_t mOffset; // Days from today, UPCOMING_DAYS when not calculated
+  int16_t mSwitchOn;
+  int16_t mSwitchOff;
+  uint16_t mSunrise;
+  uint16_t mSunset;
+};
 
 class OledControl {
 public:
   OledControl(RtcControl* rtc, Dusk2Dawn* d2d, Timer* timer);
   void begin();
-  void userEvent(uint8_t event);
+  void userEvent(uint8_t event, uint16_t time, uint8_t steps = 1);
   void updateMenu(bool forceUpdate = false);
+  // Asks on the display whether to reset all settings and the journal
+  void confirmFactoryReset();
+
+  // Render statistics, refreshed once per second
+  uint8_t getFramesPerSecond() const { return mFramesPerSecond; }
+  uint16_t getAverageRenderTime() const { return mAverageRenderTime; } // micro seconds
 
  private:
+  void handleEvent(uint8_t event);
+  bool isNumberField() const;
+  void enterScreen(uint8_t screen);
+  static void busEvent(void* context, uint8_t events, const void* data);
+  void minuteTick(const uint16_t& minutesSinceMidnight);
+  void render(const unsigned long& now);
+  void sleepDisplay();
+  void wakeDisplay();
+  void updateContrast(const uint16_t& minutesSinceMidnight);
+  void renderDefault();
+  void renderMenu();
+  void renderSetTime();
+  void renderSetTimer();
+  void renderOptions();
+  void renderBusy();
+  void renderFactoryReset();
+  void factoryReset();
+  void renderUpcoming();
+  void updateUpcoming();
+  void upcomingDate(const uint8_t& offset, uint16_t& year, uint8_t& month, uint8_t& day) const;
+  void printUpcomingTime(const int16_t& time, bool known);
+#if DIAGNOSTICS
+  void renderDiagnostics();
+#endif
+
   String twoDigitString(const int16_t& value);
   String timeString(const uint16_t& hour, const uint16_t& minute);
   String timeString(const uint16_t& minutesSinceMidnight);
-  void printSelectable(bool selected, class __FlashStringHelper* line) const;
+  void printSelectable(bool selected, const __FlashStringHelper* line);
   void timerTime(const int16_t& type, const int16_t& time, int16_t& data1, int16_t& data2);
   int16_t timerTime(const int16_t& type, const int16_t& data1, const int16_t& data2);
   void printTimerType(const int16_t& type);
   void printTimerTime1(const int16_t& type, const int16_t& data2);
   void printTimerTime2(const int16_t& type, const int16_t& data2);
   
-  SSD1306AsciiSoftSpi mOled;
+  OledDisplay mOled;
   RtcControl* mRealTimeClock;
   Dusk2Dawn* mD2d;
   Timer* mTimer;
+  PageRenderer mRenderer;
 
   uint8_t mCurrentScreen;
-  uint8_t mEvent = evNONE;  
   
   bool notMaxValue();
   uint8_t mMenuOption = 0;
   int16_t mMenuData[6];
   byte mSelection;
+
+  // Change driven rendering: only draw when something visible changed, as
+  // told by the event bus.
+  bool mDirty = true;
+  bool mClearScreen = false;
+  unsigned long mLastFrameTime = 0;
+  bool mDisplayAsleep = false;
+  uint8_t mContrast = 0xCF; // Contrast set by the display initialization
+  uint8_t mShownProgress = 0;
+
+  // Only the rows on screen are kept, slot is the day offset modulo the rows
+  UpcomingRow mUpcoming[UPCOMING_ROWS];
+
+  unsigned long mStatisticsStart = 0;
+  uint8_t mFrameCount = 0;
+  unsigned long mRenderTimeSum = 0;
+  uint8_t mFramesPerSecond = 0;
+  uint16_t mAverageRenderTime = 0;
+
+  // Input latency: millis() of the oldest event not shown yet
+  bool mInputPending = false;
+  uint16_t mInputTime = 0;
 };
 
 } // namespace
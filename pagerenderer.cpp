@@ -0,0 +1,162 @@
+/*
+ * Page streaming graphics for the SSD1306
+ */
+#include "pagerenderer.h"
+#include "rtccontrol.h"
+
+namespace dusk_dawn_timer {
+
+// Large 7-segment digits: 11 x 16 pixels, segments 2 pixels thick
+#define DIGIT_WIDTH 11
+#define DIGIT_SPACING 3
+#define COLON_WIDTH 4
+
+// Segment rectangles a..g relative to the digit origin: x, y, width, height
+static const uint8_t sSegments[7][4] PROGMEM = {
+  { 1, 0, 9, 2 },   // a, top
+  { 9, 1, 2, 7 },   // b, upper right
+  { 9, 8, 2, 7 },   // c, lower right
+  { 1, 14, 9, 2 },  // d, bottom
+  { 0, 8, 2, 7 },   // e, lower left
+  { 0, 1, 2, 7 },   // f, upper left
+  { 1, 7, 9, 2 }    // g, middle
+};
+
+// Segments lit per digit, bit 0 is segment a
+static const uint8_t sDigitSegments[10] PROGMEM = {
+  0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F
+};
+
+// 24 hour timeline layout within one page, rows relative to its top
+#define TIMELINE_NOW 0      // 2 pixel marker for the current time
+#define TIMELINE_BAR 2      // Frame of the bar, 5 pixels high
+#define TIMELINE_BAR_HEIGHT 5
+#define TIMELINE_SUN 7      // Dawn and dusk marks below the bar
+
+PageRenderer::PageRenderer(SSD1306Ascii* oled)
+  : mOled(oled)
+{ }
+
+void PageRenderer::firstPage(uint8_t first, uint8_t last, uint8_t firstCol, uint8_t lastCol)
+{
+  mPage = first;
+  mLastPage = last;
+  mFirstCol = firstCol;
+  mLastCol = lastCol;
+  memset(mBuffer, 0, sizeof(mBuffer));
+}
+
+/*
+ * Streams the composed page to the display and prepares the next one.
+ * Returns false when the last page has been sent.
+ */
+bool PageRenderer::nextPage()
+{
+  mOled->setCursor(mFirstCol, mPage);
+  for (uint8_t col = mFirstCol; col <= mLastCol; ++col)
+  {
+    mOled->ssd1306WriteRam(mBuffer[col]);
+  }
+  if (mPage >= mLastPage) return false;
+  mPage++;
+  memset(mBuffer, 0, sizeof(mBuffer));
+  return true;
+}
+
+void PageRenderer::fillRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h)
+{
+  // Clip vertically to the current page
+  int16_t top = y - mPage * 8;
+  int16_t bottom = top + h; // exclusive
+  if (bottom <= 0 || top >= 8) return;
+  if (top < 0) top = 0;
+  if (bottom > 8) bottom = 8;
+  const uint8_t mask = (0xFF >> (8 - (bottom - top))) << top;
+  uint8_t end = (x + w > PAGE_WIDTH) ? PAGE_WIDTH : x + w;
+  for (uint8_t col = x; col < end; ++col)
+  {
+    mBuffer[col] |= mask;
+  }
+}
+
+void PageRenderer::drawDigit(uint8_t x, uint8_t y, uint8_t digit)
+{
+  const uint8_t segments = pgm_read_byte(&sDigitSegments[digit % 10]);
+  for (uint8_t s = 0; s < 7; ++s)
+  {
+    if (segments & (1 << s))
+    {
+      fillRect(x + pgm_read_byte(&sSegments[s][0]), y + pgm_read_byte(&sSegments[s][1]),
+               pgm_read_byte(&sSegments[s][2]), pgm_read_byte(&sSegments[s][3]));
+    }
+  }
+}
+
+/*
+ * HH:MM in large digits, 59 pixels wide and 16 high.
+ */
+void PageRenderer::drawTime(uint8_t x, uint8_t y, uint16_t minutesSinceMidnight)
+{
+  const uint8_t hours = RtcControl::hours(minutesSinceMidnight);
+  const uint8_t minutes = RtcControl::minutes(minutesSinceMidnight);
+  drawDigit(x, y, hours / 10);
+  x += DIGIT_WIDTH + DIGIT_SPACING;
+  drawDigit(x, y, hours % 10);
+  x += DIGIT_WIDTH + DIGIT_SPACING;
+  fillRect(x + 1, y + 4, 2, 2);
+  fillRect(x + 1, y + 10, 2, 2);
+  x += COLON_WIDTH;
+  drawDigit(x, y, minutes / 10);
+  x += DIGIT_WIDTH + DIGIT_SPACING;
+  drawDigit(x, y, minutes % 10);
+}
+
+/*
+ * One day over the full display width, 8 pixels high: the periods the
+ * output is switched on as filled parts of the bar, dawn and dusk as marks
+ * below it and the current time as a mark above it.
+ */
+void PageRenderer::drawTimeline(uint8_t y, int16_t switchOn, int16_t switchOff, uint16_t sunrise, uint16_t sunset, uint16_t minutesSinceMidnight)
+{
+  // Frame
+  hLine(0, y + TIMELINE_BAR, PAGE_WIDTH);
+  hLine(0, y + TIMELINE_BAR + TIMELINE_BAR_HEIGHT - 1, PAGE_WIDTH);
+  vLine(0, y + TIMELINE_BAR, TIMELINE_BAR_HEIGHT);
+  vLine(PAGE_WIDTH - 1, y + TIMELINE_BAR, TIMELINE_BAR_HEIGHT);
+  // Six hour ticks
+  for (uint8_t hour = 6; hour < 24; hour += 6)
+  {
+    vLine(timelineX(hour * MINUTES_PER_HOUR), y + TIMELINE_BAR - 1, 1);
+  }
+
+  // Switched on periods, wrapping around midnight when on is after off
+  if (switchOn < switchOff)
+  {
+    fillTimeline(y, switchOn, switchOff);
+  }
+  else if (switchOn > switchOff)
+  {
+    fillTimeline(y, 0, switchOff);
+    fillTimeline(y, switchOn, MINUTES_PER_DAY);
+  }
+
+  if (sunrise < MINUTES_PER_DAY) hLine(timelineX(sunrise) - 1, y + TIMELINE_SUN, 3);
+  if (sunset < MINUTES_PER_DAY) hLine(timelineX(sunset) - 1, y + TIMELINE_SUN, 3);
+  vLine(timelineX(minutesSinceMidnight), y + TIMELINE_NOW, 2);
+}
+
+void PageRenderer::fillTimeline(uint8_t y, int16_t from, int16_t to)
+{
+  const uint8_t start = timelineX(from);
+  const uint8_t end = timelineX(to);
+  if (end > start) fillRect(start, y + TIMELINE_BAR + 1, end - start, TIMELINE_BAR_HEIGHT - 2);
+}
+
+uint8_t PageRenderer::timelineX(int16_t minutesSinceMidnight)
+{
+  if (minutesSinceMidnight <= 0) return 0;
+  if (minutesSinceMidnight >= MINUTES_PER_DAY) return PAGE_WIDTH - 1;
+  return (uint32_t) minutesSinceMidnight * PAGE_WIDTH / MINUTES_PER_DAY;
+}
+
+} // namespace
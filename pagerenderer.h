@@ -0,0 +1,53 @@
+/*
+ * Page streaming graphics for the SSD1306
+ *
+ * There is no room for a 1 KB frame buffer, so graphics are composed one
+ * 8 pixel high display page at a time in a single 128 byte buffer and sent
+ * to the display as soon as the page is complete:
+ *
+ *   renderer.firstPage(2, 3);
+ *   do {
+ *     renderer.drawTime(34, 16, minutesSinceMidnight);
+ *   } while (renderer.nextPage());
+ *
+ * The drawing primitives are clipped to the current page, so the same
+ * drawing code simply runs once per page.
+ */
+#ifndef PAGE_RENDERER_H
+#define PAGE_RENDERER_H
+
+#include "Arduino.h"
+#include "SSD1306Ascii.h"
+
+namespace dusk_dawn_timer {
+
+#define PAGE_WIDTH 128
+
+class PageRenderer {
+public:
+  PageRenderer(SSD1306Ascii* oled);
+  void firstPage(uint8_t first, uint8_t last, uint8_t firstCol = 0, uint8_t lastCol = PAGE_WIDTH - 1);
+  bool nextPage();
+
+  // Primitives, coordinates in pixels
+  void fillRect(uint8_t x, uint8_t y, uint8_t w, uint8_t h);
+  void hLine(uint8_t x, uint8_t y, uint8_t w) { fillRect(x, y, w, 1); }
+  void vLine(uint8_t x, uint8_t y, uint8_t h) { fillRect(x, y, 1, h); }
+  void drawDigit(uint8_t x, uint8_t y, uint8_t digit);
+  void drawTime(uint8_t x, uint8_t y, uint16_t minutesSinceMidnight);
+  void drawTimeline(uint8_t y, int16_t switchOn, int16_t switchOff, uint16_t sunrise, uint16_t sunset, uint16_t minutesSinceMidnight);
+
+private:
+  void fillTimeline(uint8_t y, int16_t from, int16_t to);
+  static uint8_t timelineX(int16_t minutesSinceMidnight);
+
+  SSD1306Ascii* mOled;
+  uint8_t mBuffer[PAGE_WIDTH];
+  uint8_t mPage;
+  uint8_t mLastPage;
+  uint8_t mFirstCol;
+  uint8_t mLastCol;
+};
+
+} // namespace
+#endif // PAGE_RENDERER_H
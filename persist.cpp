@@ -2,82 +2,278 @@
  * Persistent data (EEPROM) abstraction
  */
 #include "persist.h"
+#include "timer.h"
+#include "journal.h"
+#include "eepromjobs.h"
+#include "scheduler.h"
 #include <EEPROM.h>
+#include <util/crc16.h>
 
 namespace dusk_dawn_timer {
 
-// Defines for EEPROM memory addresses used to store the data
-#define SCREEN_BLANK_TIMEOUT 1
+#define CONFIG_ADDRESS PERSIST_CONFIG_ADDRESS
 
-#define WEEK_TIMER1_START_TYPE 10
-#define WEEK_TIMER1_START_TIME 11  // 2 byte -> Also occupies 12
-#define WEEK_TIMER1_STOP_TYPE 20
-#define WEEK_TIMER1_STOP_TIME 21  // 2 byte -> Also occupies 22
+// Addresses used by firmware before the configuration block
+#define LEGACY_SCREEN_BLANK_TIMEOUT 1
+#define LEGACY_WEEK_TIMER 10 // Start type, time (2 byte) at 10, stop at 20
+#define LEGACY_WEEKEND_TIMER 30 // Same at 30 and 40
+#define LEGACY_STOP_OFFSET 10
 
-#define WEEKEND_TIMER1_START_TYPE 30
-#define WEEKEND_TIMER1_START_TIME 31 // 2 byte -> Also occupies 32
-#define WEEKEND_TIMER1_STOP_TYPE 40
-#define WEEKEND_TIMER1_STOP_TIME 41 // 2 byte -> Also occupies 42
+#define COMMIT_DELAY 2000 // ms without changes before committing
+#define COMMIT_BYTES 2 // Bytes programmed per update(), 3.3 ms each
 
-void Persist::clearmem()
+static_assert(sizeof(PersistConfig) <= 32, "Dirty mask has one bit per byte");
+
+// Settings of a board that was never configured
+static const PersistConfig sDefaults PROGMEM = {
+  PERSIST_CONFIG_VERSION,
+  0, // Screen never blanks
+  { SUNDOWN, 15, TIME, 22*60+15 },
+  { SUNDOWN, 15, TIME, 22*60+45 },
+  { LATITUDE, LONGTITUDE, TIMEZONE * 60 },
+  0
+};
+
+PersistConfig Persist::sConfig;
+uint32_t Persist::sDirty = 0;
+unsigned long Persist::sChangeTime = 0;
+
+bool Persist::begin()
+{
+  EEPROM.get(CONFIG_ADDRESS, sConfig);
+  if (sConfig.mVersion == PERSIST_CONFIG_VERSION && sConfig.mCrc == crc(sConfig))
+  {
+    return true;
+  }
+  if (loadVersion1() || loadLegacy()) save();
+  else resetToDefaults();
+  flush();
+  // Clear what else is left in the settings area, so old values can never be
+  // taken over again. Right away when the job queue is full, the area is
+  // small.
+  const uint16_t rest = CONFIG_ADDRESS + sizeof(sConfig);
+  if (!EepromJobs::fill(rest, PERSIST_AREA_SIZE - rest, 0xFF))
+  {
+    for (uint16_t address = rest; address < PERSIST_AREA_SIZE; ++address) EEPROM.update(address, 0xFF);
+  }
+  return false;
+}
+
+/*
+ * Version 1 had no location, its CRC followed the weekend timer. The other
+ * settings are already in place after reading the block.
+ */
+bool Persist::loadVersion1()
+{
+  const uint8_t size = offsetof(PersistConfig, mLocation);
+  uint16_t storedCrc;
+  EEPROM.get(CONFIG_ADDRESS + size, storedCrc);
+  if (sConfig.mVersion != 1 || storedCrc != crc(sConfig, size)) return false;
+  memcpy_P(&sConfig.mLocation, &sDefaults.mLocation, sizeof(sConfig.mLocation));
+  return true;
+}
+
+/*
+ * Reads the settings from the addresses older firmware used. Rejected when
+ * any value is out of range, e.g. on an erased EEPROM.
+ */
+bool Persist::loadLegacy()
+{
+  sConfig.mScreenBlankTimeout = EEPROM.read(LEGACY_SCREEN_BLANK_TIMEOUT);
+  if (sConfig.mScreenBlankTimeout > 30) return false;
+  memcpy_P(&sConfig.mLocation, &sDefaults.mLocation, sizeof(sConfig.mLocation));
+  PersistTimer* timers[2] = { &sConfig.mWeekTimer, &sConfig.mWeekendTimer };
+  const uint16_t addresses[2] = { LEGACY_WEEK_TIMER, LEGACY_WEEKEND_TIMER };
+  for (uint8_t i = 0; i < 2; ++i)
+  {
+    PersistTimer& timer = *timers[i];
+    timer.mStartType = EEPROM.read(addresses[i]);
+    timer.mStartTime = EEPROM.read(addresses[i] + 1) | (EEPROM.read(addresses[i] + 2) << 8);
+    timer.mStopType = EEPROM.read(addresses[i] + LEGACY_STOP_OFFSET);
+    timer.mStopTime = EEPROM.read(addresses[i] + LEGACY_STOP_OFFSET + 1) | (EEPROM.read(addresses[i] + LEGACY_STOP_OFFSET + 2) << 8);
+    const uint8_t types[2] = { timer.mStartType, timer.mStopType };
+    const int16_t times[2] = { timer.mStartTime, timer.mStopTime };
+    for (uint8_t j = 0; j < 2; ++j)
+    {
+      if (types[j] > SUNDOWN) return false;
+      if (types[j] == TIME && (times[j] < 0 || times[j] >= MINUTES_PER_DAY)) return false;
+      if (types[j] != TIME && (times[j] < -59 || times[j] > 59)) return false;
+    }
+  }
+  return true;
+}
+
+void Persist::resetToDefaults()
+{
+  EepromJobs::lock();
+  memcpy_P(&sConfig, &sDefaults, sizeof(sConfig));
+  save();
+  EepromJobs::unlock();
+}
+
+void Persist::factoryReset()
 {
-  for (int i = 0 ; i < EEPROM.length() ; i++) {
-    EEPROM.write(i, 0);
-  }  
+  EepromJobs::lock();
+  resetToDefaults();
+  Journal::erase();
+  Journal::log(jeFACTORY_RESET);
+  EepromJobs::unlock();
 }
 
 void Persist::setScreenBlankTimeout(const uint8_t& timeout)
 {
-    EEPROM.write(SCREEN_BLANK_TIMEOUT, timeout);
+  EepromJobs::lock();
+  if (timeout != sConfig.mScreenBlankTimeout) Journal::log(jeBLANK_TIMEOUT, timeout);
+  sConfig.mScreenBlankTimeout = timeout;
+  save();
+  EepromJobs::unlock();
 }
 uint8_t Persist::getScreenBlankTimeout()
 {
-  return EEPROM.read(SCREEN_BLANK_TIMEOUT);
+  return sConfig.mScreenBlankTimeout;
 }
 
 void Persist::setWeekTimer(const uint8_t& start_type, const int16_t& start_time, const uint8_t& stop_type, const int16_t& stop_time)
 {
-  EEPROM.write(WEEK_TIMER1_START_TYPE, start_type);
-  write16(WEEK_TIMER1_START_TIME, start_time);
-  EEPROM.write(WEEK_TIMER1_STOP_TYPE, stop_type);
-  write16(WEEK_TIMER1_STOP_TIME, stop_time);
+  setTimer(sConfig.mWeekTimer, jeWEEK_ON, start_type, start_time, stop_type, stop_time);
 }
 void Persist::getWeekTimer(uint8_t& start_type, int16_t& start_time, uint8_t& stop_type, int16_t& stop_time)
 {
-  start_type = EEPROM.read(WEEK_TIMER1_START_TYPE);
-  start_time = read16(WEEK_TIMER1_START_TIME);
-  stop_type = EEPROM.read(WEEK_TIMER1_STOP_TYPE);
-  stop_time = read16(WEEK_TIMER1_STOP_TIME);
+  getTimer(sConfig.mWeekTimer, start_type, start_time, stop_type, stop_time);
 }
 void Persist::setWeekendTimer(const uint8_t& start_type, const int16_t& start_time, const uint8_t& stop_type, const int16_t& stop_time)
 {
-  EEPROM.write(WEEKEND_TIMER1_START_TYPE, start_type);
-  write16(WEEKEND_TIMER1_START_TIME, start_time);
-  EEPROM.write(WEEKEND_TIMER1_STOP_TYPE, stop_type);
-  write16(WEEKEND_TIMER1_STOP_TIME, stop_time);
+  setTimer(sConfig.mWeekendTimer, jeWEEKEND_ON, start_type, start_time, stop_type, stop_time);
 }
 void Persist::getWeekendTimer(uint8_t& start_type, int16_t& start_time, uint8_t& stop_type, int16_t& stop_time)
 {
-  start_type = EEPROM.read(WEEKEND_TIMER1_START_TYPE);
-  start_time = read16(WEEKEND_TIMER1_START_TIME);
-  stop_type = EEPROM.read(WEEKEND_TIMER1_STOP_TYPE);
-  stop_time = read16(WEEKEND_TIMER1_STOP_TIME);
+  getTimer(sConfig.mWeekendTimer, start_type, start_time, stop_type, stop_time);
 }
 
-void Persist::write16(int address, const int16_t& value)
+void Persist::setLocation(const float& latitude, const float& longitude, const int16_t& timezone)
+{
+  EepromJobs::lock();
+  if (latitude != sConfig.mLocation.mLatitude || longitude != sConfig.mLocation.mLongitude || timezone != sConfig.mLocation.mTimezone)
+  {
+    Journal::log(jeLOCATION, timezone);
+  }
+  sConfig.mLocation.mLatitude = latitude;
+  sConfig.mLocation.mLongitude = longitude;
+  sConfig.mLocation.mTimezone = timezone;
+  save();
+  EepromJobs::unlock();
+}
+void Persist::getLocation(float& latitude, float& longitude, int16_t& timezone)
 {
-  EEPROM.write(address, value & 0xFF);
-  EEPROM.write(address + 1, (value >> 8) & 0xFF);
+  latitude = sConfig.mLocation.mLatitude;
+  longitude = sConfig.mLocation.mLongitude;
+  timezone = sConfig.mLocation.mTimezone;
 }
 
-int16_t Persist::read16(int address)
+/*
+ * Changed switch actions are journaled, journalCode is the code of the
+ * start action, the stop action uses the next code.
+ */
+void Persist::setTimer(PersistTimer& timer, const uint8_t& journalCode, const uint8_t& start_type, const int16_t& start_time, const uint8_t& stop_type, const int16_t& stop_time)
 {
-  int16_t result = 0;
-  result = EEPROM.read(address+1);
-  result = result << 8;
-  result += EEPROM.read(address);
-  return result;
+  EepromJobs::lock();
+  if (start_type != timer.mStartType || start_time != timer.mStartTime)
+  {
+    Journal::log(journalCode, journalProgram(start_type, start_time));
+  }
+  if (stop_type != timer.mStopType || stop_time != timer.mStopTime)
+  {
+    Journal::log(journalCode + 1, journalProgram(stop_type, stop_time));
+  }
+  timer.mStartType = start_type;
+  timer.mStartTime = start_time;
+  timer.mStopType = stop_type;
+  timer.mStopTime = stop_time;
+  save();
+  EepromJobs::unlock();
 }
 
+void Persist::getTimer(const PersistTimer& timer, uint8_t& start_type, int16_t& start_time, uint8_t& stop_type, int16_t& stop_time)
+{
+  start_type = timer.mStartType;
+  start_time = timer.mStartTime;
+  stop_type = timer.mStopType;
+  stop_time = timer.mStopTime;
+}
+
+/*
+ * Marks the bytes that differ from the EEPROM; an unchanged setting costs no
+ * write cycle.
+ */
+void Persist::save()
+{
+  sConfig.mVersion = PERSIST_CONFIG_VERSION;
+  sConfig.mCrc = crc(sConfig);
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&sConfig);
+  sDirty = 0;
+  for (uint8_t i = 0; i < sizeof(sConfig); ++i)
+  {
+    if (EEPROM.read(CONFIG_ADDRESS + i) != bytes[i]) sDirty |= 1UL << i;
+  }
+  sChangeTime = millis();
+}
+
+/*
+ * Bytes are committed in address order, so the CRC at the end is written
+ * last and the block only becomes valid once it is complete.
+ */
+void Persist::update()
+{
+  if (sDirty == 0) return;
+  // Due immediately once the delay has passed, until everything is committed
+  Scheduler::runAt(sChangeTime + COMMIT_DELAY);
+  if (millis() - sChangeTime < COMMIT_DELAY || EepromJobs::isBusy()) return;
+  EepromJobs::lock();
+  uint8_t budget = COMMIT_BYTES;
+  for (uint8_t i = 0; i < sizeof(sConfig) && budget > 0; ++i)
+  {
+    if (sDirty & (1UL << i))
+    {
+      commitByte(i);
+      budget--;
+    }
+  }
+  EepromJobs::unlock();
+}
+
+/*
+ * Also called from the watchdog interrupt, before the watchdog resets a
+ * hanging loop, unless the loop hangs holding the EepromJobs lock.
+ */
+uint8_t Persist::flush(const uint8_t& maxBytes)
+{
+  uint8_t committed = 0;
+  for (uint8_t i = 0; i < sizeof(sConfig) && committed < maxBytes; ++i)
+  {
+    if (sDirty & (1UL << i))
+    {
+      commitByte(i);
+      committed++;
+    }
+  }
+  return committed;
+}
+
+void Persist::commitByte(const uint8_t& index)
+{
+  EEPROM.update(CONFIG_ADDRESS + index, reinterpret_cast<const uint8_t*>(&sConfig)[index]);
+  sDirty &= ~(1UL << index);
+}
+
+uint16_t Persist::crc(const PersistConfig& config, const uint8_t& size)
+{
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(&config);
+  uint16_t result = 0xFFFF;
+  for (uint8_t i = 0; i < size; ++i)
+  {
+    result = _crc16_update(result, data[i]);
+  }
+  return result;
+}
 
 } // Namespace
@@ -1,5 +1,12 @@
 /*
  * Persistent data (EEPROM) abstraction
+ *
+ * All settings live in one packed configuration block with a version and a
+ * CRC. It is read once by begin() and served from a RAM mirror. Setters only
+ * change the mirror and mark the bytes that differ from the EEPROM; update()
+ * commits them in the background, a few bytes per call, once the settings
+ * have been left alone for a moment. Changes made in quick succession are
+ * coalesced into one commit.
  */
 #ifndef PERSIST_H
 #define PERSIST_H
@@ -7,19 +14,71 @@
 #include "Arduino.h"
 
 namespace dusk_dawn_timer {
-  
+
+// Increment when the layout of PersistConfig changes
+#define PERSIST_CONFIG_VERSION 2
+
+// EEPROM map: the configuration block at 0, room for it to grow up to
+// PERSIST_AREA_SIZE, the journal behind it.
+#define PERSIST_CONFIG_ADDRESS 0
+#define PERSIST_AREA_SIZE 64
+
+struct PersistTimer {
+  uint8_t mStartType;
+  int16_t mStartTime;
+  uint8_t mStopType;
+  int16_t mStopTime;
+} __attribute__((packed));
+
+struct PersistLocation {
+  float mLatitude; // Degrees
+  float mLongitude;
+  int16_t mTimezone; // Minutes east of GMT
+} __attribute__((packed));
+
+struct PersistConfig {
+  uint8_t mVersion;
+  uint8_t mScreenBlankTimeout;
+  PersistTimer mWeekTimer;
+  PersistTimer mWeekendTimer;
+  PersistLocation mLocation; // Since version 2
+  uint16_t mCrc; // Over all bytes before it
+} __attribute__((packed));
+
 class Persist {
 public:
-  static void clearmem();
+  // Loads the configuration. When the block is missing, corrupt or from
+  // another version, settings of a version 1 block or in the layout of older
+  // firmware are taken over, otherwise the defaults. Returns false in that
+  // case.
+  static bool begin();
+  static void resetToDefaults();
+  // Defaults and an erased journal; the erasing runs in the background
+  static void factoryReset();
+  static void update(); // Call every loop
+  // Commits everything now, or at most maxBytes; returns the bytes committed
+  static uint8_t flush(const uint8_t& maxBytes = 0xFF);
+  static bool isDirty() { return sDirty != 0; }
   static void setScreenBlankTimeout(const uint8_t& timeout);
   static uint8_t getScreenBlankTimeout();
   static void setWeekTimer(const uint8_t& start_type, const int16_t& start_time, const uint8_t& stop_type, const int16_t& stop_time);  
   static void getWeekTimer(uint8_t& start_type, int16_t& start_time, uint8_t& stop_type, int16_t& stop_time);  
   static void setWeekendTimer(const uint8_t& start_type, const int16_t& start_time, const uint8_t& stop_type, const int16_t& stop_time);  
   static void getWeekendTimer(uint8_t& start_type, int16_t& start_time, uint8_t& stop_type, int16_t& stop_time);  
+  static void setLocation(const float& latitude, const float& longitude, const int16_t& timezone);
+  static void getLocation(float& latitude, float& longitude, int16_t& timezone);
 private:
-  static void write16(int address, const int16_t& value);
-  static int16_t read16(int address);
+  static void save();
+  static bool loadVersion1();
+  static bool loadLegacy();
+  static void commitByte(const uint8_t& index);
+  static uint16_t crc(const PersistConfig& config, const uint8_t& size = offsetof(PersistConfig, mCrc));
+  static void setTimer(PersistTimer& timer, const uint8_t& journalCode, const uint8_t& start_type, const int16_t& start_time, const uint8_t& stop_type, const int16_t& stop_time);
+  static void getTimer(const PersistTimer& timer, uint8_t& start_type, int16_t& start_time, uint8_t& stop_type, int16_t& stop_time);
+
+  static PersistConfig sConfig;
+  static uint32_t sDirty; // Bit per byte of sConfig not in the EEPROM yet
+  static unsigned long sChangeTime;
 };
 
 } // Namespace
@@ -0,0 +1,102 @@
+/*
+ * Loop profiler
+ */
+#include "profiler.h"
+
+#if PROFILER
+
+namespace dusk_dawn_timer {
+
+// Nominal watchdog timeout, see wdt_enable() in setup()
+#define WATCHDOG_TIMEOUT 1000000UL
+
+// Four letter names of the sections, one after the other
+static const char sSectionNames[] PROGMEM = "rtc d2d tmr enc oledeepr";
+
+uint16_t Profiler::sMin[PROFILE_SECTIONS];
+uint16_t Profiler::sMax[PROFILE_SECTIONS];
+uint32_t Profiler::sSum[PROFILE_SECTIONS];
+uint16_t Profiler::sCount;
+uint32_t Profiler::sLoopMax;
+unsigned long Profiler::sLoopStart;
+unsigned long Profiler::sMarkTime;
+unsigned long Profiler::sLastWatchdogReset;
+uint32_t Profiler::sWatchdogMax;
+
+void Profiler::reset()
+{
+  memset(sMin, 0xFF, sizeof(sMin));
+  memset(sMax, 0, sizeof(sMax));
+  memset(sSum, 0, sizeof(sSum));
+  sCount = 0;
+  sLoopMax = 0;
+  sWatchdogMax = 0;
+  sLastWatchdogReset = micros();
+}
+
+void Profiler::beginLoop()
+{
+  sLoopStart = micros();
+  sMarkTime = sLoopStart;
+}
+
+void Profiler::mark(uint8_t section)
+{
+  const unsigned long now = micros();
+  const uint32_t elapsed = now - sMarkTime;
+  const uint16_t time = elapsed > 0xFFFF ? 0xFFFF : elapsed;
+  sMarkTime = now;
+  if (time < sMin[section]) sMin[section] = time;
+  if (time > sMax[section]) sMax[section] = time;
+  sSum[section] += time;
+  if (section == PROFILE_SECTIONS - 1)
+  {
+    if (now - sLoopStart > sLoopMax) sLoopMax = now - sLoopStart;
+    // Averages stay valid when the count saturates: only the sums are
+    // restarted, the worst cases are kept
+    if (++sCount == 0xFFFF)
+    {
+      memset(sSum, 0, sizeof(sSum));
+      sCount = 0;
+    }
+  }
+}
+
+/*
+ * Only the reset at the end of loop() is seen; the EEPROM jobs reset the
+ * watchdog in between as well, so the real margin is never smaller.
+ */
+void Profiler::watchdogReset()
+{
+  const unsigned long now = micros();
+  if (now - sLastWatchdogReset > sWatchdogMax) sWatchdogMax = now - sLastWatchdogReset;
+  sLastWatchdogReset = now;
+}
+
+/*
+ * Fits the 21 columns of the display: one line per section, then the worst
+ * loop and the watchdog margin.
+ */
+void Profiler::print(Print& out)
+{
+  char line[22];
+  out.println(F("us    min   avg   max"));
+  for (uint8_t i = 0; i < PROFILE_SECTIONS; ++i)
+  {
+    for (uint8_t c = 0; c < 4; ++c) line[c] = pgm_read_byte(&sSectionNames[i * 4 + c]);
+    snprintf_P(line + 4, sizeof(line) - 4, PSTR("%5u %5u %5u"),
+               static_cast<unsigned>(sCount ? sMin[i] : 0),
+               static_cast<unsigned>(sCount ? sSum[i] / sCount : 0),
+               static_cast<unsigned>(sMax[i]));
+    out.println(line);
+  }
+  out.print(F("loop "));
+  out.print(sLoopMax);
+  out.print(F(" wdt "));
+  out.print(sWatchdogMax < WATCHDOG_TIMEOUT ? (WATCHDOG_TIMEOUT - sWatchdogMax) / 1000 : 0);
+  out.println(F("ms"));
+}
+
+} // namespace
+
+#endif // PROFILER
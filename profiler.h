@@ -0,0 +1,70 @@
+/*
+ * Loop profiler
+ *
+ * Measures the time loop() spends in each module and how close the loop
+ * comes to the watchdog timeout. Shown on the second page of the
+ * diagnostics screen and reported on the serial port with 'p'.
+ * With PROFILER set to 0 all calls are empty inlines and cost nothing.
+ */
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "Arduino.h"
+#include "config.h"
+
+namespace dusk_dawn_timer {
+
+// Profiled parts of loop(), in the order they run
+enum ProfileSection {
+  psRTC,
+  psDUSK2DAWN,
+  psTIMER,
+  psROTARY,
+  psOLED,
+  psEEPROM, // Diagnostics and the background EEPROM work
+  PROFILE_SECTIONS
+};
+
+#if PROFILER
+
+#if !DIAGNOSTICS
+#error "PROFILER reports through the diagnostics, set DIAGNOSTICS to 1"
+#endif
+
+class Profiler {
+public:
+  static void reset();
+  // Start of the work in loop()
+  static void beginLoop();
+  // The time since the previous mark (or beginLoop) was spent in section
+  static void mark(uint8_t section);
+  // Call right after wdt_reset()
+  static void watchdogReset();
+  static void print(Print& out);
+
+private:
+  static uint16_t sMin[PROFILE_SECTIONS];
+  static uint16_t sMax[PROFILE_SECTIONS];
+  static uint32_t sSum[PROFILE_SECTIONS];
+  static uint16_t sCount;
+  static uint32_t sLoopMax;
+  static unsigned long sLoopStart;
+  static unsigned long sMarkTime;
+  static unsigned long sLastWatchdogReset;
+  static uint32_t sWatchdogMax;
+};
+
+#else
+
+class Profiler {
+public:
+  static inline void reset() {}
+  static inline void beginLoop() {}
+  static inline void mark(uint8_t) {}
+  static inline void watchdogReset() {}
+};
+
+#endif // PROFILER
+
+} // namespace
+#endif // PROFILER_H
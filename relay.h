@@ -0,0 +1,30 @@
+/*
+ * Relay output
+ *
+ * Pin and polarity are template parameters, so switching compiles to a
+ * single digitalWrite(). Relay is the output RELAY_PIN and
+ * RELAY_ACTIVE_LOW in config.h describe.
+ */
+#ifndef RELAY_H
+#define RELAY_H
+
+#include "Arduino.h"
+#include "config.h"
+
+namespace dusk_dawn_timer {
+
+template <uint8_t PIN, bool ACTIVE_LOW>
+class PinRelay {
+public:
+  static void begin()
+  {
+    pinMode(PIN, OUTPUT);
+    set(false);
+  }
+  static void set(bool on) { digitalWrite(PIN, on != ACTIVE_LOW ? HIGH : LOW); }
+};
+
+typedef PinRelay<RELAY_PIN, RELAY_ACTIVE_LOW> Relay;
+
+} // namespace
+#endif // RELAY_H
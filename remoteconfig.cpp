@@ -0,0 +1,276 @@
+/*
+ * Remote configuration over the serial port
+ */
+#include "remoteconfig.h"
+
+#if REMOTE_CONFIG
+
+#include "timer.h"
+#include "persist.h"
+#include "telemetry.h"
+#include "diagnostics.h"
+#include "scheduler.h"
+#include "eventbus.h"
+#include <util/crc16.h>
+
+namespace dusk_dawn_timer {
+
+#define POLL_INTERVAL 100 // ms between polls of the serial port
+#define FRAME_POLL_INTERVAL 10 // ms between polls while a frame comes in
+#define FRAME_TIMEOUT 250 // ms for a complete frame, then it is discarded
+
+#define REPLY_PAYLOAD 31
+#define REPLY_SIZE (3 + REPLY_PAYLOAD + 2)
+
+#define MAX_TIMEZONE (14 * MINUTES_PER_HOUR)
+#define MAX_SCREEN_BLANK_TIMEOUT 30 // As in the options menu
+
+// Parser states
+#define WAIT_START 0
+#define WAIT_TYPE 1
+#define WAIT_LENGTH 2
+#define WAIT_PAYLOAD 3
+#define WAIT_CRC_LOW 4
+#define WAIT_CRC_HIGH 5
+#define WAIT_DISCARD 6 // Payload of a frame too long to take
+
+// Payload size of each field, in the order of the field bits
+static const uint8_t sFieldSizes[] PROGMEM = { 6, 6, 6, 1, 10 };
+
+RtcControl* RemoteConfig::sRtc;
+Dusk2Dawn* RemoteConfig::sD2d;
+Timer* RemoteConfig::sTimer;
+uint8_t RemoteConfig::sState = WAIT_START;
+uint8_t RemoteConfig::sType;
+uint8_t RemoteConfig::sLength;
+uint8_t RemoteConfig::sReceived;
+uint16_t RemoteConfig::sCrc;
+unsigned long RemoteConfig::sFrameStart;
+uint8_t RemoteConfig::sPayload[REMOTE_CONFIG_MAX_PAYLOAD];
+bool RemoteConfig::sReplyPending = false;
+uint8_t RemoteConfig::sReplyStatus;
+uint8_t RemoteConfig::sReplyFields;
+
+static inline int16_t read16(const uint8_t* data)
+{
+  return data[0] | (data[1] << 8);
+}
+
+static inline float readFloat(const uint8_t* data)
+{
+  float value;
+  memcpy(&value, data, sizeof(value)); // Both the AVR and hosts are little endian
+  return value;
+}
+
+static inline void write16(uint8_t*& data, const int16_t& value)
+{
+  *data++ = value & 0xFF;
+  *data++ = (value >> 8) & 0xFF;
+}
+
+static inline void writeFloat(uint8_t*& data, const float& value)
+{
+  memcpy(data, &value, sizeof(value));
+  data += sizeof(value);
+}
+
+static bool validAction(const uint8_t* data)
+{
+  const uint8_t type = data[0];
+  const int16_t time = read16(data + 1);
+  if (type > SUNDOWN) return false;
+  if (type == TIME) return time >= 0 && time < MINUTES_PER_DAY;
+  return time >= -59 && time <= 59;
+}
+
+void RemoteConfig::begin(RtcControl* rtc, Dusk2Dawn* d2d, Timer* timer)
+{
+  sRtc = rtc;
+  sD2d = d2d;
+  sTimer = timer;
+}
+
+void RemoteConfig::update()
+{
+  if (sState != WAIT_START && millis() - sFrameStart > FRAME_TIMEOUT) sState = WAIT_START;
+  // Only what has arrived, never wait for the rest of a frame
+  for (int available = Serial.available(); available > 0 && !sReplyPending; --available)
+  {
+    const uint8_t data = Serial.read();
+    if (!receive(data)) Diagnostics::command(data);
+  }
+  if (sReplyPending) sendReply();
+  if (sReplyPending) Scheduler::runIn(0);
+  else Scheduler::runIn(sState == WAIT_START ? POLL_INTERVAL : FRAME_POLL_INTERVAL);
+}
+
+bool RemoteConfig::receive(const uint8_t& data)
+{
+  switch (sState)
+  {
+    case WAIT_START:
+      if (data != TELEMETRY_START) return false;
+      sFrameStart = millis();
+      sCrc = 0xFFFF;
+      sState = WAIT_TYPE;
+      return true;
+    case WAIT_TYPE:
+      sType = data;
+      sState = WAIT_LENGTH;
+      break;
+    case WAIT_LENGTH:
+      sLength = data;
+      sReceived = 0;
+      if (sLength > REMOTE_CONFIG_MAX_PAYLOAD) sState = WAIT_DISCARD;
+      else sState = sLength ? WAIT_PAYLOAD : WAIT_CRC_LOW;
+      break;
+    case WAIT_PAYLOAD:
+      sPayload[sReceived++] = data;
+      if (sReceived == sLength) sState = WAIT_CRC_LOW;
+      break;
+    case WAIT_DISCARD:
+      // Skipped up to the CRC, none of it may reach the diagnostics
+      // commands. A frame cut short ends with FRAME_TIMEOUT.
+      if (++sReceived == sLength) sState = WAIT_CRC_LOW;
+      break;
+    case WAIT_CRC_LOW:
+      sCrc ^= data;
+      sState = WAIT_CRC_HIGH;
+      return true;
+    case WAIT_CRC_HIGH:
+      sCrc ^= data << 8;
+      sState = WAIT_START;
+      execute();
+      return true;
+  }
+  sCrc = _crc16_update(sCrc, data);
+  return true;
+}
+
+/*
+ * The CRC of the received bytes XOR the received CRC is zero for an intact
+ * frame.
+ */
+void RemoteConfig::execute()
+{
+  sReplyFields = 0;
+  if (sLength > REMOTE_CONFIG_MAX_PAYLOAD) sReplyStatus = REMOTE_CONFIG_BAD_REQUEST;
+  else if (sCrc != 0) sReplyStatus = REMOTE_CONFIG_BAD_CRC;
+  else if (sType == REMOTE_CONFIG_GET && sLength == 0) sReplyStatus = REMOTE_CONFIG_OK;
+  else if (sType == REMOTE_CONFIG_SET && sLength > 0) sReplyStatus = apply();
+  else sReplyStatus = REMOTE_CONFIG_BAD_REQUEST;
+  sReplyPending = true;
+}
+
+/*
+ * Checks the length and every value first, so a request is applied
+ * completely or not at all.
+ */
+uint8_t RemoteConfig::apply()
+{
+  const uint8_t fields = sPayload[0];
+  if (fields & ~REMOTE_CONFIG_ALL) return REMOTE_CONFIG_BAD_REQUEST;
+  uint8_t size = 1;
+  for (uint8_t i = 0; i < sizeof(sFieldSizes); ++i)
+  {
+    if (fields & (1 << i)) size += pgm_read_byte(&sFieldSizes[i]);
+  }
+  if (size != sLength) return REMOTE_CONFIG_BAD_REQUEST;
+
+  const uint8_t* dateTime = nullptr;
+  const uint8_t* week = nullptr;
+  const uint8_t* weekend = nullptr;
+  const uint8_t* options = nullptr;
+  const uint8_t* location = nullptr;
+  const uint8_t* next = sPayload + 1;
+  if (fields & REMOTE_CONFIG_DATE_TIME) { dateTime = next; next += 6; }
+  if (fields & REMOTE_CONFIG_WEEK) { week = next; next += 6; }
+  if (fields & REMOTE_CONFIG_WEEKEND) { weekend = next; next += 6; }
+  if (fields & REMOTE_CONFIG_OPTIONS) { options = next; next++; }
+  if (fields & REMOTE_CONFIG_LOCATION) location = next;
+
+  if (dateTime)
+  {
+    const uint16_t year = read16(dateTime);
+    const uint8_t month = dateTime[2];
+    const uint8_t day = dateTime[3];
+    const uint16_t minutes = read16(dateTime + 4);
+    if (year < 2000 || year > 2099 || month < 1 || month > 12 || day < 1 ||
+        day > RtcControl::getDaysPerMonth(month, year) || minutes >= MINUTES_PER_DAY)
+    {
+      return REMOTE_CONFIG_BAD_VALUE;
+    }
+  }
+  if (week && !(validAction(week) && validAction(week + 3))) return REMOTE_CONFIG_BAD_VALUE;
+  if (weekend && !(validAction(weekend) && validAction(weekend + 3))) return REMOTE_CONFIG_BAD_VALUE;
+  if (options && options[0] > MAX_SCREEN_BLANK_TIMEOUT) return REMOTE_CONFIG_BAD_VALUE;
+  if (location)
+  {
+    // Written so that NaN fails as well
+    const float latitude = readFloat(location);
+    const float longitude = readFloat(location + 4);
+    const int16_t timezone = read16(location + 8);
+    if (!(latitude >= -90 && latitude <= 90 && longitude >= -180 && longitude <= 180) ||
+        timezone < -MAX_TIMEZONE || timezone > MAX_TIMEZONE)
+    {
+      return REMOTE_CONFIG_BAD_VALUE;
+    }
+  }
+
+  if (dateTime) sRtc->setDateTime(read16(dateTime), dateTime[2], dateTime[3], read16(dateTime + 4));
+  if (week) sTimer->setWeekTimer(week[0], read16(week + 1), week[3], read16(week + 4));
+  if (weekend) sTimer->setWeekendTimer(weekend[0], read16(weekend + 1), weekend[3], read16(weekend + 4));
+  if (options) Persist::setScreenBlankTimeout(options[0]);
+  if (location)
+  {
+    const float latitude = readFloat(location);
+    const float longitude = readFloat(location + 4);
+    Persist::setLocation(latitude, longitude, read16(location + 8));
+    sD2d->setLocation(latitude, longitude, read16(location + 8));
+    EventBus::publish(BUS_LOCATION);
+  }
+  sReplyFields = fields;
+  return REMOTE_CONFIG_OK;
+}
+
+/*
+ * Waits for room in the transmit buffer instead of blocking in write().
+ */
+void RemoteConfig::sendReply()
+{
+  if (Serial.availableForWrite() < REPLY_SIZE) return;
+  uint8_t frame[REPLY_SIZE];
+  uint8_t* next = frame;
+  *next++ = TELEMETRY_START;
+  *next++ = REMOTE_CONFIG_REPLY;
+  *next++ = REPLY_PAYLOAD;
+  *next++ = sReplyStatus;
+  *next++ = sReplyFields;
+  write16(next, sRtc->getYear());
+  *next++ = sRtc->getMonth();
+  *next++ = sRtc->getDay();
+  write16(next, sRtc->getMinutesSinceMidnight());
+  uint8_t type[2];
+  int16_t time[2];
+  Persist::getWeekTimer(type[0], time[0], type[1], time[1]);
+  for (uint8_t i = 0; i < 2; ++i) { *next++ = type[i]; write16(next, time[i]); }
+  Persist::getWeekendTimer(type[0], time[0], type[1], time[1]);
+  for (uint8_t i = 0; i < 2; ++i) { *next++ = type[i]; write16(next, time[i]); }
+  *next++ = Persist::getScreenBlankTimeout();
+  float latitude, longitude;
+  int16_t timezone;
+  Persist::getLocation(latitude, longitude, timezone);
+  writeFloat(next, latitude);
+  writeFloat(next, longitude);
+  write16(next, timezone);
+  uint16_t crc = 0xFFFF;
+  for (uint8_t* data = frame + 1; data < next; ++data) crc = _crc16_update(crc, *data);
+  write16(next, crc);
+  Serial.write(frame, REPLY_SIZE);
+  sReplyPending = false;
+}
+
+} // namespace
+
+#endif // REMOTE_CONFIG
@@ -0,0 +1,104 @@
+/*
+ * Remote configuration over the serial port
+ *
+ * Sets the date and time, both programs, the options and the location in
+ * one transaction, instead of many clicks through the menu. Requests and
+ * replies use the frame format of the telemetry (see telemetry.h): start
+ * byte 0xA5, type, payload length, payload and CRC-16, little endian.
+ *
+ * Requests:
+ *   REMOTE_CONFIG_GET, no payload
+ *   REMOTE_CONFIG_SET, uint8 REMOTE_CONFIG_* field bits, then the selected
+ *   fields in the order of the bits:
+ *     date/time  uint16 year, uint8 month, uint8 day, uint16 minutes since
+ *                midnight (local time)
+ *     week       uint8 on type, int16 on time, uint8 off type, int16 off time
+ *     weekend    the same
+ *     options    uint8 screen blank timeout in minutes
+ *     location   float latitude, float longitude (degrees), int16 time zone
+ *                (minutes east of GMT)
+ * Either all fields are valid and applied, each setting stored once, or
+ * nothing changes.
+ *
+ * Every request is answered with REMOTE_CONFIG_REPLY: uint8 status, uint8
+ * fields applied, then all fields above in that order.
+ *
+ * update() reads what the serial port has received without waiting for the
+ * rest of a frame. Bytes outside a frame are diagnostics commands. A frame
+ * longer than REMOTE_CONFIG_MAX_PAYLOAD is skipped to its end and answered
+ * with REMOTE_CONFIG_BAD_REQUEST.
+ */
+#ifndef REMOTE_CONFIG_H
+#define REMOTE_CONFIG_H
+
+#include "Arduino.h"
+#include "config.h"
+#include "rtccontrol.h"
+#include "dusk2dawn.h"
+
+namespace dusk_dawn_timer {
+
+class Timer;
+
+#define REMOTE_CONFIG_GET 0x10
+#define REMOTE_CONFIG_SET 0x11
+#define REMOTE_CONFIG_REPLY 0x90
+
+// Fields
+#define REMOTE_CONFIG_DATE_TIME 0x01
+#define REMOTE_CONFIG_WEEK 0x02
+#define REMOTE_CONFIG_WEEKEND 0x04
+#define REMOTE_CONFIG_OPTIONS 0x08
+#define REMOTE_CONFIG_LOCATION 0x10
+#define REMOTE_CONFIG_ALL 0x1F
+
+// Reply status
+#define REMOTE_CONFIG_OK 0
+#define REMOTE_CONFIG_BAD_CRC 1
+#define REMOTE_CONFIG_BAD_VALUE 2
+#define REMOTE_CONFIG_BAD_REQUEST 3
+
+// Payload of a request setting all fields
+#define REMOTE_CONFIG_MAX_PAYLOAD 30
+
+#if REMOTE_CONFIG
+
+class RemoteConfig {
+public:
+  static void begin(RtcControl* rtc, Dusk2Dawn* d2d, Timer* timer);
+  static void update(); // Call every loop
+
+private:
+  // False when the byte is not part of a frame
+  static bool receive(const uint8_t& data);
+  static void execute();
+  static uint8_t apply();
+  static void sendReply();
+
+  static RtcControl* sRtc;
+  static Dusk2Dawn* sD2d;
+  static Timer* sTimer;
+  static uint8_t sState;
+  static uint8_t sType;
+  static uint8_t sLength;
+  static uint8_t sReceived;
+  static uint16_t sCrc;
+  static unsigned long sFrameStart;
+  static uint8_t sPayload[REMOTE_CONFIG_MAX_PAYLOAD];
+  static bool sReplyPending;
+  static uint8_t sReplyStatus;
+  static uint8_t sReplyFields;
+};
+
+#else
+
+class RemoteConfig {
+public:
+  static inline void begin(RtcControl*, Dusk2Dawn*, Timer*) {}
+  static inline void update() {}
+};
+
+#endif // REMOTE_CONFIG
+
+} // namespace
+#endif // REMOTE_CONFIG_H
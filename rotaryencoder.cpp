@@ -1,10 +1,13 @@
 /*
  * Rotary encoder input handling
  *  
- *  This class uses the basic code from the Interrupt-based Rotary Encoder Sketch
- *  by Simon Merrett, https://gist.github.com/Xplorer001/b7bff3744fa10647b185ab4043fbcc93
+ *  The quadrature decoding uses the full step state table by Ben Buxton,
+ *  http://www.buxtronix.net/2011/10/rotary-encoders-done-properly.html
  */
 #include "rotaryencoder.h"
+#include "eventqueue.h"
+#include "scheduler.h"
+#include "eventbus.h"
 
 namespace dusk_dawn_timer {
     
@@ -12,87 +15,201 @@ namespace dusk_dawn_timer {
 // Use static code for ISR handling.
 // Note that this implies that there can only be one instance of the class.
 
-#define PIN_RIGHT 2 // Our first hardware interrupt pin is digital pin 2
-#define PIN_LEFT 3 // Our second hardware interrupt pin is digital pin 3
-#define BUTTON_PIN 4 // Button pushed switch pin
+// All three inputs are on port D, so one pin change interrupt (PCINT2)
+// serves them and a single PIND read gives a consistent snapshot.
+#define PIN_RIGHT 2 // Encoder A, PD2
+#define PIN_LEFT 3 // Encoder B, PD3
+#define BUTTON_PIN 4 // Button pushed switch pin, PD4
 
-#define BUTTON_NONE 0
-#define BUTTON_PRESSED 1
-#define AWAIT_BUTTON_RELEASE 2
-
-volatile byte aFlag = 0; // let's us know when we're expecting a rising edge on pinA to signal that the encoder has arrived at a detent
-volatile byte bFlag = 0; // let's us know when we're expecting a rising edge on pinB to signal that the encoder has arrived at a detent (opposite direction to when aFlag is set)
-volatile uint8_t encoderEvent = evNONE; 
-#define TIME_UPDATE_DELAY 500  // Do not read the buttons to often
+#define DEBOUNCE_TIME 5 // ms the button must be stable
 #define LONG_PRESS_TIME 2500
 
-void PinA(){
-  cli(); //stop interrupts happening before we read pin values
-  byte reading = PIND & 0xC; // read all eight pin values then strip away all but pinA and pinB's values
-  if(reading == B00001100 && aFlag) { //check that we have both pins at detent (HIGH) and that we are expecting detent on this pin's rising edge
-    encoderEvent = evRIGHT;
-    bFlag = 0; //reset flags for the next turn
-    aFlag = 0; //reset flags for the next turn
-  }
-  else if (reading == B00000100) bFlag = 1; //signal that we're expecting pinB to signal the transition to detent from free rotation
-  sei(); //restart interrupts
-}
+// Rotary acceleration: turning fast multiplies the step size in edit screens
+#define ACCELERATION_SLOW 80 // ms between detents, slower is a single step
+#define ACCELERATION_FAST 30 // ms between detents, faster is the largest step
+#define STEP_MEDIUM 4
+#define STEP_LARGE 10
 
-void PinB(){
-  cli(); //stop interrupts happening before we read pin values
-  byte reading = PIND & 0xC; //read all eight pin values then strip away all but pinA and pinB's values
-  if (reading == B00001100 && bFlag) { //check that we have both pins at detent (HIGH) and that we are expecting detent on this pin's rising edge
-    encoderEvent = evLEFT;
-    bFlag = 0; //reset flags for the next turn
-    aFlag = 0; //reset flags for the next turn
-  }
-  else if (reading == B00001000) aFlag = 1; //signal that we're expecting pinA to signal the transition to detent from free rotation
-  sei(); //restart interrupts
+// Decoder states, the input is (B << 1) | A with both high at a detent.
+// Only the complete Gray code sequence 11 -> 01 -> 00 -> 10 -> 11 (or the
+// reverse) reports a detent, contact bounce just moves back and forth.
+#define R_START 0x0
+#define R_CW_FINAL 0x1
+#define R_CW_BEGIN 0x2
+#define R_CW_NEXT 0x3
+#define R_CCW_BEGIN 0x4
+#define R_CCW_FINAL 0x5
+#define R_CCW_NEXT 0x6
+#define DIR_CW 0x10
+#define DIR_CCW 0x20
+
+static const uint8_t sTransitions[7][4] PROGMEM = {
+  // R_START
+  { R_START,    R_CW_BEGIN,  R_CCW_BEGIN, R_START },
+  // R_CW_FINAL
+  { R_CW_NEXT,  R_START,     R_CW_FINAL,  R_START | DIR_CW },
+  // R_CW_BEGIN
+  { R_CW_NEXT,  R_CW_BEGIN,  R_START,     R_START },
+  // R_CW_NEXT
+  { R_CW_NEXT,  R_CW_BEGIN,  R_CW_FINAL,  R_START },
+  // R_CCW_BEGIN
+  { R_CCW_NEXT, R_START,     R_CCW_BEGIN, R_START },
+  // R_CCW_FINAL
+  { R_CCW_NEXT, R_CCW_FINAL, R_START,     R_START | DIR_CCW },
+  // R_CCW_NEXT
+  { R_CCW_NEXT, R_CCW_FINAL, R_CCW_BEGIN, R_START },
+};
+
+EventQueue encoderEvents; // Filled by the ISRs, emptied by update()
+
+static uint8_t encoderState = R_START;
+static bool buttonPressed = false; // Debounced state
+static uint8_t buttonUnstable = 0; // ms the input differs from buttonPressed
+static uint16_t buttonHeld = 0; // ms the button has been pressed
+static bool longPressSent = false;
+
+// Timer2 in CTC mode gives a 1 ms tick, only running while the button is
+// bouncing or held down.
+static inline void startButtonTimer()
+{
+  if (TIMSK2 & _BV(OCIE2A)) return;
+  TCNT2 = 0;
+  TIFR2 = _BV(OCF2A);
+  TIMSK2 |= _BV(OCIE2A);
 }
 
-RotaryEncoder::RotaryEncoder(OledControl* oled)
-  : mOled(oled)
-  , mButtonState(BUTTON_NONE)
-{}
+static inline void stopButtonTimer()
+{
+  TIMSK2 &= ~_BV(OCIE2A);
+}
 
-void RotaryEncoder::begin() {
-  pinMode(PIN_RIGHT, INPUT_PULLUP); // set pinA as an input, pulled HIGH to the logic voltage (5V or 3.3V for most cases)
-  pinMode(PIN_LEFT, INPUT_PULLUP); // set pinB as an input, pulled HIGH to the logic voltage (5V or 3.3V for most cases)
-  attachInterrupt(0,PinA,RISING); // set an interrupt on PinA, looking for a rising edge signal and executing the "PinA" Interrupt Service Routine (below)
-  attachInterrupt(1,PinB,RISING); // set an interrupt on PinB, looking for a rising edge signal and executing the "PinB" Interrupt Service Routine (below)
-  pinMode(BUTTON_PIN, INPUT_PULLUP); // set pinB as an input, pulled HIGH to the logic voltage (5V or 3.3V for most cases)
+static inline void encoderChanged(uint8_t pins)
+{
+  encoderState = pgm_read_byte(&sTransitions[encoderState & 0x0F][(pins >> PIN_RIGHT) & 0x03]);
+  if (encoderState & DIR_CW) encoderEvents.push(evRIGHT, millis());
+  else if (encoderState & DIR_CCW) encoderEvents.push(evLEFT, millis());
+  else return;
+  Scheduler::notify();
 }
 
-void RotaryEncoder::update() {
-  bool buttonPressed = digitalRead(BUTTON_PIN) == LOW;
-  unsigned long now = millis();
- 
-  if (buttonPressed && mButtonState == BUTTON_NONE) // button pressed
+static inline void buttonTick()
+{
+  const bool pressed = (PIND & _BV(BUTTON_PIN)) == 0;
+  if (pressed != buttonPressed)
   {
-    if (now - mLastButtonChangeTime >= TIME_UPDATE_DELAY)
-    {    
-      mButtonState = BUTTON_PRESSED;
-      mLastButtonChangeTime = now;
+    if (++buttonUnstable >= DEBOUNCE_TIME)
+    {
+      buttonPressed = pressed;
+      buttonUnstable = 0;
+      if (pressed)
+      {
+        buttonHeld = 0;
+        longPressSent = false;
+      }
+      else if (!longPressSent)
+      {
+        encoderEvents.push(evPRESS, millis());
+        Scheduler::notify();
+      }
     }
   }
-  else if (!buttonPressed && mButtonState != BUTTON_NONE) // Button released
+  else
+  {
+    buttonUnstable = 0;
+  }
+
+  if (buttonPressed && !longPressSent && ++buttonHeld >= LONG_PRESS_TIME)
   {
-    mLastButtonChangeTime = now;
-    bool pressed = (mButtonState == BUTTON_PRESSED);
-    mButtonState = BUTTON_NONE;
-    if (pressed) mOled->userEvent(evPRESS);
-  }  
-  else if (buttonPressed && mButtonState == BUTTON_PRESSED && // Button still pressed
-           now - mLastButtonChangeTime >= LONG_PRESS_TIME)
+    encoderEvents.push(evLONGPRESS, millis());
+    longPressSent = true;
+    Scheduler::notify();
+  }
+  if (!buttonPressed && buttonUnstable == 0) stopButtonTimer();
+}
+
+} // namespace
+
+ISR(PCINT2_vect)
+{
+  const uint8_t pins = PIND;
+  dusk_dawn_timer::encoderChanged(pins);
+  if (((pins & _BV(BUTTON_PIN)) == 0) != dusk_dawn_timer::buttonPressed)
+  {
+    dusk_dawn_timer::startButtonTimer();
+  }
+}
+
+ISR(TIMER2_COMPA_vect)
+{
+  dusk_dawn_timer::buttonTick();
+}
+
+namespace dusk_dawn_timer {
+
+RotaryEncoder::RotaryEncoder()
+  : mLastTurn(evNONE)
+  , mLastTurnTime(0)
+{}
+
+void RotaryEncoder::begin() {
+  pinMode(PIN_RIGHT, INPUT_PULLUP);
+  pinMode(PIN_LEFT, INPUT_PULLUP);
+  pinMode(BUTTON_PIN, INPUT_PULLUP);
+  if ((PIND & _BV(BUTTON_PIN)) == 0)
   {
-    mButtonState = AWAIT_BUTTON_RELEASE;
-    mOled->userEvent(evLONGPRESS);
+    // Held at power up: releasing it is no press
+    buttonPressed = true;
+    longPressSent = true;
   }
-  else if (encoderEvent != evNONE)
+
+  // Button debounce tick: 16 MHz / 64 / 250 = 1 kHz
+  TCCR2A = _BV(WGM21);
+  TCCR2B = _BV(CS22);
+  OCR2A = 249;
+  TIMSK2 = 0;
+
+  // Pin change interrupt on both encoder pins and the button
+  PCMSK2 |= _BV(PIN_RIGHT) | _BV(PIN_LEFT) | _BV(BUTTON_PIN);
+  PCIFR = _BV(PCIF2);
+  PCICR |= _BV(PCIE2);
+}
+
+void RotaryEncoder::update() {
+  // Hand over every event since the last update, none get lost
+  InputEvent event;
+  while (encoderEvents.pop(event))
   {
-    mOled->userEvent(encoderEvent);
+    UserInput input;
+    input.mEvent = event.mEvent;
+    input.mSteps = (event.mEvent == evLEFT || event.mEvent == evRIGHT) ? stepSize(event) : 1;
+    input.mTime = event.mTime;
+    EventBus::publish(BUS_INPUT, &input);
   }
-  encoderEvent = evNONE;
+}
+
+bool RotaryEncoder::isButtonPressed() const
+{
+  return buttonPressed;
+}
+
+uint8_t RotaryEncoder::droppedEvents() const
+{
+  return encoderEvents.dropped();
+}
+
+/*
+ * Step size from the rotation speed: the time since the previous detent in
+ * the same direction.
+ */
+uint8_t RotaryEncoder::stepSize(const InputEvent& event)
+{
+  const uint16_t interval = event.mTime - mLastTurnTime;
+  const bool sameDirection = event.mEvent == mLastTurn;
+  mLastTurn = event.mEvent;
+  mLastTurnTime = event.mTime;
+  if (!sameDirection || interval >= ACCELERATION_SLOW) return 1;
+  if (interval < ACCELERATION_FAST) return STEP_LARGE;
+  return STEP_MEDIUM;
 }
 
 } // namespace
@@ -1,27 +1,31 @@
 /*
  * Rotary encoder input handling
  *  
- *  This class uses the basic code from the Interrupt-based Rotary Encoder Sketch
- *  by Simon Merrett, https://gist.github.com/Xplorer001/b7bff3744fa10647b185ab4043fbcc93
+ *  Encoder and button are handled in interrupts, update() publishes the
+ *  queued events on the event bus (BUS_INPUT).
  */
 #ifndef ROTARY_ENCODER_H
 #define ROTARY_ENCODER_H
 
 #include <Arduino.h>
-#include "oledcontrol.h"
+#include "eventqueue.h"
 
 namespace dusk_dawn_timer {
   
 class RotaryEncoder {
 public:
-  RotaryEncoder(OledControl* oled);
+  RotaryEncoder();
   void begin();
   void update();
+  bool isButtonPressed() const;
+  // Events lost because the queue was full, update() came too late
+  uint8_t droppedEvents() const;
 
 private:
-  OledControl* mOled;
-  uint8_t mButtonState;
-  unsigned long mLastButtonChangeTime;
+  uint8_t stepSize(const InputEvent& event);
+
+  uint8_t mLastTurn;
+  uint16_t mLastTurnTime;
 };
 
 } // namespace
@@ -1,33 +1,33 @@
 #include "rtccontrol.h"
-// Date and time functions using a DS3231 RTC connected via I2C and Wire lib
-#include <Wire.h>
+#include "journal.h"
+#include "scheduler.h"
+#include "eventbus.h"
 
 namespace dusk_dawn_timer {
   
-#define NORMALDELAY 1000  // 10 sec
+#define NORMALDELAY 1000  // 1 sec
 
-#define DS3231_ADDRESS  0x68
-#define DS3231_CONTROL  0x0E
-#define DS3231_STATUSREG 0x0F
-
-RtcControl::RtcControl()
+template <class Clock>
+RtcControlT<Clock>::RtcControlT()
   : mDayLightSaving(false)
 { }
 
-void RtcControl::begin()
+template <class Clock>
+void RtcControlT<Clock>::begin()
 {
-  Wire.begin();
+  Clock::begin();
 
-  if (RTC_DS3231::lostPower()) {
+  if (Clock::lostPower()) {
     // This line sets the RTC with an explicit date & time
-    RTC_DS3231::adjust(2018,1,1,0);    
+    Clock::adjust(2018,1,1,0);    
   }
   updateNow();
   mTimeLastUpdate = millis();
   checkDayLightSaving(); 
 }
 
-void RtcControl::update()
+template <class Clock>
+void RtcControlT<Clock>::update()
 {
   // RTC time update
   unsigned long now = millis();
@@ -36,26 +36,48 @@ void RtcControl::update()
     mTimeLastUpdate = now;
     updateNow();
   }
+  Scheduler::runAt(mTimeLastUpdate + NORMALDELAY + 1);
 }
 
 const uint8_t daysInMonth [] PROGMEM = { 31,28,31,30,31,30,31,31,30,31,30,31 };
 
-uint8_t RtcControl::getDaysPerMonth(const uint8_t& month, const uint16_t& year)
+template <class Clock>
+uint8_t RtcControlT<Clock>::getDaysPerMonth(const uint8_t& month, const uint16_t& year)
 {
   uint8_t days(pgm_read_byte(daysInMonth + month - 1));
   if (month == 2 && year%4 == 0) days++;
   return days;
 }
 
-uint8_t RtcControl::getDayOfTheWeek() const
+template <class Clock>
+void RtcControlT<Clock>::nextDay(uint16_t& year, uint8_t& month, uint8_t& day)
+{
+  if (day < getDaysPerMonth(month, year))
+  {
+    day++;
+    return;
+  }
+  day = 1;
+  if (month < 12) month++;
+  else
+  {
+    month = 1;
+    year++;
+  }
+}
+
+template <class Clock>
+uint8_t RtcControlT<Clock>::getDayOfTheWeek() const
 {
   return mDayOfTheWeek;
 }
-uint16_t RtcControl::getYear() const
+template <class Clock>
+uint16_t RtcControlT<Clock>::getYear() const
 {
   return mYear;
 }
-uint8_t RtcControl::getMonth() const
+template <class Clock>
+uint8_t RtcControlT<Clock>::getMonth() const
 {
   if (mDayLightSaving &&
       ((mMinutesSinceMidnight + 60) / MINUTES_PER_DAY) == 1 &&
@@ -65,7 +87,8 @@ uint8_t RtcControl::getMonth() const
   }
   return mMonth;
 }
-uint8_t RtcControl::getDay() const
+template <class Clock>
+uint8_t RtcControlT<Clock>::getDay() const
 {
   if (mDayLightSaving &&
       ((mMinutesSinceMidnight + 60) / MINUTES_PER_DAY) == 1)
@@ -74,7 +97,8 @@ uint8_t RtcControl::getDay() const
   }
   else return mDay;
 }
-uint16_t RtcControl::getMinutesSinceMidnight() const
+template <class Clock>
+uint16_t RtcControlT<Clock>::getMinutesSinceMidnight() const
 {
   if (mDayLightSaving)
   {
@@ -83,14 +107,19 @@ uint16_t RtcControl::getMinutesSinceMidnight() const
   else return mMinutesSinceMidnight;
 }
 
-bool RtcControl::dayLightSaving() const
+template <class Clock>
+bool RtcControlT<Clock>::dayLightSaving() const
 {
   return mDayLightSaving;
 }
 
-void RtcControl::updateNow()
+template <class Clock>
+void RtcControlT<Clock>::updateNow(const bool& publish)
 {
-  RTC_DS3231::now(mYear, mMonth, mDay, mMinutesSinceMidnight);    
+  const uint16_t previousMinute = getMinutesSinceMidnight();
+  const uint8_t previousDay = getDay();
+  const bool previousDayLightSaving = mDayLightSaving;
+  Clock::now(mYear, mMonth, mDay, mMinutesSinceMidnight);    
   mDayOfTheWeek = dayOfTheWeek(mYear, getMonth(), getDay());
   // Day light saving time check
   if (mDayLightSaving == true &&
@@ -109,9 +138,16 @@ void RtcControl::updateNow()
   {
     mDayLightSaving = true;
   }
+
+  // Local date and minute, the daylight saving switch changes both
+  uint8_t events = 0;
+  if (getDay() != previousDay || mDayLightSaving != previousDayLightSaving) events |= BUS_DATE;
+  if (getMinutesSinceMidnight() != previousMinute) events |= BUS_MINUTE;
+  if (events && publish) EventBus::publish(events);
 }
 
-uint8_t RtcControl::dayOfTheWeek(const uint16_t& year, const uint8_t& month, const uint8_t& day) 
+template <class Clock>
+uint8_t RtcControlT<Clock>::dayOfTheWeek(const uint16_t& year, const uint8_t& month, const uint8_t& day) 
 {
   int adjustment, mm, yy;
   adjustment = (14 - month) / 12;
@@ -120,14 +156,36 @@ uint8_t RtcControl::dayOfTheWeek(const uint16_t& year, const uint8_t& month, con
   return (day + (13 * mm - 1) / 5 +  yy + yy / 4 - yy / 100 + yy / 400) % 7;
 }
 
-void RtcControl::setDateTime(const uint16_t& year, const uint8_t& month, const uint8_t& day, const uint16_t& minutesSinceMidnight)
+template <class Clock>
+bool RtcControlT<Clock>::isDayLightSaving(const uint16_t& year, const uint8_t& month, const uint8_t& day)
 {
-  RTC_DS3231::adjust(year, month, day, (mDayLightSaving && minutesSinceMidnight > 60) ? minutesSinceMidnight - 60 : minutesSinceMidnight);
-  updateNow();
+  if (month < 3 || month > 10) return false;
+  if (month > 3 && month < 10) return true;
+  // The switch is on the last Sunday, the 25th or later
+  const int8_t lastSunday = day - dayOfTheWeek(year, month, day);
+  return month == 3 ? lastSunday >= 25 : lastSunday < 25;
+}
+
+template <class Clock>
+void RtcControlT<Clock>::setDateTime(const uint16_t& year, const uint8_t& month, const uint8_t& day, const uint16_t& minutesSinceMidnight)
+{
+  // Daylight saving time of the new date, not of the current one, decides
+  // the standard time the clock is set to
+  mYear = year;
+  mMonth = month;
+  mDay = day;
+  mMinutesSinceMidnight = minutesSinceMidnight;
+  mDayLightSaving = false;
   checkDayLightSaving();
+  Clock::adjust(year, month, day, (mDayLightSaving && minutesSinceMidnight > 60) ? minutesSinceMidnight - 60 : minutesSinceMidnight);
+  updateNow(false); // Published below, once the daylight saving time is settled
+  checkDayLightSaving();
+  Journal::timeSet();
+  EventBus::publish(BUS_CLOCK_SET | BUS_DATE | BUS_MINUTE);
 }
 
-void RtcControl::checkDayLightSaving()
+template <class Clock>
+void RtcControlT<Clock>::checkDayLightSaving()
 {
   // Initialize daylightsaving
   if (getMonth() < 3 || getMonth() > 10)
@@ -152,61 +210,7 @@ void RtcControl::checkDayLightSaving()
   }  
 }
 
-////////////////////////////////////////////////////////////////////////////////
-// RTC_DS3231 implementation
-
-static uint8_t bcd2bin (uint8_t val) { return val - 6 * (val >> 4); }
-static uint8_t bin2bcd (uint8_t val) { return val + 6 * (val / 10); }
-
-static uint8_t read_i2c_register(uint8_t addr, uint8_t reg) {
-  Wire.beginTransmission(addr);
-  Wire.write((byte)reg);
-  Wire.endTransmission();
-
-  Wire.requestFrom(addr, (byte)1);
-  return Wire.read();
-}
-
-static void write_i2c_register(uint8_t addr, uint8_t reg, uint8_t val) {
-  Wire.beginTransmission(addr);
-  Wire.write((byte)reg);
-  Wire.write((byte)val);
-  Wire.endTransmission();
-}
-
-bool RtcControl::RTC_DS3231::lostPower(void) {
-  return (read_i2c_register(DS3231_ADDRESS, DS3231_STATUSREG) >> 7);
-}
-
-void RtcControl::RTC_DS3231::adjust(const uint16_t& year, const uint8_t& month, const uint8_t& day, const uint16_t& minutesSinceMidnight) {
-  Wire.beginTransmission(DS3231_ADDRESS);
-  Wire.write((byte)0); // start at location 0
-  Wire.write(bin2bcd(0)); // seconds
-  Wire.write(bin2bcd(minutesSinceMidnight%MINUTES_PER_HOUR));
-  Wire.write(bin2bcd(minutesSinceMidnight/MINUTES_PER_HOUR));
-  Wire.write(bin2bcd(0));
-  Wire.write(bin2bcd(day));
-  Wire.write(bin2bcd(month));
-  Wire.write(bin2bcd(year - 2000));
-  Wire.endTransmission();
-
-  uint8_t statreg = read_i2c_register(DS3231_ADDRESS, DS3231_STATUSREG);
-  statreg &= ~0x80; // flip OSF bit
-  write_i2c_register(DS3231_ADDRESS, DS3231_STATUSREG, statreg);
-}
-
-void RtcControl::RTC_DS3231::now(uint16_t& year, uint8_t& month, uint8_t& day, uint16_t& minutesSinceMidnight) {
-  Wire.beginTransmission(DS3231_ADDRESS);
-  Wire.write((byte)0);  
-  Wire.endTransmission();
-
-  Wire.requestFrom(DS3231_ADDRESS, 7);
-  Wire.read(); // seconds
-  minutesSinceMidnight = bcd2bin(Wire.read()) + MINUTES_PER_HOUR * bcd2bin(Wire.read());
-  Wire.read();
-  day = bcd2bin(Wire.read());
-  month = bcd2bin(Wire.read());
-  year = bcd2bin(Wire.read()) + 2000;
-}
+// The one backend this build uses
+template class RtcControlT<RtcClock>;
 
 } // Namspace
@@ -1,24 +1,35 @@
 /*
  * Real time clock abstraction
+ *
+ * Keeps local time on top of a clock backend (see clocks.h) that runs on
+ * standard time. The backend is a template parameter; RtcControl is the
+ * instance for the clock RTC_CLOCK in config.h selects.
  */
 
 #ifndef RTC_CONTROL_H
 #define RTC_CONTROL_H
 
 #include "Arduino.h"
+#include "config.h"
+#include "clocks.h"
 
 namespace dusk_dawn_timer {
   
 #define MINUTES_PER_HOUR 60
 #define MINUTES_PER_DAY 1440
 
-class RtcControl {
+template <class Clock>
+class RtcControlT {
 public:
-  RtcControl();
+  RtcControlT();
   void begin();
   void update();
 
   static uint8_t getDaysPerMonth(const uint8_t& month, const uint16_t& year);
+  static uint8_t dayOfTheWeek(const uint16_t& year, const uint8_t& month, const uint8_t& day);
+  static void nextDay(uint16_t& year, uint8_t& month, uint8_t& day);
+  // Daylight saving time of a date after 03:00, for days other than today
+  static bool isDayLightSaving(const uint16_t& year, const uint8_t& month, const uint8_t& day);
   uint8_t getDayOfTheWeek() const;
   uint16_t getYear() const;
   uint8_t getMonth() const;
@@ -29,25 +40,27 @@ public:
   static inline uint8_t hours(const int& minutesSinceMidnight) { return minutesSinceMidnight/MINUTES_PER_HOUR; }
   static inline uint8_t minutes(const int& minutesSinceMidnight) { return minutesSinceMidnight%MINUTES_PER_HOUR; }
 private:
-  static uint8_t dayOfTheWeek(const uint16_t& year, const uint8_t& month, const uint8_t& day);
-  void updateNow();
+  void updateNow(const bool& publish = true);
   void checkDayLightSaving();
   uint16_t mYear;
   uint8_t mMonth;
   uint8_t mDay;
   uint8_t mDayOfTheWeek;
   uint16_t mMinutesSinceMidnight;
-  unsigned long mTimeLastUpdate; // 10 second resolution is good enough.
+  unsigned long mTimeLastUpdate; // 1 second resolution is good enough.
   bool mDayLightSaving;
-
-  // RTC based on the DS3231 chip connected via I2C and the Wire library
-  class RTC_DS3231 {
-  public:
-      static void adjust(const uint16_t& year, const uint8_t& month, const uint8_t& day, const uint16_t& minutesSinceMidnight);
-      static bool lostPower(void);
-      static void now(uint16_t& year, uint8_t& month, uint8_t& day, uint16_t& minutesSinceMidnight);
-  };
 };
 
+#if RTC_CLOCK == CLOCK_DS1307
+typedef Ds1307Clock RtcClock;
+#elif RTC_CLOCK == CLOCK_MILLIS
+typedef MillisClock RtcClock;
+#else
+typedef Ds3231Clock RtcClock;
+#endif
+
+// Instantiated in rtccontrol.cpp
+typedef RtcControlT<RtcClock> RtcControl;
+
 } // Namespace
 #endif  // RTC_CONTROL_H
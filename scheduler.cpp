@@ -0,0 +1,68 @@
+/*
+ * Cooperative scheduling with idle sleep
+ */
+#include "scheduler.h"
+#include <avr/sleep.h>
+#include <avr/interrupt.h>
+
+namespace dusk_dawn_timer {
+
+uint32_t Scheduler::sDeadline = 0;
+bool Scheduler::sDeadlineSet = false;
+volatile bool Scheduler::sNotified = false;
+bool Scheduler::sWasNotified = false;
+unsigned long Scheduler::sLoops = 0;
+unsigned long Scheduler::sWakes = 0;
+
+/*
+ * Times are compared by their 32 bit difference, so a deadline after the
+ * wrap of millis() (every 49.7 days) is still later than one before it.
+ */
+void Scheduler::runAt(const unsigned long& time)
+{
+  if (!sDeadlineSet || static_cast<int32_t>(static_cast<uint32_t>(time) - sDeadline) < 0)
+  {
+    sDeadline = time;
+    sDeadlineSet = true;
+  }
+}
+
+/*
+ * Idle mode keeps timer 0 running, so millis() stays valid; its overflow
+ * interrupt wakes the CPU every 1.024 ms to check the deadline.
+ */
+void Scheduler::sleep()
+{
+  sLoops++;
+  uint32_t deadline = millis() + MAX_SLEEP;
+  if (sDeadlineSet && static_cast<int32_t>(sDeadline - deadline) < 0) deadline = sDeadline;
+  sDeadlineSet = false;
+
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  while (static_cast<int32_t>(static_cast<uint32_t>(millis()) - deadline) < 0)
+  {
+    // Interrupts stay off between the check and sleep_cpu(); sei() takes
+    // effect after the next instruction, so no notify() gets lost.
+    cli();
+    if (sNotified)
+    {
+      sei();
+      break;
+    }
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+    sWakes++;
+  }
+  sWasNotified = sNotified;
+  sNotified = false;
+}
+
+void Scheduler::resetStatistics()
+{
+  sLoops = 0;
+  sWakes = 0;
+}
+
+} // namespace
@@ -0,0 +1,46 @@
+/*
+ * Cooperative scheduling with idle sleep
+ *
+ * The modules still run from loop() in a fixed order, but loop() no longer
+ * spins with a fixed delay. While they run, modules report when they need
+ * to run again with runAt() or runIn(); interrupt handlers that queue work
+ * call notify(). sleep() then idles the CPU until the earliest deadline or
+ * a notify(), whichever comes first.
+ */
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "Arduino.h"
+
+namespace dusk_dawn_timer {
+
+// Longest sleep, loop() resets the 1 s watchdog at least this often
+#define MAX_SLEEP 500
+
+class Scheduler {
+public:
+  // Deadlines for the next sleep(), the earliest one counts
+  static void runAt(const unsigned long& time);
+  static void runIn(const unsigned long& delay) { runAt(millis() + delay); }
+  // Ends the current or next sleep, safe to call from an ISR
+  static void notify() { sNotified = true; }
+  static void sleep();
+  // The last sleep() ended early by a notify(), there is input to handle
+  static bool wasNotified() { return sWasNotified; }
+
+  // Statistics since the last reset
+  static unsigned long getLoopCount() { return sLoops; }
+  static unsigned long getWakeCount() { return sWakes; }
+  static void resetStatistics();
+
+private:
+  static uint32_t sDeadline; // millis() wraps at 32 bits, as on the AVR
+  static bool sDeadlineSet;
+  static volatile bool sNotified;
+  static bool sWasNotified;
+  static unsigned long sLoops;
+  static unsigned long sWakes;
+};
+
+} // namespace
+#endif // SCHEDULER_H
@@ -0,0 +1,121 @@
+/*
+ * Binary telemetry frames on the serial port
+ */
+#include "telemetry.h"
+
+#if TELEMETRY
+
+#include "timer.h"
+#include "scheduler.h"
+#include "eventbus.h"
+#include <util/crc16.h>
+
+namespace dusk_dawn_timer {
+
+// Start byte, type, length, payload and CRC
+#define FRAME_SIZE (3 + TELEMETRY_STATUS_SIZE + 2)
+
+#ifdef __AVR__
+
+// Not cleared by the startup code, which runs after .init0
+static uint8_t sBootResetCause __attribute__((section(".noinit")));
+
+/*
+ * Optiboot clears MCUSR before it starts the sketch and passes its value
+ * in r2. Runs from .init0, before the startup code uses r2; naked and only
+ * the one instruction, r1 is not zero yet.
+ */
+void saveResetCause() __attribute__((naked, used, section(".init0")));
+void saveResetCause()
+{
+  __asm__ __volatile__ ("sts %0, r2\n" : "=m" (sBootResetCause));
+}
+
+#else
+
+static const uint8_t sBootResetCause = 0; // The host has no bootloader
+
+#endif // __AVR__
+
+RtcControl* Telemetry::sRtc;
+Dusk2Dawn* Telemetry::sD2d;
+Timer* Telemetry::sTimer;
+uint8_t Telemetry::sPending;
+uint8_t Telemetry::sResetCause;
+uint16_t Telemetry::sDropped;
+
+void Telemetry::begin(RtcControl* rtc, Dusk2Dawn* d2d, Timer* timer)
+{
+  // Still in MCUSR without a bootloader, or one that leaves it alone
+  const uint8_t mcusr = MCUSR;
+  sResetCause = mcusr ? mcusr : sBootResetCause;
+  MCUSR = 0;
+  sRtc = rtc;
+  sD2d = d2d;
+  sTimer = timer;
+  changed(TELEMETRY_BOOT);
+  EventBus::subscribe(BUS_DATE | BUS_CLOCK_SET | BUS_RELAY | BUS_NEXT_SWITCH, busEvent);
+}
+
+void Telemetry::busEvent(void*, uint8_t events, const void*)
+{
+  uint8_t reasons = 0;
+  if (events & BUS_RELAY) reasons |= TELEMETRY_RELAY;
+  if (events & BUS_NEXT_SWITCH) reasons |= TELEMETRY_NEXT_SWITCH;
+  if (events & BUS_DATE) reasons |= TELEMETRY_DAY;
+  if (events & BUS_CLOCK_SET) reasons |= TELEMETRY_CLOCK_SET;
+  changed(reasons);
+}
+
+void Telemetry::changed(const uint8_t& reasons)
+{
+  sPending |= reasons;
+  Scheduler::runIn(0);
+}
+
+void Telemetry::put(uint8_t*& frame, const uint32_t& value, const uint8_t& size)
+{
+  for (uint8_t i = 0; i < size; ++i) *frame++ = value >> (8 * i);
+}
+
+void Telemetry::update()
+{
+  if (!sPending) return;
+  if (Serial.availableForWrite() < FRAME_SIZE)
+  {
+    // The frame is a snapshot, the next one has the complete state again
+    if (sDropped < 0xFFFF) sDropped++;
+    sPending = 0;
+    return;
+  }
+
+  uint8_t frame[FRAME_SIZE];
+  uint8_t* next = frame;
+  put(next, TELEMETRY_START, 1);
+  put(next, TELEMETRY_STATUS, 1);
+  put(next, TELEMETRY_STATUS_SIZE, 1);
+  put(next, sPending, 1);
+  put(next, sRtc->getYear(), 2);
+  put(next, sRtc->getMonth(), 1);
+  put(next, sRtc->getDay(), 1);
+  put(next, sRtc->getMinutesSinceMidnight(), 2);
+  put(next, (sTimer->isSwitchedOn() ? TELEMETRY_FLAG_ON : 0) |
+            (sTimer->isSwitchedManual() ? TELEMETRY_FLAG_MANUAL : 0) |
+            (sRtc->dayLightSaving() ? TELEMETRY_FLAG_DST : 0), 1);
+  put(next, sTimer->getNextSwitchTime(), 2);
+  put(next, sD2d->mSunrise, 2);
+  put(next, sD2d->mSunset, 2);
+  put(next, Scheduler::getLoopCount(), 4);
+  put(next, Scheduler::getWakeCount(), 4);
+  put(next, sResetCause, 1);
+  put(next, sDropped, 2);
+  uint16_t crc = 0xFFFF;
+  for (uint8_t* data = frame + 1; data < next; ++data) crc = _crc16_update(crc, *data);
+  put(next, crc, 2);
+  Serial.write(frame, FRAME_SIZE);
+  sPending = 0;
+}
+
+} // namespace
+
+#endif // TELEMETRY
@@ -0,0 +1,92 @@
+/*
+ * Binary telemetry frames on the serial port
+ *
+ * A frame is a snapshot of the unit: time, relay state, next switch time,
+ * sunrise and sunset, loop statistics and the cause of the last reset. It
+ * is sent when something changes (boot, relay switched, next switch time,
+ * new day, clock set), never at a fixed rate. The changes come from the
+ * event bus (eventbus.h), update() sends one frame for everything that
+ * changed since the last one.
+ *
+ * Frames go into the interrupt driven transmit buffer of the serial port.
+ * When there is no room the frame is dropped and counted; loop() never
+ * waits for the port. Text reports of the diagnostics may be interleaved,
+ * a decoder syncs on the start byte and checks the CRC
+ * (extras/tools/telemetry.py).
+ *
+ * Frame, little endian:
+ *   0xA5, type, payload length, payload, CRC-16 (avr-libc _crc16_update,
+ *   initial 0xFFFF) over type, length and payload
+ * Status payload (type 1):
+ *   uint8  reasons, TELEMETRY_* bits
+ *   uint16 year, uint8 month, uint8 day, uint16 minutes since midnight
+ *   uint8  flags, TELEMETRY_FLAG_* bits
+ *   uint16 next switch time, uint16 sunrise, uint16 sunset (minutes)
+ *   uint32 loops, uint32 wakes (since the statistics were reset)
+ *   uint8  reset cause (MCUSR at boot, as optiboot passes it on)
+ *   uint16 dropped frames
+ * With TELEMETRY set to 0 all calls are empty inlines.
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "Arduino.h"
+#include "config.h"
+#include "rtccontrol.h"
+#include "dusk2dawn.h"
+
+namespace dusk_dawn_timer {
+
+class Timer;
+
+// Reasons for a frame
+#define TELEMETRY_BOOT 0x01
+#define TELEMETRY_RELAY 0x02
+#define TELEMETRY_NEXT_SWITCH 0x04
+#define TELEMETRY_DAY 0x08
+#define TELEMETRY_CLOCK_SET 0x10
+
+// Status flags
+#define TELEMETRY_FLAG_ON 0x01
+#define TELEMETRY_FLAG_MANUAL 0x02
+#define TELEMETRY_FLAG_DST 0x04
+
+#define TELEMETRY_START 0xA5
+#define TELEMETRY_STATUS 1
+#define TELEMETRY_STATUS_SIZE 25
+
+#if TELEMETRY
+
+class Telemetry {
+public:
+  // Call first in setup(), it takes the reset cause
+  static void begin(RtcControl* rtc, Dusk2Dawn* d2d, Timer* timer);
+  static void changed(const uint8_t& reasons);
+  static void update(); // Call every loop, after the modules ran
+  static uint16_t getDropCount() { return sDropped; }
+
+private:
+  static void busEvent(void* context, uint8_t events, const void* data);
+  static void put(uint8_t*& frame, const uint32_t& value, const uint8_t& size);
+
+  static RtcControl* sRtc;
+  static Dusk2Dawn* sD2d;
+  static Timer* sTimer;
+  static uint8_t sPending;
+  static uint8_t sResetCause;
+  static uint16_t sDropped;
+};
+
+#else
+
+class Telemetry {
+public:
+  static inline void begin(RtcControl*, Dusk2Dawn*, Timer*) {}
+  static inline void changed(const uint8_t&) {}
+  static inline void update() {}
+};
+
+#endif // TELEMETRY
+
+} // namespace
+#endif // TELEMETRY_H
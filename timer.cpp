@@ -6,14 +6,13 @@
 
 #include "timer.h"
 #include "persist.h"
-
-// change to true for first time programming
-#define INITIALIZE_EEPROM_MEMORY false
+#include "journal.h"
+#include "relay.h"
+#include "eventbus.h"
+#include "lightsensor.h"
 
 namespace dusk_dawn_timer {
 
-#define PINOUT A2 // Pin to control solid-state relay
-
 Timer::Timer(RtcControl* rtc, Dusk2Dawn* d2d)
   : mRealTimeClock(rtc),
     md2d(d2d)
@@ -21,30 +20,37 @@ Timer::Timer(RtcControl* rtc, Dusk2Dawn* d2d)
 
 void Timer::begin()
 {
-  if (INITIALIZE_EEPROM_MEMORY) // EEPROM initialization
-  {
-    Persist::clearmem();
-    Persist::setWeekTimer(SUNDOWN, 15, TIME, 22*60+15);
-    Persist::setWeekendTimer(SUNDOWN, 15, TIME, 22*60+45);
-  }
-  pinMode(PINOUT, OUTPUT);  
-  digitalWrite(PINOUT, HIGH);
+  Relay::begin();
+  EventBus::subscribe(BUS_SOLAR, solarChanged, this);
+  loadProgram();
+}
+
+void Timer::loadProgram()
+{
   Persist::getWeekTimer(mWeekDayOn.mSwitchType, mWeekDayOn.mTime, mWeekDayOff.mSwitchType, mWeekDayOff.mTime);
   Persist::getWeekendTimer(mWeekendOn.mSwitchType, mWeekendOn.mTime, mWeekendOff.mSwitchType, mWeekendOff.mTime);
+  mMinuteCache = MINUTE_CACHE_INVALID;
 }
 
 void Timer::update()
 {
   uint16_t minutesSinceMidnight = mRealTimeClock->getMinutesSinceMidnight();
-  if (mMinuteCache != RtcControl::minutes(minutesSinceMidnight))
+  LightSensor::update(minutesSinceMidnight, md2d->mSunrise, md2d->mSunset);
+  if (LightSensor::getSunriseDelay() != mSunriseDelay || LightSensor::getSunsetAdvance() != mSunsetAdvance)
+  {
+    mSunriseDelay = LightSensor::getSunriseDelay();
+    mSunsetAdvance = LightSensor::getSunsetAdvance();
+    mMinuteCache = MINUTE_CACHE_INVALID;
+  }
+  if (mMinuteCache != minutesSinceMidnight)
   {
-    mMinuteCache = RtcControl::minutes(minutesSinceMidnight);
+    mMinuteCache = minutesSinceMidnight;
+    const bool currentManual = isSwitchedManual();
     if (minutesSinceMidnight == mManualSwitchTime) mManualSwitchTime = -1;
     
-    uint8_t dayOfTheWeek = mRealTimeClock->getDayOfTheWeek();
     bool currentOnOff = mSwitchedOn;
-    if (isWeekDay(dayOfTheWeek)) getNextWeekDaySwitch(dayOfTheWeek, minutesSinceMidnight, mNextSwitchTime, mSwitchedOn);
-    else getNextWeekendSwitch(dayOfTheWeek, minutesSinceMidnight, mNextSwitchTime, mSwitchedOn);
+    const uint16_t currentNextSwitch = mNextSwitchTime;
+    evaluate(mRealTimeClock->getDayOfTheWeek(), minutesSinceMidnight, mNextSwitchTime, mSwitchedOn);
     
     if (mManualSwitchTime != -1 &&
         mManualSwitchTime == mNextSwitchTime)
@@ -53,21 +59,64 @@ void Timer::update()
     }
     if (currentOnOff != mSwitchedOn)
     {
-      digitalWrite(PINOUT, mSwitchedOn ? LOW : HIGH);    
+      Relay::set(mSwitchedOn);
+      Journal::log(jeSWITCH, (mSwitchedOn ? JOURNAL_SWITCH_ON : 0) | (mManualSwitchTime != -1 ? JOURNAL_SWITCH_MANUAL : 0));
     }
+    uint8_t events = 0;
+    if (currentOnOff != mSwitchedOn || currentManual != isSwitchedManual()) events |= BUS_RELAY;
+    if (currentNextSwitch != mNextSwitchTime) events |= BUS_NEXT_SWITCH;
+    if (events) EventBus::publish(events);
   }
 }
 
+/*
+ * New dawn or dusk (a new day, another location): the switch times of the
+ * program move, evaluate again with the next update().
+ */
+void Timer::solarChanged(void* context, uint8_t, const void*)
+{
+  static_cast<Timer*>(context)->mMinuteCache = MINUTE_CACHE_INVALID;
+}
+
 uint16_t Timer::getNextSwitchTime()
 {
   return mNextSwitchTime;
 }
 
+void Timer::getTodaysSwitchTimes(int16_t& switchOn, int16_t& switchOff)
+{
+  if (isWeekDay(mRealTimeClock->getDayOfTheWeek()))
+  {
+    switchOn = getTimerTime(mWeekDayOn);
+    switchOff = getTimerTime(mWeekDayOff);
+  }
+  else
+  {
+    switchOn = getTimerTime(mWeekendOn);
+    switchOff = getTimerTime(mWeekendOff);
+  }
+}
+
+void Timer::getSwitchTimes(const uint8_t& dayOfTheWeek, const uint16_t& sunrise, const uint16_t& sunset, int16_t& switchOn, int16_t& switchOff) const
+{
+  if (isWeekDay(dayOfTheWeek))
+  {
+    switchOn = getTimerTime(mWeekDayOn, sunrise, sunset);
+    switchOff = getTimerTime(mWeekDayOff, sunrise, sunset);
+  }
+  else
+  {
+    switchOn = getTimerTime(mWeekendOn, sunrise, sunset);
+    switchOff = getTimerTime(mWeekendOff, sunrise, sunset);
+  }
+}
+
 void Timer::manualSwitch()
 {
   if (mManualSwitchTime == -1) mManualSwitchTime = mNextSwitchTime;
   else mManualSwitchTime = -1;
-  mMinuteCache = 0;
+  Journal::log(jeMANUAL, mManualSwitchTime != -1);
+  mMinuteCache = MINUTE_CACHE_INVALID;
 //  mManualSwitchTime = mRealTimeClock->getDateTime();
 }
 
@@ -83,7 +132,7 @@ void Timer::setWeekTimer(const uint8_t& on_type, const int16_t& on_time, const u
   mWeekDayOff.mSwitchType = off_type;
   mWeekDayOff.mTime = off_time;
   Persist::setWeekTimer(mWeekDayOn.mSwitchType, mWeekDayOn.mTime, mWeekDayOff.mSwitchType, mWeekDayOff.mTime);
-  mMinuteCache = 0;
+  mMinuteCache = MINUTE_CACHE_INVALID;
 }
 void Timer::setWeekendTimer(const uint8_t& on_type, const int16_t& on_time, const uint8_t& off_type, const int16_t& off_time)
 {
@@ -92,26 +141,48 @@ void Timer::setWeekendTimer(const uint8_t& on_type, const int16_t& on_time, cons
   mWeekendOff.mSwitchType = off_type;
   mWeekendOff.mTime = off_time;
   Persist::setWeekendTimer(mWeekendOn.mSwitchType, mWeekendOn.mTime, mWeekendOff.mSwitchType, mWeekendOff.mTime);
-  mMinuteCache = 0;  
+  mMinuteCache = MINUTE_CACHE_INVALID;  
+}
+
+void Timer::setProgram(const SwitchAction& weekDayOn, const SwitchAction& weekDayOff, const SwitchAction& weekendOn, const SwitchAction& weekendOff)
+{
+  mWeekDayOn = weekDayOn;
+  mWeekDayOff = weekDayOff;
+  mWeekendOn = weekendOn;
+  mWeekendOff = weekendOff;
+  mMinuteCache = MINUTE_CACHE_INVALID;
 }
 
-int16_t Timer::getTimerTime(const SwitchAction& action)
+void Timer::evaluate(const uint8_t& dayOfTheWeek, const uint16_t& minutesSinceMidnight, uint16_t& nextSwitchTime, bool& switchedOn) const
+{
+  if (isWeekDay(dayOfTheWeek)) getNextWeekDaySwitch(dayOfTheWeek, minutesSinceMidnight, nextSwitchTime, switchedOn);
+  else getNextWeekendSwitch(dayOfTheWeek, minutesSinceMidnight, nextSwitchTime, switchedOn);
+}
+
+int16_t Timer::getTimerTime(const SwitchAction& action) const
 {
   switch (action.mSwitchType)
   {
     case SUNUP:
     {
-      return md2d->mSunrise + action.mTime;
+      return md2d->mSunrise + mSunriseDelay + action.mTime;
     }
     case SUNDOWN:
     {
-      return md2d->mSunset + action.mTime;
-    }
-    case TIME:
-    {
-      return action.mTime;
+      return md2d->mSunset - mSunsetAdvance + action.mTime;
     }
   };
+  return action.mTime;
+}
+
+int16_t Timer::getTimerTime(const SwitchAction& action, const uint16_t& sunrise, const uint16_t& sunset)
+{
+  switch (action.mSwitchType)
+  {
+    case SUNUP: return sunrise + action.mTime;
+    case SUNDOWN: return sunset + action.mTime;
+  };
+  return action.mTime;
 }
 
 void Timer::getNextWeekDaySwitch(const uint8_t& dayOfTheWeek, const uint16_t& minutesSinceMidnight, uint16_t& nextSwitchTime, bool& switchedOn) const
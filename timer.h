@@ -8,7 +8,7 @@
 #define TIMER_H
 
 #include "rtccontrol.h"
-#include "Dusk2Dawn.h"
+#include "dusk2dawn.h"
 
 namespace dusk_dawn_timer {
 
@@ -17,6 +17,8 @@ namespace dusk_dawn_timer {
 #define SUNUP 1
 #define SUNDOWN 2
 
+#define MINUTE_CACHE_INVALID 0xFFFF
+
 struct SwitchAction
 {
   SwitchAction() { }
@@ -34,6 +36,10 @@ public:
   void begin();
   void update();
   uint16_t getNextSwitchTime();
+  void getTodaysSwitchTimes(int16_t& switchOn, int16_t& switchOff);
+  // Program of another day with that day's solar times, without the light
+  // sensor shifts that only apply to today
+  void getSwitchTimes(const uint8_t& dayOfTheWeek, const uint16_t& sunrise, const uint16_t& sunset, int16_t& switchOn, int16_t& switchOff) const;
 
   void manualSwitch();
   bool isSwitchedOn();
@@ -50,9 +56,17 @@ public:
   
   void setWeekTimer(const uint8_t& on_type, const int16_t& on_time, const uint8_t& off_type, const int16_t& off_time);  
   void setWeekendTimer(const uint8_t& on_type, const int16_t& on_time, const uint8_t& off_type, const int16_t& off_time);  
+  void loadProgram(); // Both programs as stored, after a factory reset
+
+  // For host tools: a program that is not stored, and the switch state at
+  // a moment of a day with the next switch time, without any side effects
+  void setProgram(const SwitchAction& weekDayOn, const SwitchAction& weekDayOff, const SwitchAction& weekendOn, const SwitchAction& weekendOff);
+  void evaluate(const uint8_t& dayOfTheWeek, const uint16_t& minutesSinceMidnight, uint16_t& nextSwitchTime, bool& switchedOn) const;
 private:
+  static void solarChanged(void* context, uint8_t events, const void* data);
   inline static bool isWeekDay(uint8_t dayOfTheWeek) { return dayOfTheWeek > 0 && dayOfTheWeek < 5; /* Mo, Tu, We, Th */ }
-  int16_t getTimerTime(const SwitchAction& action);
+  int16_t getTimerTime(const SwitchAction& action) const;
+  static int16_t getTimerTime(const SwitchAction& action, const uint16_t& sunrise, const uint16_t& sunset);
   void getNextWeekDaySwitch(const uint8_t& dayOfTheWeek, const uint16_t& minutesSinceMidnight, uint16_t& nextSwitchTime, bool& switchedOn) const;
   void getNextWeekendSwitch(const uint8_t& dayOfTheWeek, const uint16_t& minutesSinceMidnight, uint16_t& nextSwitchTime, bool& switchedOn) const;
   void getNextSwitch(const uint8_t& dayOfTheWeek, const uint16_t& minutesSinceMidnight, const int16_t& switchOnTime, const int16_t& switchOffTime, uint16_t& nextSwitchTime, bool& switchedOn) const;
@@ -64,9 +78,11 @@ private:
   SwitchAction mWeekendOn;
   SwitchAction mWeekendOff;
   bool mSwitchedOn = false;
-  uint8_t mMinuteCache = 0;
+  uint16_t mMinuteCache = MINUTE_CACHE_INVALID; // Minute of the day last evaluated
   uint16_t mNextSwitchTime = 0;
   int16_t mManualSwitchTime = -1;
+  uint8_t mSunriseDelay = 0; // Light sensor shifts of today, see lightsensor.h
+  uint8_t mSunsetAdvance = 0;
 };
 
 } // Namespace